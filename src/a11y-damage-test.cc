@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "a11y-damage.hh"
+
+using namespace bte::terminal;
+
+using row_t = AccessibleDamage::row_t;
+
+/* Takes the damage of a 24 row view starting at @top, and checks that exactly
+ * the rows from @start to @end need to be re-read. */
+static void
+assert_damage(AccessibleDamage& damage,
+              row_t top,
+              row_t start,
+              row_t end)
+{
+        row_t start_row = -1, end_row = -1;
+        g_assert_true(damage.take(top, 24, &start_row, &end_row));
+        g_assert_cmpint(start_row, ==, start);
+        g_assert_cmpint(end_row, ==, end);
+}
+
+static void
+assert_damage_all(AccessibleDamage& damage,
+                  row_t top,
+                  row_t row_count = 24)
+{
+        row_t start_row, end_row;
+        g_assert_false(damage.take(top, row_count, &start_row, &end_row));
+}
+
+static void
+test_a11y_damage_rows(void)
+{
+        auto damage = AccessibleDamage{};
+
+        /* The first snapshot is a full one */
+        assert_damage_all(damage, 0);
+
+        assert_damage(damage, 0, 0, 0);
+
+        damage.damage_rows(5, 7);
+        assert_damage(damage, 0, 5, 7);
+        assert_damage(damage, 0, 0, 0);
+
+        damage.damage_rows(10, 11);
+        damage.damage_rows(3, 4);
+        assert_damage(damage, 0, 3, 11);
+
+        /* Rows out of view are clipped away */
+        damage.damage_rows(20, 30);
+        assert_damage(damage, 0, 20, 24);
+        damage.damage_rows(30, 40);
+        assert_damage(damage, 0, 24, 24);
+}
+
+/* Output scrolling the view only needs the new rows re-read */
+static void
+test_a11y_damage_scroll(void)
+{
+        auto damage = AccessibleDamage{};
+        assert_damage_all(damage, 100);
+
+        /* A line of output at the bottom scrolls the view by one row */
+        damage.damage_rows(123, 124);
+        damage.damage_rows(124, 125);
+        assert_damage(damage, 101, 123, 125);
+
+        /* A few more, with a change higher up */
+        damage.damage_rows(110, 111);
+        assert_damage(damage, 104, 110, 128);
+
+        /* Scrolling back up only needs the rows at the top */
+        assert_damage(damage, 90, 90, 104);
+        assert_damage(damage, 89, 89, 90);
+}
+
+static void
+test_a11y_damage_all(void)
+{
+        auto damage = AccessibleDamage{};
+        assert_damage_all(damage, 0);
+
+        /* Scrolling by a screenful or more */
+        assert_damage_all(damage, 24);
+        assert_damage_all(damage, 0);
+        assert_damage(damage, 23, 24, 47);
+
+        /* Resizing */
+        assert_damage_all(damage, 23, 25);
+        assert_damage_all(damage, 23);
+        assert_damage(damage, 23, 23, 23);
+
+        damage.damage_rows(30, 31);
+        damage.damage_all();
+        assert_damage_all(damage, 23);
+
+        /* Resetting after a full snapshot */
+        damage.damage_rows(30, 31);
+        g_assert_false(damage.take(23, 24, nullptr, nullptr));
+        assert_damage(damage, 23, 23, 23);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/a11y/damage/rows", test_a11y_damage_rows);
+        g_test_add_func("/bte/a11y/damage/scroll", test_a11y_damage_scroll);
+        g_test_add_func("/bte/a11y/damage/all", test_a11y_damage_all);
+
+        return g_test_run();
+}
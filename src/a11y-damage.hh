@@ -0,0 +1,107 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+namespace bte {
+
+namespace terminal {
+
+/* Tracks the rows that the accessible has to re-read to bring its snapshot
+ * of the displayed text up to date: the ones whose contents might have
+ * changed, and the ones that scrolled into view. */
+class AccessibleDamage {
+public:
+        using row_t = long;
+
+        /* The whole text needs to be refreshed */
+        inline void damage_all() noexcept
+        {
+                m_all = true;
+        }
+
+        /* The contents of the rows from @start to @end (exclusive) might have changed */
+        void damage_rows(row_t start,
+                         row_t end) noexcept
+        {
+                if (end <= start)
+                        return;
+
+                if (m_start == m_end) {
+                        m_start = start;
+                        m_end = end;
+                } else {
+                        m_start = std::min(m_start, start);
+                        m_end = std::max(m_end, end);
+                }
+        }
+
+        /* Get the rows to re-read since the previous call, now that @row_count
+         * rows from @top on are displayed, clipped to these, and start
+         * collecting them anew. The rows that scrolled out of view are to be
+         * dropped by the caller.
+         * Returns false if the whole text needs to be refreshed, because
+         * damage_all() was called, the number of rows changed, or the view
+         * scrolled by a screenful or more. Either of @start_row and @end_row
+         * can be nullptr to just reset the state after a full refresh. */
+        bool take(row_t top,
+                  row_t row_count,
+                  row_t* start_row,
+                  row_t* end_row) noexcept
+        {
+                auto all = m_all || row_count != m_row_count;
+                if (!all && top > m_top) {
+                        if (top >= m_top + m_row_count)
+                                all = true;
+                        else
+                                damage_rows(m_top + m_row_count, top + row_count);
+                } else if (!all && top < m_top) {
+                        if (top + row_count <= m_top)
+                                all = true;
+                        else
+                                damage_rows(top, m_top);
+                }
+
+                auto const start = std::clamp(m_start, top, top + row_count);
+                auto const end = std::max(start, std::min(m_end, top + row_count));
+
+                m_start = m_end = 0;
+                m_all = false;
+                m_top = top;
+                m_row_count = row_count;
+
+                if (all || start_row == nullptr || end_row == nullptr)
+                        return false;
+
+                *start_row = start;
+                *end_row = end;
+                return true;
+        }
+
+private:
+        row_t m_start{0};
+        row_t m_end{0};  /* exclusive */
+        bool m_all{true};
+        row_t m_top{0};
+        row_t m_row_count{0};
+};
+
+} // namespace terminal
+
+} // namespace bte
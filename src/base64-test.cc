@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <string>
+
+#include <glib.h>
+
+#include "base64.hh"
+
+using namespace std::literals;
+using namespace bte::base;
+
+/* Decodes @str in pieces of @piece_len characters */
+static bool
+decode(std::string const& str,
+       size_t piece_len,
+       std::string& result)
+{
+        auto decoder = Base64Decoder{};
+        auto out = g_string_new(nullptr);
+        auto valid = true;
+        for (size_t i = 0; i < str.size() && valid; i += piece_len)
+                valid = decoder.decode(str.data() + i, std::min(piece_len, str.size() - i), out);
+
+        result.assign(out->str, out->len);
+        g_string_free(out, true);
+        return valid && decoder.finish();
+}
+
+static void
+assert_decodes(std::string const& str,
+               std::string const& expected)
+{
+        for (auto piece_len : {1, 2, 3, 5, 1024}) {
+                std::string result;
+                g_assert_true(decode(str, piece_len, result));
+                g_assert_true(result == expected);
+        }
+}
+
+static void
+assert_invalid(std::string const& str)
+{
+        for (auto piece_len : {1, 3, 1024}) {
+                std::string result;
+                g_assert_false(decode(str, piece_len, result));
+        }
+}
+
+static void
+test_base64_decode(void)
+{
+        assert_decodes(""s, ""s);
+        assert_decodes("Zg=="s, "f"s);
+        assert_decodes("Zm8="s, "fo"s);
+        assert_decodes("Zm9v"s, "foo"s);
+        assert_decodes("Zm9vYg=="s, "foob"s);
+        assert_decodes("Zm9vYmE="s, "fooba"s);
+        assert_decodes("Zm9vYmFy"s, "foobar"s);
+        assert_decodes("AP8Q/+/+"s, "\x00\xff\x10\xff\xef\xfe"s);
+
+        /* Without the padding */
+        assert_decodes("Zg"s, "f"s);
+        assert_decodes("Zm9vYmE"s, "fooba"s);
+}
+
+static void
+test_base64_invalid(void)
+{
+        assert_invalid("Z"s);
+        assert_invalid("Zm9vY"s);
+        assert_invalid("Zm9v\n"s);
+        assert_invalid("Zm-v"s);
+        assert_invalid("Z==="s);
+        assert_invalid("Zg==Zg=="s);
+        assert_invalid("Zg=a"s);
+        assert_invalid("Zg==="s);
+        assert_invalid("Zm9v\xc3\xa4"s);
+}
+
+static void
+test_base64_codepoints(void)
+{
+        auto const str = U"Zm9vYmFy"s;
+        auto decoder = Base64Decoder{};
+        auto out = g_string_new(nullptr);
+        g_assert_true(decoder.decode(str.data(), str.size(), out));
+        g_assert_true(decoder.finish());
+        g_assert_cmpstr(out->str, ==, "foobar");
+
+        /* Not base64, but the same value modulo 256 as 'A' */
+        decoder.reset();
+        g_assert_false(decoder.decode(U"ŁAAA", 4, out));
+        g_string_free(out, true);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/base64/decode", test_base64_decode);
+        g_test_add_func("/bte/base64/invalid", test_base64_invalid);
+        g_test_add_func("/bte/base64/codepoints", test_base64_codepoints);
+
+        return g_test_run();
+}
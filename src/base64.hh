@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <glib.h>
+
+namespace bte {
+
+namespace base {
+
+inline constexpr uint8_t const k_base64_padding = 64;
+inline constexpr uint8_t const k_base64_invalid = 0xff;
+
+/* The value of each base64 character, k_base64_padding for the padding,
+ * and k_base64_invalid for all other ASCII characters.
+ */
+static constexpr auto
+base64_make_values() noexcept
+{
+        std::array<uint8_t, 0x80> values{};
+        for (auto& value : values)
+                value = k_base64_invalid;
+        for (auto i = 0u; i < 26; ++i) {
+                values['A' + i] = i;
+                values['a' + i] = 26 + i;
+        }
+        for (auto i = 0u; i < 10; ++i)
+                values['0' + i] = 52 + i;
+        values['+'] = 62;
+        values['/'] = 63;
+        values['='] = k_base64_padding;
+        return values;
+}
+
+inline constexpr auto const k_base64_values = base64_make_values();
+
+/*
+ * A base64 decoder that takes its input in pieces, as it arrives, and
+ * appends the decoded bytes directly to the output string.
+ *
+ * The input may end in the middle of a group of 4 characters, or omit
+ * the padding, but there must be nothing but padding after padding.
+ */
+class Base64Decoder {
+public:
+        Base64Decoder() noexcept = default;
+        ~Base64Decoder() noexcept = default;
+
+        Base64Decoder(Base64Decoder const&) = delete;
+        Base64Decoder(Base64Decoder&&) = delete;
+        Base64Decoder& operator= (Base64Decoder const&) = delete;
+        Base64Decoder& operator= (Base64Decoder&&) = delete;
+
+        /* Decodes the @len characters at @data, which may be bytes or
+         * codepoints, and appends the bytes to @out.
+         *
+         * Returns: %false if the input is invalid
+         */
+        template<typename T>
+        bool decode(T const* data,
+                    size_t len,
+                    GString* out) noexcept
+        {
+                if (m_failed)
+                        return false;
+
+                /* Every 4 characters make at most 3 bytes */
+                auto const start = out->len;
+                g_string_set_size(out, start + (len + m_n_chars % 4) / 4 * 3 + 3);
+                auto p = reinterpret_cast<uint8_t*>(out->str) + start;
+
+                for (size_t i = 0; i < len; ++i) {
+                        auto const c = uint32_t(data[i]);
+                        auto const value = c < k_base64_values.size() ? k_base64_values[c] : k_base64_invalid;
+                        if (value == k_base64_padding && m_n_chars % 4 >= 2) {
+                                m_padded = true;
+                        } else if (value >= 64 || m_padded) {
+                                m_failed = true;
+                                break;
+                        } else {
+                                m_bits = (m_bits << 6) | value;
+                                m_n_bits += 6;
+                                if (m_n_bits >= 8) {
+                                        m_n_bits -= 8;
+                                        *p++ = uint8_t(m_bits >> m_n_bits);
+                                }
+                        }
+                        ++m_n_chars;
+                }
+
+                g_string_truncate(out, p - reinterpret_cast<uint8_t*>(out->str));
+                return !m_failed;
+        }
+
+        /* Returns: %true if all the input so far was valid, and complete */
+        inline constexpr bool finish() const noexcept
+        {
+                return !m_failed && m_n_chars % 4 != 1;
+        }
+
+        inline void reset() noexcept
+        {
+                m_bits = 0;
+                m_n_bits = 0;
+                m_n_chars = 0;
+                m_padded = false;
+                m_failed = false;
+        }
+
+private:
+        uint32_t m_bits{0};
+        unsigned int m_n_bits{0};
+        size_t m_n_chars{0};
+        bool m_padded{false};
+        bool m_failed{false};
+}; // class Base64Decoder
+
+} // namespace base
+
+} // namespace bte
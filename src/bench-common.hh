@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Helpers shared by the benchmarks that run a terminal widget */
+
+#pragma once
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <ctk/ctk.h>
+
+/* The exit status that makes meson report a skipped test */
+#define BENCH_EXIT_SKIP 77
+
+/* Initialises CTK and parses the options in @entries, like
+ * ctk_init_with_args(). Returns false, after saying why, when there is
+ * no display to run on; the benchmark should exit with BENCH_EXIT_SKIP.
+ */
+static inline bool
+bench_init(int* argc,
+           char*** argv,
+           char const* parameter_string,
+           GOptionEntry const* entries)
+{
+        auto error = (GError*)nullptr;
+        if (ctk_init_with_args(argc, argv, parameter_string, entries, nullptr, &error))
+                return true;
+
+        g_printerr("%s\n", error ? error->message : "Cannot open display");
+        g_clear_error(&error);
+        return false;
+}
+
+/* Returns the peak resident set size of the process so far, in kB */
+static inline long
+bench_peak_rss_kb(void)
+{
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+}
+
+/* Returns the current resident set size of the process, in kB */
+static inline long
+bench_rss_kb(void)
+{
+        auto size = 0L, resident = 0L;
+        auto file = fopen("/proc/self/statm", "r");
+        if (file) {
+                if (fscanf(file, "%ld %ld", &size, &resident) != 2)
+                        resident = 0;
+                fclose(file);
+        }
+        return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
@@ -43,6 +43,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #ifdef WITH_FRIBIDI
 #include <fribidi.h>
 #endif
@@ -100,6 +102,21 @@ BidiRow::set_width(bte::grid::column_t width)
         m_width = width;
 }
 
+/* Copy the mapping from another row, e.g. from the cache. */
+void
+BidiRow::copy_from(BidiRow const& o)
+{
+        set_width(o.m_width);
+        if (m_width > 0) {
+                memcpy (m_log2vis, o.m_log2vis, sizeof (uint16_t) * m_width);
+                memcpy (m_vis2log, o.m_vis2log, sizeof (uint16_t) * m_width);
+                memcpy (m_vis_rtl, o.m_vis_rtl, sizeof (uint8_t) * m_width);
+                memcpy (m_vis_shaped_base_char, o.m_vis_shaped_base_char, sizeof (gunichar) * m_width);
+        }
+        m_base_rtl = o.m_base_rtl;
+        m_has_foreign = o.m_has_foreign;
+}
+
 /* Converts from logical to visual column. Offscreen columns are mirrored
  * for RTL lines, e.g. (assuming 80 columns) -1 <=> 80, -2 <=> 81 etc. */
 bte::grid::column_t
@@ -186,6 +203,23 @@ is_arabic(gunichar c)
         return FRIBIDI_IS_ARABIC (fribidi_get_bidi_type (c));
 }
 
+/* Whether the character might make an LTR paragraph anything other than
+ * trivial LTR, or might need shaping. There's no such character below the
+ * Hebrew block, so most of the text is decided without a lookup. Combining
+ * sequences are conservatively assumed to be such. */
+static inline bool
+is_maybe_rtl(bteunistr c)
+{
+        if (G_LIKELY (c < 0x0590))
+                return false;
+        if (G_UNLIKELY (c > 0x10FFFF))
+                return true;
+
+        auto type = fribidi_get_bidi_type (c);
+        return FRIBIDI_IS_RTL (type) || FRIBIDI_IS_ARABIC (type) ||
+               FRIBIDI_IS_EXPLICIT (type) || FRIBIDI_IS_ISOLATE (type);
+}
+
 /* Perform Arabic shaping on an explicit line (which could be explicit LTR or explicit RTL),
  * using presentation form characters.
  *
@@ -356,6 +390,38 @@ BidiRunner::explicit_line(bte::grid::row_t row, bool rtl, bool do_shaping)
 #endif
 }
 
+/* Whether paragraph() would come up with the trivial LTR mapping for the paragraph
+ * between the given rows, so that FriBidi doesn't need to be run. This is the
+ * case if its base direction is LTR and it doesn't contain any character that
+ * could change that or would need shaping. */
+bool
+BidiRunner::paragraph_is_ltr(bte::grid::row_t start, bte::grid::row_t end,
+                             bool do_bidi, bool do_shaping) const
+{
+        const BteRowData *row_data = m_ringview->get_row(start);
+
+        if (G_UNLIKELY (m_ringview->get_width() > G_MAXUSHORT))
+                return true;
+
+        if (do_bidi && (row_data->attr.bidi_flags & BTE_BIDI_FLAG_RTL))
+                return false;
+
+        if (!(do_bidi && (row_data->attr.bidi_flags & BTE_BIDI_FLAG_IMPLICIT)) && !do_shaping)
+                return true;
+
+#ifdef WITH_FRIBIDI
+        for (; start < end; start++) {
+                row_data = m_ringview->get_row(start);
+                for (int i = 0; i < row_data->len; i++) {
+                        if (G_UNLIKELY (is_maybe_rtl(row_data->cells[i].c)))
+                                return false;
+                }
+        }
+#endif
+
+        return true;
+}
+
 /* Figure out the mapping for the paragraph between the given rows. */
 void
 BidiRunner::paragraph(bte::grid::row_t start, bte::grid::row_t end,
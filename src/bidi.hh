@@ -35,6 +35,7 @@ class RingView;
 /* BidiRow contains the BiDi transformation of a single row. */
 class BidiRow {
         friend class BidiRunner;
+        friend class RingView;
 
 public:
         BidiRow() { }
@@ -63,6 +64,7 @@ public:
 
 private:
         void set_width(bte::grid::column_t width);
+        void copy_from(BidiRow const& o);
 
         /* The value of m_width == 0 is a valid representation of the trivial LTR mapping. */
         uint16_t m_width{0};
@@ -93,6 +95,8 @@ public:
         BidiRunner& operator= (BidiRunner const& o) = delete;
         BidiRunner& operator= (BidiRunner&& o) = delete;
 
+        bool paragraph_is_ltr(bte::grid::row_t start, bte::grid::row_t end,
+                              bool do_bidi, bool do_shaping) const;
         void paragraph(bte::grid::row_t start, bte::grid::row_t end,
                        bool do_bidi, bool do_shaping);
 
@@ -39,10 +39,13 @@
 #include "bidi.hh"
 #include "buffer.h"
 #include "debug.h"
+#include "html-export.hh"
+#include "trace.hh"
 #include "reaper.hh"
 #include "ring.hh"
 #include "ringview.hh"
 #include "caps.hh"
+#include "unicode-width.hh"
 #include "widget.hh"
 
 #ifdef HAVE_WCHAR_H
@@ -54,6 +57,9 @@
 #ifdef HAVE_SYS_WAIT_H
 #include <sys/wait.h>
 #endif
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
 #include <glib.h>
 #include <glib-object.h>
 #include <cdk/cdk.h>
@@ -93,7 +99,7 @@ static inline double round(double x) {
 namespace bte {
 namespace terminal {
 
-static int _bte_unichar_width(gunichar c, int utf8_ambiguous_width);
+static inline int _bte_unichar_width(gunichar c, int utf8_ambiguous_width);
 static void stop_processing(bte::terminal::Terminal* that);
 static void add_process_timeout(bte::terminal::Terminal* that);
 static void add_update_timeout(bte::terminal::Terminal* that);
@@ -110,20 +116,12 @@ static guint update_timeout_tag = 0;
 static gboolean in_update_timeout;
 static GList *g_active_terminals;
 
-static int
+static inline int
 _bte_unichar_width(gunichar c, int utf8_ambiguous_width)
 {
         if (G_LIKELY (c < 0x80))
                 return 1;
-        if (G_UNLIKELY (g_unichar_iszerowidth (c)))
-                return 0;
-        if (G_UNLIKELY (g_unichar_iswide (c)))
-                return 2;
-        if (G_LIKELY (utf8_ambiguous_width == 1))
-                return 1;
-        if (G_UNLIKELY (g_unichar_iswide_cjk (c)))
-                return 2;
-        return 1;
+        return bte::base::unicode_width(c, utf8_ambiguous_width);
 }
 
 static void
@@ -271,6 +269,8 @@ void
 Terminal::invalidate_rows(bte::grid::row_t row_start,
                           bte::grid::row_t row_end /* inclusive */)
 {
+        accessible_damage_rows(row_start, row_end + 1);
+
 	if (G_UNLIKELY (!widget_realized()))
                 return;
 
@@ -292,7 +292,7 @@ Terminal::invalidate_rows(bte::grid::row_t row_start,
         /* Recognize if we're about to invalidate everything. */
         if (row_start <= first_displayed_row() &&
             row_end >= last_displayed_row()) {
-		invalidate_all();
+		invalidate_view();
 		return;
 	}
 
@@ -315,6 +315,8 @@ Terminal::invalidate_rows(bte::grid::row_t row_start,
 			"Invalidating pixels at (%d,%d)x(%d,%d).\n",
 			rect.x, rect.y, rect.width, rect.height);
 
+        ++m_statistics.invalidated_rects;
+
 	if (m_active_terminals_link != nullptr) {
                 g_array_append_val(m_update_rects, rect);
 		/* Wait a bit before doing any invalidation, just in
@@ -345,6 +347,8 @@ void
 Terminal::invalidate_rows_and_context(bte::grid::row_t row_start,
                                       bte::grid::row_t row_end /* inclusive */)
 {
+        accessible_damage_rows(row_start, row_end + 1);
+
         if (G_UNLIKELY (!widget_realized()))
                 return;
 
@@ -442,8 +446,23 @@ Terminal::invalidate_symmetrical_difference(bte::grid::span const& a, bte::grid:
         }
 }
 
+/* Invalidate everything, including for the accessible. */
 void
 Terminal::invalidate_all()
+{
+#ifdef WITH_A11Y
+        m_accessible_damage.damage_all();
+#endif
+
+        invalidate_view();
+}
+
+/* Redraw the whole view, when the text itself didn't change, or the changed
+ * rows have been recorded for the accessible already, e.g. after scrolling
+ * (the accessible follows the scrolling by itself), blinking or a change of
+ * colours. */
+void
+Terminal::invalidate_view()
 {
 	if (G_UNLIKELY (!widget_realized()))
                 return;
@@ -458,6 +477,7 @@ Terminal::invalidate_all()
 	/* replace invalid regions with one covering the whole terminal */
 	reset_update_rects();
 	m_invalidated_all = TRUE;
+        ++m_statistics.invalidated_rects;
 
         if (m_active_terminals_link != nullptr) {
                 auto allocation = get_allocated_rect();
@@ -2051,7 +2071,7 @@ Terminal::set_encoding(char const* charset,
          * the outgooing and only change charsets once it's empty.)
          * Do not clear the incoming queue.
          */
-        _bte_byte_array_clear(m_outgoing);
+        outgoing_clear();
 
         reset_decoder();
 
@@ -2082,6 +2102,24 @@ Terminal::set_cjk_ambiguous_width(int width)
         return true;
 }
 
+/*
+ * Terminal::set_clipboard_write_limit:
+ * @limit: the maximum size in bytes of the data of OSC 52, or 0
+ *
+ * Sets the maximum size of the data that OSC 52 may put on the clipboard;
+ * 0 disables OSC 52. A write that is in progress is dropped.
+ */
+bool
+Terminal::set_clipboard_write_limit(size_t limit)
+{
+        if (m_clipboard_write_limit == limit)
+                return false;
+
+        clipboard_write_reset();
+        m_clipboard_write_limit = limit;
+        return true;
+}
+
 // FIXMEchpe replace this with a method on BteRing
 BteRowData *
 Terminal::insert_rows (guint cnt)
@@ -2250,7 +2288,7 @@ Terminal::set_color(int entry,
 	if (entry == BTE_CURSOR_BG || entry == BTE_CURSOR_FG)
 		invalidate_cursor_once();
 	else
-		invalidate_all();
+		invalidate_view();
 }
 
 void
@@ -2279,7 +2317,7 @@ Terminal::reset_color(int entry,
 	if (entry == BTE_CURSOR_BG || entry == BTE_CURSOR_FG)
 		invalidate_cursor_once();
 	else
-		invalidate_all();
+		invalidate_view();
 }
 
 bool
@@ -2294,7 +2332,7 @@ Terminal::set_background_alpha(double alpha)
                          "Setting background alpha to %.3f\n", alpha);
         m_background_alpha = alpha;
 
-        invalidate_all();
+        invalidate_view();
 
         return true;
 }
@@ -3213,7 +3251,7 @@ Terminal::connect_pty_write()
         g_warn_if_fail(m_input_enabled);
 
         /* Anything to write? */
-        if (_bte_byte_array_length(m_outgoing) == 0)
+        if (m_outgoing_queue.empty() && m_paste_queue.empty())
                 return;
 
         /* Do one write. FIXMEchpe why? */
@@ -3331,6 +3369,12 @@ Terminal::im_reset()
 void
 Terminal::process_incoming()
 {
+        /* The selections must be rendered before the contents change */
+        clipboard_materialize();
+
+        auto const start = g_get_monotonic_time();
+        auto const processed = m_statistics.bytes_processed.sum();
+
         switch (data_syntax()) {
         case DataSyntax::eECMA48_UTF8:   process_incoming_utf8();    break;
 #ifdef WITH_ICU
@@ -3338,6 +3382,11 @@ Terminal::process_incoming()
 #endif
         default: g_assert_not_reached(); break;
         }
+
+        m_statistics.process_time.record(g_get_monotonic_time() - start);
+
+        bte::base::ScrollbackBudget::get().processed(m_statistics.bytes_processed.sum() - processed);
+        note_activity();
 }
 
 
@@ -3361,6 +3410,7 @@ Terminal::process_incoming_utf8()
                          m_input_bytes,
                          m_incoming_queue.size());
 	_bte_debug_print (BTE_DEBUG_WORK, "(");
+        _BTE_TRACE(process_incoming_utf8__start, m_input_bytes);
 
         auto previous_screen = m_screen;
 
@@ -3433,6 +3483,8 @@ Terminal::process_incoming_utf8()
                                         break;
                                 }
 
+                                ++m_statistics.sequences[rv];
+
 #ifdef BTE_DEBUG
                                 if (rv != BTE_SEQ_NONE)
                                         g_assert((bool)seq);
@@ -3486,7 +3538,19 @@ Terminal::process_incoming_utf8()
                                         break;
                                 }
 
-                                case BTE_SEQ_NONE:
+                                case BTE_SEQ_NONE: {
+                                        /* Take the rest of an OSC or DCS string in bulk */
+                                        if (!m_parser.in_string())
+                                                break;
+
+                                        auto const n = m_parser.feed_string(ip + 1, iend - ip - 1);
+                                        m_statistics.sequences[BTE_SEQ_NONE] += n;
+                                        ip += n;
+                                        if (n != 0 && m_parser.in_osc_string())
+                                                clipboard_write_stream();
+                                        break;
+                                }
+
                                 case BTE_SEQ_IGNORE:
                                         break;
 
@@ -3567,15 +3631,8 @@ Terminal::process_incoming_utf8()
 		/* Deselect the current selection if its contents are changed
 		 * by this insertion. */
                 if (!m_selection_resolved.empty()) {
-                        //FIXMEchpe: this is atrocious
-			auto selection = get_selected_text();
-			if ((selection == nullptr) ||
-			    (m_selection[BTE_SELECTION_PRIMARY] == nullptr) ||
-			    (strcmp(selection->str, m_selection[BTE_SELECTION_PRIMARY]->str) != 0)) {
+			if (!selected_text_equals(m_selection[BTE_SELECTION_PRIMARY].text))
 				deselect_all();
-			}
-                        if (selection)
-                                g_string_free(selection, TRUE);
 		}
 	}
 
@@ -3612,6 +3669,9 @@ Terminal::process_incoming_utf8()
         /* After processing some data, do a hyperlink GC. The multiplier is totally arbitrary, feel free to fine tune. */
         _bte_ring_hyperlink_maybe_gc(m_screen->row_data, bytes_processed * 8);
 
+        m_statistics.bytes_processed.record(bytes_processed);
+        _BTE_TRACE(process_incoming_utf8__done, bytes_processed);
+
 	_bte_debug_print (BTE_DEBUG_WORK, ")");
 	_bte_debug_print (BTE_DEBUG_IO,
                           "%" G_GSIZE_FORMAT " bytes in %" G_GSIZE_FORMAT " chunks left to process.\n",
@@ -3641,6 +3701,7 @@ Terminal::process_incoming_pcterm()
                          m_input_bytes,
                          m_incoming_queue.size());
 	_bte_debug_print (BTE_DEBUG_WORK, "(");
+        _BTE_TRACE(process_incoming_pcterm__start, m_input_bytes);
 
         auto previous_screen = m_screen;
 
@@ -3707,6 +3768,8 @@ Terminal::process_incoming_pcterm()
                                         break;
                                 }
 
+                                ++m_statistics.sequences[rv];
+
 #ifdef BTE_DEBUG
                                 if (rv != BTE_SEQ_NONE)
                                         g_assert((bool)seq);
@@ -3852,15 +3915,8 @@ Terminal::process_incoming_pcterm()
 		/* Deselect the current selection if its contents are changed
 		 * by this insertion. */
                 if (!m_selection_resolved.empty()) {
-                        //FIXMEchpe: this is atrocious
-			auto selection = get_selected_text();
-			if ((selection == nullptr) ||
-			    (m_selection[BTE_SELECTION_PRIMARY] == nullptr) ||
-			    (strcmp(selection->str, m_selection[BTE_SELECTION_PRIMARY]->str) != 0)) {
+			if (!selected_text_equals(m_selection[BTE_SELECTION_PRIMARY].text))
 				deselect_all();
-			}
-                        if (selection)
-                                g_string_free(selection, TRUE);
 		}
 	}
 
@@ -3897,6 +3953,9 @@ Terminal::process_incoming_pcterm()
         /* After processing some data, do a hyperlink GC. The multiplier is totally arbitrary, feel free to fine tune. */
         _bte_ring_hyperlink_maybe_gc(m_screen->row_data, bytes_processed * 8);
 
+        m_statistics.bytes_processed.record(bytes_processed);
+        _BTE_TRACE(process_incoming_pcterm__done, bytes_processed);
+
 	_bte_debug_print (BTE_DEBUG_WORK, ")");
 	_bte_debug_print (BTE_DEBUG_IO,
                           "%" G_GSIZE_FORMAT " bytes in %" G_GSIZE_FORMAT " chunks left to process.\n",
@@ -3912,6 +3971,7 @@ Terminal::pty_io_read(int const fd,
 {
 	_bte_debug_print (BTE_DEBUG_WORK, ".");
         _bte_debug_print(BTE_DEBUG_IO, "::pty_io_read condition %02x\n", condition);
+        _BTE_TRACE_SCOPE(pty_io_read);
 
         /* We need to check for EOS so that we can shut down the PTY.
          * When we get G_IO_HUP without G_IO_IN, we can process the EOF now.
@@ -4021,6 +4081,8 @@ Terminal::pty_io_read(int const fd,
 out:
 			chunk->len += len;
 			bytes += len;
+                        m_statistics.bytes_read += len;
+                        _BTE_TRACE(pty_read, fd, len);
 		} while (bytes < max_bytes &&
 		         chunk->len == chunk->capacity());
 
@@ -4138,30 +4200,87 @@ bool
 Terminal::pty_io_write(int const fd,
                        GIOCondition const condition)
 {
-        auto const count = write(fd,
-                                 m_outgoing->data,
-                                 _bte_byte_array_length(m_outgoing));
-	if (count != -1) {
+        /* Pull in more of a paste in progress, and the input behind it,
+         * but only as much as the child is going to take soon. */
+        while (!m_paste_queue.empty() && m_outgoing_bytes < BTE_OUTGOING_LOW_WATER)
+                paste_pull();
+
+        while (!m_outgoing_queue.empty()) {
+                auto const& chunk = m_outgoing_queue.front();
+                auto const len = chunk->len - m_outgoing_offset;
+                auto const count = write(fd,
+                                         chunk->data + m_outgoing_offset,
+                                         len);
+                if (count == -1)
+                        break;
+
 		_BTE_DEBUG_IF (BTE_DEBUG_IO) {
                         _bte_debug_hexdump("Outgoing buffer written",
-                                           (uint8_t const*)m_outgoing->data,
+                                           chunk->data + m_outgoing_offset,
                                            count);
 		}
-		_bte_byte_array_consume(m_outgoing, count);
-	}
+
+                m_outgoing_bytes -= count;
+                if (size_t(count) < len) {
+                        /* The child doesn't take more for now */
+                        m_outgoing_offset += count;
+                        break;
+                }
+
+                m_outgoing_queue.pop();
+                m_outgoing_offset = 0;
+        }
 
         /* Run again if there are more bytes to write */
-        return _bte_byte_array_length(m_outgoing) != 0;
+        return !m_outgoing_queue.empty() || !m_paste_queue.empty();
 }
 
-/* Send some UTF-8 data to the child. */
+/* Append data to the output queue, without any conversion. */
 void
-Terminal::send_child(std::string_view const& data)
+Terminal::outgoing_append(std::string_view const& data)
 {
-        // FIXMEchpe remove
-        if (!m_input_enabled)
+        auto length = data.size();
+        auto ptr = data.data();
+
+        m_outgoing_bytes += length;
+
+        while (length > 0) {
+                if (m_outgoing_queue.empty() ||
+                    m_outgoing_queue.back()->remaining_capacity() == 0)
+                        m_outgoing_queue.push(bte::base::Chunk::get());
+
+                auto chunk = m_outgoing_queue.back().get();
+                auto const len = std::min(length, chunk->remaining_capacity());
+                memcpy(chunk->data + chunk->len, ptr, len);
+                chunk->len += len;
+                ptr += len;
+                length -= len;
+        }
+}
+
+/* Discard the output queue, and the rest of a paste in progress and the
+ * input behind it, except for the closing bracket of a bracketed paste. */
+void
+Terminal::outgoing_clear()
+{
+        m_outgoing_queue = {};
+        m_outgoing_offset = 0;
+        m_outgoing_bytes = 0;
+
+        auto const rest = m_paste_queue.cancel();
+        if (rest.empty() || !pty())
                 return;
 
+        queue_child(rest);
+        if (m_input_enabled)
+                connect_pty_write();
+}
+
+/* Convert some UTF-8 data to the child's encoding, and queue it for the
+ * child. Also emits ::commit. */
+void
+Terminal::queue_child(std::string_view const& data)
+{
         /* Note that for backward compatibility, we need to emit the
          * ::commit signal even if there is no PTY. See issue bte#222.
          */
@@ -4170,7 +4289,7 @@ Terminal::send_child(std::string_view const& data)
         case DataSyntax::eECMA48_UTF8:
                 emit_commit(data);
                 if (pty())
-                        _bte_byte_array_append(m_outgoing, data.data(), data.size());
+                        outgoing_append(data);
                 break;
 
 #ifdef WITH_ICU
@@ -4179,7 +4298,7 @@ Terminal::send_child(std::string_view const& data)
 
                 emit_commit(converted);
                 if (pty())
-                        _bte_byte_array_append(m_outgoing, converted.data(), converted.size());
+                        outgoing_append(converted);
                 break;
         }
 #endif
@@ -4188,6 +4307,22 @@ Terminal::send_child(std::string_view const& data)
                 g_assert_not_reached();
                 return;
         }
+}
+
+/* Send some UTF-8 data to the child. */
+void
+Terminal::send_child(std::string_view const& data)
+{
+        // FIXMEchpe remove
+        if (!m_input_enabled)
+                return;
+
+        /* Keep the order with a paste that's still in progress, without
+         * converting all of it now. */
+        if (!m_paste_queue.empty())
+                m_paste_queue.push(bte::terminal::PasteQueue::Output::eText, data);
+        else
+                queue_child(data);
 
         /* If we need to start waiting for the child pty to
          * become available for writing, set that up here. */
@@ -4231,8 +4366,14 @@ Terminal::feed_child_binary(std::string_view const& data)
         if (!pty())
                 return;
 
-        emit_commit(data);
-        _bte_byte_array_append(m_outgoing, data.data(), data.size());
+        /* Keep the order with a paste that's still in progress, without
+         * converting all of it now. */
+        if (!m_paste_queue.empty()) {
+                m_paste_queue.push(bte::terminal::PasteQueue::Output::eBinary, data);
+        } else {
+                emit_commit(data);
+                outgoing_append(data);
+        }
 
         /* If we need to start waiting for the child pty to
          * become available for writing, set that up here. */
@@ -5441,13 +5582,12 @@ Terminal::cell_is_selected_vis(bte::grid::column_t vcol,
 void
 Terminal::widget_paste_received(char const* text)
 {
-	gchar *paste, *p;
-        gsize run;
-        unsigned char c;
-
 	if (text == nullptr)
                 return;
 
+        if (!m_input_enabled)
+                return;
+
         gsize len = strlen(text);
         _bte_debug_print(BTE_DEBUG_SELECTION,
                          "Pasting %" G_GSIZE_FORMAT " UTF-8 bytes.\n", len);
@@ -5457,56 +5597,46 @@ Terminal::widget_paste_received(char const* text)
                 return;
         }
 
-        /* Convert newlines to carriage returns, which more software
-         * is able to cope with (cough, pico, cough).
-         * Filter out control chars except HT, CR (even stricter than xterm).
-         * Also filter out C1 controls: U+0080 (0xC2 0x80) - U+009F (0xC2 0x9F). */
-        p = paste = (gchar *) g_malloc(len + 1);
-        while (p != nullptr && text[0] != '\0') {
-                run = strcspn(text, "\x01\x02\x03\x04\x05\x06\x07"
-                              "\x08\x0A\x0B\x0C\x0E\x0F"
-                              "\x10\x11\x12\x13\x14\x15\x16\x17"
-                              "\x18\x19\x1A\x1B\x1C\x1D\x1E\x1F"
-                              "\x7F\xC2");
-                memcpy(p, text, run);
-                p += run;
-                text += run;
-                switch (text[0]) {
-                case '\x00':
-                        break;
-                case '\x0A':
-                        *p = '\x0D';
-                        p++;
-                        text++;
-                        break;
-                case '\xC2':
-                        c = text[1];
-                        if (c >= 0x80 && c <= 0x9F) {
-                                /* Skip both bytes of a C1 */
-                                text += 2;
-                        } else {
-                                /* Move along, nothing to see here */
-                                *p = '\xC2';
-                                p++;
-                                text++;
-                        }
-                        break;
-                default:
-                        /* Swallow this byte */
-                        text++;
-                        break;
-                }
+        /* The text is only converted and queued for the child as the child
+         * consumes it, after any previous paste, see paste_pull(). Without a
+         * PTY, there's nothing to wait for. */
+        m_paste_queue.paste(std::string{text, len},
+                            m_modes_private.XTERM_READLINE_BRACKETED_PASTE());
+        if (pty())
+                connect_pty_write();
+        else
+                paste_flush();
+}
+
+/* Convert the next bit of the paste in progress, or take the next input
+ * behind it, and queue it for the child. */
+void
+Terminal::paste_pull()
+{
+        using Output = bte::terminal::PasteQueue::Output;
+
+        std::string data;
+        switch (m_paste_queue.pull(data)) {
+        case Output::eText:
+                if (!data.empty())
+                        queue_child(data);
+                break;
+        case Output::eBinary:
+                emit_commit(data);
+                if (pty())
+                        outgoing_append(data);
+                break;
+        case Output::eNone:
+                break;
         }
+}
 
-        bool const bracketed_paste = m_modes_private.XTERM_READLINE_BRACKETED_PASTE();
-        // FIXMEchpe can we not hardcode C0 controls here?
-        if (bracketed_paste)
-                feed_child("\e[200~"sv);
-        // FIXMEchpe add a way to avoid the extra string copy done here
-        feed_child(paste, p - paste);
-        if (bracketed_paste)
-                feed_child("\e[201~"sv);
-        g_free(paste);
+/* Queue all of the paste in progress, and the input behind it, for the child. */
+void
+Terminal::paste_flush()
+{
+        while (!m_paste_queue.empty())
+                paste_pull();
 }
 
 bool
@@ -6019,41 +6149,47 @@ Terminal::widget_clipboard_requested(CtkClipboard *target_clipboard,
                                                guint info)
 {
 	for (auto sel = 0; sel < LAST_BTE_SELECTION; sel++) {
-		if (target_clipboard == m_clipboard[sel] &&
-                    m_selection[sel] != nullptr) {
-			_BTE_DEBUG_IF(BTE_DEBUG_SELECTION) {
-				int i;
-				g_printerr("Setting selection %d (%" G_GSIZE_FORMAT " UTF-8 bytes.) for target %s\n",
-                                           sel,
-                                           m_selection[sel]->len,
-                                           cdk_atom_name(ctk_selection_data_get_target(data)));
-                                char const* selection_text = m_selection[sel]->str;
-                                for (i = 0; selection_text[i] != '\0'; i++) {
-                                        g_printerr("0x%04x ", selection_text[i]);
-                                        if ((i & 0x7) == 0x7)
-                                                g_printerr("\n");
-				}
-                                g_printerr("\n");
-			}
-			if (info == BTE_TARGET_TEXT) {
-				ctk_selection_data_set_text(data,
-                                                            m_selection[sel]->str,
-                                                            m_selection[sel]->len);
-			} else if (info == BTE_TARGET_HTML) {
-				gsize len;
-                                auto selection = text_to_utf16_mozilla(m_selection[sel], &len);
-                                // FIXMEchpe this makes yet another copy of the data... :(
-                                if (selection)
-                                        ctk_selection_data_set(data,
-                                                               cdk_atom_intern_static_string("text/html"),
-                                                               16,
-                                                               (const guchar *)selection,
-                                                               len);
-				g_free(selection);
-			} else {
-                                /* Not reached */
+		if (target_clipboard != m_clipboard[sel])
+                        continue;
+
+                /* Only render the requested target */
+                auto const format = info == BTE_TARGET_HTML ? BTE_FORMAT_HTML : BTE_FORMAT_TEXT;
+                auto const selection = clipboard_contents(BteSelection(sel), format);
+                if (selection == nullptr)
+                        continue;
+
+                _BTE_DEBUG_IF(BTE_DEBUG_SELECTION) {
+                        int i;
+                        g_printerr("Setting selection %d (%" G_GSIZE_FORMAT " UTF-8 bytes.) for target %s\n",
+                                   sel,
+                                   selection->len,
+                                   cdk_atom_name(ctk_selection_data_get_target(data)));
+                        char const* selection_text = selection->str;
+                        for (i = 0; selection_text[i] != '\0'; i++) {
+                                g_printerr("0x%04x ", selection_text[i]);
+                                if ((i & 0x7) == 0x7)
+                                        g_printerr("\n");
                         }
-		}
+                        g_printerr("\n");
+                }
+                if (info == BTE_TARGET_TEXT) {
+                        ctk_selection_data_set_text(data,
+                                                    selection->str,
+                                                    selection->len);
+                } else if (info == BTE_TARGET_HTML) {
+                        gsize len;
+                        auto html = text_to_utf16_mozilla(selection, &len);
+                        // FIXMEchpe this makes yet another copy of the data... :(
+                        if (html)
+                                ctk_selection_data_set(data,
+                                                       cdk_atom_intern_static_string("text/html"),
+                                                       16,
+                                                       (const guchar *)html,
+                                                       len);
+                        g_free(html);
+                } else {
+                        /* Not reached */
+                }
 	}
 }
 
@@ -6287,6 +6423,22 @@ Terminal::get_text_displayed_a11y(bool wrap,
                         attributes);
 }
 
+/* Like get_text_displayed_a11y(), but only for the rows from @start_row to
+ * @end_row (exclusive). Concatenating the text of adjacent row ranges gives
+ * the text of the entire range.
+ */
+GString*
+Terminal::get_text_displayed_a11y_rows(bte::grid::row_t start_row,
+                                       bte::grid::row_t end_row,
+                                       bool wrap,
+                                       GArray *attributes)
+{
+        return get_text(start_row, 0,
+                        end_row, 0,
+                        false /* block */, wrap,
+                        attributes);
+}
+
 GString*
 Terminal::get_selected_text(GArray *attributes)
 {
@@ -6343,172 +6495,331 @@ bte_terminal_cellattr_equal(BteCellAttr const* attr1,
                 attr1->hyperlink_idx  == attr2->hyperlink_idx);
 }
 
-/*
- * Wraps a given string according to the BteCellAttr in HTML tags. Used
- * old-style HTML (and not CSS) for better compatibility with, for example,
- * evolution's mail editor component.
- */
-char *
-Terminal::cellattr_to_html(BteCellAttr const* attr,
-                                     char const* text) const
+void
+Terminal::stream_text(bte::grid::row_t start_row,
+                      bte::grid::column_t start_col,
+                      bte::grid::row_t end_row,
+                      bte::grid::column_t end_col,
+                      bool block,
+                      TextSink& sink)
 {
-	GString *string;
-        guint fore, back, deco;
+        std::unique_ptr<bte::base::RingView> ringview;
+        bte::base::BidiRow const *bidirow = nullptr;
+
+        if (start_col < 0)
+                start_col = 0;
+
+        if (m_enable_bidi && block) {
+                /* See get_text() */
+                ringview = std::make_unique<bte::base::RingView>();
+                ringview->set_ring(m_screen->row_data);
+                ringview->set_rows(start_row, end_row - start_row + 1);
+                ringview->set_width(m_column_count);
+                ringview->update();
+        }
 
-	string = g_string_new(text);
+        /* The text of one row, and the start offsets and attributes of its runs.
+         * Only these are kept in memory, not the whole range.
+         */
+        auto row_text = g_string_sized_new(m_column_count + 1);
+        auto runs = std::vector<std::pair<gsize, BteCellAttr const*>>{};
+        runs.reserve(16);
 
-        determine_colors(attr, false, false, &fore, &back, &deco);
+        bte::grid::column_t lcol = block ? 0 : start_col;
+        for (auto row = start_row; row < end_row + 1; row++, lcol = 0) {
+                auto const row_data = find_row_data(row);
+                auto const line_last_column = (!block && row == end_row) ? end_col : m_column_count;
+                BteCell const* pcell = nullptr;
 
-	if (attr->bold()) {
-		g_string_prepend(string, "<b>");
-		g_string_append(string, "</b>");
-	}
-	if (attr->italic()) {
-		g_string_prepend(string, "<i>");
-		g_string_append(string, "</i>");
-	}
-        /* <u> should be inside <font> so that it inherits its color by default */
-        if (attr->underline() != 0) {
-                static const char styles[][7] = {"", "single", "double", "wavy"};
-                char *tag, *colorattr;
+                g_string_truncate(row_text, 0);
+                runs.clear();
+                auto last_empty = gsize{0}, last_nonempty = gsize{0};
+                auto last_emptycol = bte::grid::column_t{-1};
 
-                if (deco != BTE_DEFAULT_FG) {
-                        bte::color::rgb color;
+                if (row_data != nullptr) {
+                        bidirow = ringview ? ringview->get_bidirow(row) : nullptr;
+                        while (lcol < line_last_column &&
+                               (pcell = _bte_row_data_get (row_data, lcol))) {
 
-                        rgb_from_index<4, 5, 4>(deco, color);
-                        colorattr = g_strdup_printf(";text-decoration-color:#%02X%02X%02X",
-                                                    color.red >> 8,
-                                                    color.green >> 8,
-                                                    color.blue >> 8);
-                } else {
-                        colorattr = g_strdup("");
+                                if (bidirow) {
+                                        auto const vcol = bidirow->log2vis(lcol);
+                                        if (vcol < start_col || vcol >= end_col) {
+                                                lcol++;
+                                                continue;
+                                        }
+                                }
+
+                                if (!pcell->attr.fragment()) {
+                                        if (runs.empty() ||
+                                            !bte_terminal_cellattr_equal(runs.back().second, &pcell->attr))
+                                                runs.emplace_back(row_text->len, &pcell->attr);
+
+                                        if (pcell->c == 0) {
+                                                /* See get_text() */
+                                                g_string_append_c(row_text, ' ');
+                                                last_empty = row_text->len;
+                                                last_emptycol = lcol;
+                                        } else {
+                                                _bte_unistr_append_to_string(pcell->c, row_text);
+                                                last_nonempty = row_text->len;
+                                        }
+                                }
+
+                                lcol++;
+                        }
+                }
+
+                /* Strip off the trailing empty cells, like get_text() does */
+                if (last_empty > last_nonempty) {
+                        lcol = last_emptycol + 1;
+
+                        if (row_data != nullptr) {
+                                while ((pcell = _bte_row_data_get (row_data, lcol))) {
+                                        lcol++;
+
+                                        if (pcell->attr.fragment())
+                                                continue;
+
+                                        if (pcell->c != 0)
+                                                break;
+                                }
+                        }
+                        if (pcell == nullptr) {
+                                g_string_truncate(row_text, last_nonempty);
+                                while (!runs.empty() && runs.back().first >= last_nonempty)
+                                        runs.pop_back();
+                        }
+                }
+
+                auto const n_runs = runs.size();
+                for (auto i = size_t{0}; i < n_runs; ++i) {
+                        auto const start = runs[i].first;
+                        auto const end = i + 1 < n_runs ? runs[i + 1].first : row_text->len;
+                        sink.append(row_text->str + start, end - start, runs[i].second);
+                }
+
+                if (block ||
+                    (row < end_row && !m_screen->row_data->is_soft_wrapped(row)))
+                        sink.append("\n", 1, nullptr);
+        }
+
+        g_string_free(row_text, true);
+}
+
+void
+Terminal::stream_selected_text(TextSink& sink)
+{
+        stream_text(m_selection_resolved.start_row(),
+                    m_selection_resolved.start_column(),
+                    m_selection_resolved.end_row(),
+                    m_selection_resolved.end_column(),
+                    m_selection_block_mode,
+                    sink);
+}
+
+namespace {
+
+class StringTextSink final : public TextSink {
+public:
+        explicit StringTextSink(GString* string) noexcept : m_string{string} { }
+
+        void append(char const* text,
+                    size_t len,
+                    BteCellAttr const* attr) override
+        {
+                g_string_append_len(m_string, text, len);
+        }
+
+private:
+        GString* m_string;
+}; // class StringTextSink
+
+/* Compares the streamed text to a string, without building the whole text */
+class CompareTextSink final : public TextSink {
+public:
+        explicit CompareTextSink(GString const* string) noexcept : m_string{string} { }
+
+        void append(char const* text,
+                    size_t len,
+                    BteCellAttr const* attr) override
+        {
+                if (!m_equal)
+                        return;
+
+                if (len > m_string->len - m_offset ||
+                    memcmp(m_string->str + m_offset, text, len) != 0)
+                        m_equal = false;
+                else
+                        m_offset += len;
+        }
+
+        auto equal() const noexcept { return m_equal && m_offset == m_string->len; }
+
+private:
+        GString const* m_string;
+        gsize m_offset{0};
+        bool m_equal{true};
+}; // class CompareTextSink
+
+class HtmlTextSink final : public TextSink {
+public:
+        HtmlTextSink(Terminal const& terminal,
+                     GString* string)
+                : m_terminal{terminal},
+                  m_exporter{string,
+                             [&terminal](uint32_t index,
+                                         bool deco) -> uint32_t {
+                                     bte::color::rgb color;
+                                     if (deco)
+                                             terminal.rgb_from_index<4, 5, 4>(index, color);
+                                     else
+                                             terminal.rgb_from_index<8, 8, 8>(index, color);
+                                     return (color.red >> 8) << 16 | (color.green >> 8) << 8 | (color.blue >> 8);
+                             }}
+        {
+        }
+
+        void append(char const* text,
+                    size_t len,
+                    BteCellAttr const* attr) override
+        {
+                if (attr == nullptr) {
+                        m_exporter.newline();
+                        return;
                 }
 
-                tag = g_strdup_printf("<u style=\"text-decoration-style:%s%s\">",
-                                      styles[attr->underline()],
-                                      colorattr);
-                g_string_prepend(string, tag);
-                g_free(tag);
-                g_free(colorattr);
-                g_string_append(string, "</u>");
-        }
-	if (fore != BTE_DEFAULT_FG || attr->reverse()) {
-		bte::color::rgb color;
-                char *tag;
-
-                rgb_from_index<8, 8, 8>(fore, color);
-		tag = g_strdup_printf("<font color=\"#%02X%02X%02X\">",
-                                      color.red >> 8,
-                                      color.green >> 8,
-                                      color.blue >> 8);
-		g_string_prepend(string, tag);
-		g_free(tag);
-		g_string_append(string, "</font>");
-	}
-	if (back != BTE_DEFAULT_BG || attr->reverse()) {
-		bte::color::rgb color;
-                char *tag;
-
-                rgb_from_index<8, 8, 8>(back, color);
-		tag = g_strdup_printf("<span style=\"background-color:#%02X%02X%02X\">",
-                                      color.red >> 8,
-                                      color.green >> 8,
-                                      color.blue >> 8);
-		g_string_prepend(string, tag);
-		g_free(tag);
-		g_string_append(string, "</span>");
-	}
-	if (attr->strikethrough()) {
-		g_string_prepend(string, "<strike>");
-		g_string_append(string, "</strike>");
-	}
-	if (attr->overline()) {
-		g_string_prepend(string, "<span style=\"text-decoration-line:overline\">");
-		g_string_append(string, "</span>");
-	}
-	if (attr->blink()) {
-		g_string_prepend(string, "<blink>");
-		g_string_append(string, "</blink>");
-	}
-	/* reverse and invisible are not supported */
-
-	return g_string_free(string, FALSE);
+                auto style = bte::terminal::HtmlStyle{};
+                m_terminal.determine_colors(attr, false, false, &style.fore, &style.back, &style.deco);
+                style.underline = attr->underline();
+                style.bold = attr->bold();
+                style.italic = attr->italic();
+                style.strikethrough = attr->strikethrough();
+                style.overline = attr->overline();
+                style.blink = attr->blink();
+                style.reverse = attr->reverse();
+                /* invisible is not supported */
+
+                m_exporter.append(text, len, style);
+        }
+
+        void finish() { m_exporter.finish(); }
+
+private:
+        Terminal const& m_terminal;
+        bte::terminal::HtmlExporter m_exporter;
+}; // class HtmlTextSink
+
+} // anonymous namespace
+
+bool
+Terminal::selected_text_equals(GString const* text)
+{
+        if (text == nullptr)
+                return false;
+
+        auto sink = CompareTextSink{text};
+        stream_selected_text(sink);
+        return sink.equal();
 }
 
 /*
- * Similar to find_charcell(), but takes a BteCharAttribute for
- * indexing and returns the BteCellAttr.
+ * Terminal::get_html:
+ * @span: the span of text
+ * @block: whether @span is a rectangle
+ *
+ * Marks up the text in @span using HTML, with all attributes inline, and
+ * wraps it in a <pre> element.
+ * The text is streamed directly into the result, without building the plain
+ * text and its per-byte #BteCharAttributes first.
+ *
+ * Returns: (transfer full): a newly allocated string
  */
-BteCellAttr const*
-Terminal::char_to_cell_attr(BteCharAttributes const* attr) const
+GString*
+Terminal::get_html(bte::grid::span const& span,
+                   bool block)
 {
-	BteCell const* cell = find_charcell(attr->column, attr->row);
-	if (cell)
-		return &cell->attr;
-	return nullptr;
+        auto string = g_string_new(nullptr);
+        auto sink = HtmlTextSink{*this, string};
+        stream_text(span.start_row(), span.start_column(),
+                    span.end_row(), span.end_column(),
+                    block,
+                    sink);
+        sink.finish();
+
+        return string;
 }
 
 /*
- * Terminal::attributes_to_html:
- * @text: A string as returned by the bte_terminal_get_* family of functions.
- * @attrs: (array) (element-type Bte.CharAttributes): text attributes, as created by bte_terminal_get_*
+ * Terminal::clipboard_contents:
+ * @sel: the selection
+ * @format: the format
  *
- * Marks the given text up according to the given attributes, using HTML <span>
- * commands, and wraps the string in a <pre> element. The attributes have to be
- * "fresh" in the sense that the terminal must not have changed since they were
- * obtained using the bte_terminal_get* function.
- *
- * Returns: (transfer full): a newly allocated text string, or %NULL.
+ * Returns: the contents of @sel in @format, rendering them first if necessary,
+ *   or %nullptr if there are none
  */
 GString*
-Terminal::attributes_to_html(GString* text_string,
-                                       GArray* attrs)
+Terminal::clipboard_contents(BteSelection sel,
+                             BteFormat format)
 {
-	GString *string;
-	guint from,to;
-	const BteCellAttr *attr;
-	char *escaped, *marked;
+        auto& contents = m_selection[sel];
+        auto& string = format == BTE_FORMAT_HTML ? contents.html : contents.text;
+        if (string != nullptr || !contents.pending)
+                return string;
 
-        char const* text = text_string->str;
-        auto len = text_string->len;
-        g_assert_cmpuint(len, ==, attrs->len);
+        _bte_debug_print(BTE_DEBUG_SELECTION,
+                         "Rendering selection %d as %s.\n",
+                         sel, format == BTE_FORMAT_HTML ? "HTML" : "text");
 
-	/* Initial size fits perfectly if the text has no attributes and no
-	 * characters that need to be escaped
-         */
-	string = g_string_sized_new (len + 11);
+        if (format == BTE_FORMAT_HTML) {
+                string = get_html(contents.span, contents.block);
+        } else {
+                string = g_string_new(nullptr);
+                auto sink = StringTextSink{string};
+                stream_text(contents.span.start_row(), contents.span.start_column(),
+                            contents.span.end_row(), contents.span.end_column(),
+                            contents.block,
+                            sink);
+        }
 
-	g_string_append(string, "<pre>");
-	/* Find streches with equal attributes. Newlines are treated specially,
-	 * so that the <span> do not cover multiple lines.
-         */
-	from = to = 0;
-	while (text[from] != '\0') {
-		g_assert(from == to);
-		if (text[from] == '\n') {
-			g_string_append_c(string, '\n');
-			from = ++to;
-		} else {
-			attr = char_to_cell_attr(
-				&g_array_index(attrs, BteCharAttributes, from));
-			while (text[to] != '\0' && text[to] != '\n' &&
-			       bte_terminal_cellattr_equal(attr,
-                                                           char_to_cell_attr(
-						&g_array_index(attrs, BteCharAttributes, to))))
-			{
-				to++;
-			}
-			escaped = g_markup_escape_text(text + from, to - from);
-			marked = cellattr_to_html(attr, escaped);
-			g_string_append(string, marked);
-			g_free(escaped);
-			g_free(marked);
-			from = to;
-		}
-	}
-	g_string_append(string, "</pre>");
+        return string;
+}
+
+/*
+ * Terminal::clipboard_materialize:
+ *
+ * Renders the contents of the selections that have not been requested yet,
+ * since they cannot be rendered from their span anymore after the terminal
+ * contents change. Must be called before changing the contents (including
+ * switching screens, and resizing since that rewraps).
+ */
+void
+Terminal::clipboard_materialize()
+{
+        for (auto sel = 0; sel < LAST_BTE_SELECTION; sel++) {
+                auto& contents = m_selection[sel];
+                if (!contents.pending)
+                        continue;
+
+                clipboard_contents(BteSelection(sel), BTE_FORMAT_TEXT);
+                if (contents.format == BTE_FORMAT_HTML)
+                        clipboard_contents(BteSelection(sel), BTE_FORMAT_HTML);
+                contents.pending = false;
+        }
+}
 
-	return string;
+void
+Terminal::clipboard_clear_contents(BteSelection sel) noexcept
+{
+        auto& contents = m_selection[sel];
+        if (contents.text) {
+                g_string_free(contents.text, true);
+                contents.text = nullptr;
+        }
+        if (contents.html) {
+                g_string_free(contents.html, true);
+                contents.html = nullptr;
+        }
+        contents.pending = false;
 }
 
 static CtkTargetEntry*
@@ -6565,31 +6876,26 @@ Terminal::widget_copy(BteSelection sel,
         /* Only put HTML on the CLIPBOARD, not PRIMARY */
         g_assert(sel == BTE_SELECTION_CLIPBOARD || format == BTE_FORMAT_TEXT);
 
-	/* Chuck old selected text and retrieve the newly-selected text. */
-        GArray *attributes = g_array_new(FALSE, TRUE, sizeof(struct _BteCharAttributes));
-        auto selection = get_selected_text(attributes);
-
-        if (m_selection[sel]) {
-                g_string_free(m_selection[sel], TRUE);
-                m_selection[sel] = nullptr;
-        }
-
-        if (selection == nullptr) {
-                g_array_free(attributes, TRUE);
-                m_selection_owned[sel] = false;
-                return;
-        }
-
-        if (format == BTE_FORMAT_HTML) {
-                m_selection[sel] = attributes_to_html(selection, attributes);
-                g_string_free(selection, TRUE);
-        } else {
-                m_selection[sel] = selection;
-        }
+	/* Chuck old selected text, and record the newly-selected span. The text
+         * is only rendered when it is requested; see clipboard_contents().
+         */
+        clipboard_clear_contents(sel);
 
-	g_array_free (attributes, TRUE);
+        auto& contents = m_selection[sel];
+        contents.span = m_selection_resolved;
+        contents.block = m_selection_block_mode;
+        contents.format = format;
+        contents.pending = true;
 
 	/* Place the text on the clipboard. */
+        clipboard_take_ownership(sel, format);
+}
+
+/* Offers the contents of @sel in @format on the clipboard. */
+void
+Terminal::clipboard_take_ownership(BteSelection sel,
+                                   BteFormat format)
+{
         _bte_debug_print(BTE_DEBUG_SELECTION,
                          "Assuming ownership of selection.\n");
 
@@ -6607,7 +6913,179 @@ Terminal::widget_copy(BteSelection sel,
 
         ctk_clipboard_set_can_store(m_clipboard[sel], nullptr, 0);
         m_selection_owned[sel] = true;
-        m_selection_format[sel] = format;
+}
+
+void
+Terminal::clipboard_write_reset() noexcept
+{
+        auto& write = m_clipboard_write;
+        if (write.data) {
+                g_string_free(write.data, true);
+                write.data = nullptr;
+        }
+        write.decoder.reset();
+        write.active = false;
+}
+
+/*
+ * Terminal::clipboard_write_start:
+ * @str: the OSC string so far
+ * @len: the length of @str
+ * @id: the ID of the OSC string
+ *
+ * Starts decoding the OSC string @str if it is a write to the clipboard,
+ * i.e. of the form "52;selections;base64 data". An empty list of selections
+ * means the CLIPBOARD; 'c' is the CLIPBOARD, and 'p' and 's' the PRIMARY
+ * selection. Other selections, like cut buffers, are not supported.
+ *
+ * Returns: %true if @str is a clipboard write, %false if it is not, or
+ *   its selections are not complete yet
+ */
+bool
+Terminal::clipboard_write_start(uint32_t const* str,
+                                size_t len,
+                                unsigned int id) noexcept
+{
+        if (m_clipboard_write_limit == 0 ||
+            len < 4 || str[0] != '5' || str[1] != '2' || str[2] != ';')
+                return false;
+
+        auto& write = m_clipboard_write;
+        bool selections[LAST_BTE_SELECTION]{};
+        size_t i;
+        for (i = 3; i < len && str[i] != ';'; ++i) {
+                switch (str[i]) {
+                case 'c':
+                        selections[BTE_SELECTION_CLIPBOARD] = true;
+                        break;
+                case 'p':
+                case 's':
+                        selections[BTE_SELECTION_PRIMARY] = true;
+                        break;
+                default:
+                        break;
+                }
+        }
+        if (i == len)
+                return false;
+        if (i == 3)
+                selections[BTE_SELECTION_CLIPBOARD] = true;
+
+        clipboard_write_reset();
+        write.string_id = id;
+        write.prefix_len = i + 1;
+        for (auto sel = 0; sel < LAST_BTE_SELECTION; ++sel)
+                write.selections[sel] = selections[sel];
+        write.failed = !selections[BTE_SELECTION_PRIMARY] && !selections[BTE_SELECTION_CLIPBOARD];
+        write.data = g_string_new(nullptr);
+        write.active = true;
+        return true;
+}
+
+/*
+ * Terminal::clipboard_write_feed:
+ * @str: the OSC string so far
+ * @len: the length of @str
+ * @id: the ID of the OSC string
+ *
+ * Decodes the base64 data in @str that follows the prefix, if @str is
+ * a clipboard write. Once the decoded data exceeds the limit, the write
+ * fails, and the rest of the data is ignored.
+ */
+void
+Terminal::clipboard_write_feed(uint32_t const* str,
+                               size_t len,
+                               unsigned int id) noexcept
+{
+        auto& write = m_clipboard_write;
+        if ((!write.active || write.string_id != id) &&
+            !clipboard_write_start(str, len, id))
+                return;
+
+        if (write.failed || len <= write.prefix_len)
+                return;
+
+        if (!write.decoder.decode(str + write.prefix_len, len - write.prefix_len, write.data) ||
+            write.data->len > m_clipboard_write_limit) {
+                _bte_debug_print(BTE_DEBUG_SELECTION,
+                                 "Clipboard write is invalid or exceeds the limit.\n");
+                write.failed = true;
+                g_string_free(write.data, true);
+                write.data = nullptr;
+        }
+}
+
+/*
+ * Terminal::clipboard_write_stream:
+ *
+ * Decodes the data of a clipboard write that arrived so far, and drops it
+ * from the OSC string, so that neither the OSC string nor the base64 data
+ * are ever held in full.
+ */
+void
+Terminal::clipboard_write_stream() noexcept
+{
+        if (m_clipboard_write_limit == 0)
+                return;
+
+        size_t len;
+        unsigned int id;
+        auto const str = m_parser.osc_string(&len, &id);
+        if (str == nullptr)
+                return;
+
+        clipboard_write_feed(str, len, id);
+
+        auto const& write = m_clipboard_write;
+        if (write.active && write.string_id == id)
+                m_parser.truncate_string(write.prefix_len);
+}
+
+/*
+ * Terminal::clipboard_write_finish:
+ * @seq: the OSC 52 sequence
+ *
+ * Decodes the rest of the clipboard write, and puts the data on the
+ * selections, without copying it.
+ */
+void
+Terminal::clipboard_write_finish(bte::parser::Sequence const& seq)
+{
+        auto const str = seq.string();
+        clipboard_write_feed(reinterpret_cast<uint32_t const*>(str.data()), str.size(),
+                             seq.string_id());
+
+        auto& write = m_clipboard_write;
+        if (!write.active || write.string_id != seq.string_id())
+                return;
+
+        if (!write.failed &&
+            write.decoder.finish() &&
+            g_utf8_validate(write.data->str, write.data->len, nullptr) &&
+            m_real_widget != nullptr) {
+                for (auto sel = 0; sel < LAST_BTE_SELECTION; ++sel) {
+                        if (!write.selections[sel] || m_clipboard[sel] == nullptr)
+                                continue;
+
+                        clipboard_clear_contents(BteSelection(sel));
+
+                        auto& contents = m_selection[sel];
+                        contents.format = BTE_FORMAT_TEXT;
+                        /* Only the last selection takes over the data */
+                        if (std::find(write.selections + sel + 1,
+                                      write.selections + LAST_BTE_SELECTION,
+                                      true) != write.selections + LAST_BTE_SELECTION) {
+                                contents.text = g_string_new_len(write.data->str, write.data->len);
+                        } else {
+                                contents.text = write.data;
+                                write.data = nullptr;
+                        }
+
+                        clipboard_take_ownership(BteSelection(sel), BTE_FORMAT_TEXT);
+                }
+        }
+
+        clipboard_write_reset();
 }
 
 /* Paste from the given clipboard. */
@@ -7069,6 +7547,7 @@ Terminal::widget_focus_in()
 
         m_has_focus = true;
         widget()->grab_focus();
+        m_idle_trim_timer.abort();
 
 	/* We only have an IM context when we're realized, and there's not much
 	 * point to painting the cursor if we don't have a window. */
@@ -7080,7 +7559,7 @@ Terminal::widget_focus_in()
                  * (we could further optimize by checking its current phase). */
                 if (m_text_blink_mode == TextBlinkMode::eFOCUSED ||
                     (m_text_blink_mode == TextBlinkMode::eUNFOCUSED && m_text_blink_timer)) {
-                        invalidate_all();
+                        invalidate_view();
                 }
 
 		check_cursor_blink();
@@ -7108,7 +7587,7 @@ Terminal::widget_focus_out()
                  * (we could further optimize by checking its current phase). */
                 if (m_text_blink_mode == TextBlinkMode::eUNFOCUSED ||
                     (m_text_blink_mode == TextBlinkMode::eFOCUSED && m_text_blink_timer)) {
-                        invalidate_all();
+                        invalidate_view();
                 }
 
                 m_real_widget->im_focus_out();
@@ -7120,6 +7599,7 @@ Terminal::widget_focus_out()
 
 	m_has_focus = false;
 	check_cursor_blink();
+        note_activity();
 }
 
 void
@@ -7479,8 +7959,18 @@ Terminal::screen_set_size(BteScreen *screen_,
 
 	old_top_lines = below_current_paragraph.row - screen_->insert_delta;
 
-	if (do_rewrap && old_columns != m_column_count)
-		_bte_ring_rewrap(ring, m_column_count, markers);
+	if (do_rewrap && old_columns != m_column_count) {
+                if (_bte_ring_length(ring) > BTE_REWRAP_LAZY_ROWS_MIN) {
+                        /* Rewrap from a screenful above the viewport (or the screen, if higher up) down
+                         * right away, and leave the rest of the scrollback to the background. */
+                        long top = MIN((long) screen_->scroll_delta, screen_->insert_delta) - old_rows;
+                        ring->rewrap_from(m_column_count, MAX(top, _bte_ring_delta(ring)), markers);
+                        if (ring->rewrap_pending())
+                                m_rewrap_timer.schedule_idle(bte::glib::Timer::Priority::eLOW);
+                } else {
+                        _bte_ring_rewrap(ring, m_column_count, markers);
+                }
+        }
 
 	if (_bte_ring_length(ring) > m_row_count) {
 		/* The content won't fit without scrollbars. Before figuring out the position, we might need to
@@ -7562,6 +8052,104 @@ Terminal::screen_set_size(BteScreen *screen_,
 		screen_->scroll_delta = new_scroll_delta;
 }
 
+/* Swap in the scrollback that was rewrapped in the background after
+ * screen_set_size(), and update the positions accordingly. */
+void
+Terminal::screen_rewrap_commit(BteScreen *screen_)
+{
+	BteRing *ring = screen_->row_data;
+	BteVisualPosition cursor_saved_absolute;
+	BteVisualPosition top_of_viewport;
+        BteVisualPosition selection_start, selection_end;
+	BteVisualPosition *markers[6];
+        gboolean was_scrolled_to_bottom = ((long) screen_->scroll_delta == screen_->insert_delta);
+	double new_scroll_delta;
+
+        if (!ring->rewrap_pending())
+                return;
+
+        /* Committing renumbers the rows */
+        clipboard_materialize();
+
+        _bte_debug_print(BTE_DEBUG_RESIZE,
+                         "Committing the rewrap of rows up to %lu\n",
+                         ring->rewrap_pending_end());
+
+        cursor_saved_absolute.row = screen_->saved.cursor.row + screen_->insert_delta;
+        cursor_saved_absolute.col = screen_->saved.cursor.col;
+        top_of_viewport.row = screen_->scroll_delta;
+        top_of_viewport.col = 0;
+        memset(&markers, 0, sizeof(markers));
+        markers[0] = &cursor_saved_absolute;
+        markers[1] = &top_of_viewport;
+        markers[2] = &screen_->cursor;
+        if (!m_selection_resolved.empty()) {
+                selection_start.row = m_selection_resolved.start_row();
+                selection_start.col = m_selection_resolved.start_column();
+                selection_end.row = m_selection_resolved.end_row();
+                selection_end.col = m_selection_resolved.end_column();
+                markers[3] = &selection_start;
+                markers[4] = &selection_end;
+	}
+
+        ring->rewrap_commit(markers);
+
+        /* The other screen may still be rewrapping in the background */
+        if (!m_normal_screen.row_data->rewrap_pending() &&
+            !m_alternate_screen.row_data->rewrap_pending())
+                m_rewrap_timer.abort();
+
+        if (!m_selection_resolved.empty()) {
+                m_selection_resolved.set ({ selection_start.row, selection_start.col },
+                                          { selection_end.row, selection_end.col });
+	}
+
+        /* Only the row numbers changed below the region rewrapped by now, so
+         * there's no need to drop rows at the bottom like screen_set_size() does. */
+	if (_bte_ring_length(ring) <= m_row_count) {
+		screen_->insert_delta = _bte_ring_delta(ring);
+		new_scroll_delta = screen_->insert_delta;
+	} else {
+		screen_->insert_delta = _bte_ring_next(ring) - m_row_count;
+                if (was_scrolled_to_bottom) {
+                        new_scroll_delta = screen_->insert_delta;
+                } else {
+                        /* Keep the top visible row, and the old fractional part. */
+                        new_scroll_delta = top_of_viewport.row;
+                        new_scroll_delta += screen_->scroll_delta - floor(screen_->scroll_delta);
+                }
+	}
+
+        screen_->saved.cursor.row = cursor_saved_absolute.row - screen_->insert_delta;
+        screen_->saved.cursor.col = cursor_saved_absolute.col;
+
+        if (screen_ == m_screen) {
+                queue_adjustment_value_changed(new_scroll_delta);
+                adjust_adjustments_full();
+                m_ringview.invalidate();
+                invalidate_all();
+        } else {
+		screen_->scroll_delta = new_scroll_delta;
+        }
+}
+
+bool
+Terminal::rewrap_timer_callback()
+{
+        auto run_again = false;
+        for (auto screen_ : {&m_normal_screen, &m_alternate_screen}) {
+                if (!screen_->row_data->rewrap_pending())
+                        continue;
+
+                if (screen_->row_data->rewrap_step(BTE_REWRAP_LAZY_STEP_ROWS))
+                        run_again = true;
+                else
+                        screen_rewrap_commit(screen_);
+        }
+
+        return run_again;
+}
+
 void
 Terminal::set_size(long columns,
                              long rows)
@@ -7572,6 +8160,9 @@ Terminal::set_size(long columns,
 			"Setting PTY size to %ldx%ld.\n",
 			columns, rows);
 
+        /* Resizing may rewrap the contents */
+        clipboard_materialize();
+
 	old_rows = m_row_count;
 	old_columns = m_column_count;
 
@@ -7643,11 +8234,17 @@ Terminal::vadjustment_value_changed()
         if (G_UNLIKELY(!widget_realized()))
                 return;
 
+        /* Scrolling up to rows that haven't been rewrapped yet: finish the job now. */
+        if (G_UNLIKELY(m_screen->row_data->rewrap_pending() &&
+                       (long) m_screen->scroll_delta < (long) m_screen->row_data->rewrap_pending_end())) {
+                screen_rewrap_commit(m_screen);
+        }
+
         /* FIXME: do this check in pixel space */
 	if (!_bte_double_equal(dy, 0)) {
 		_bte_debug_print(BTE_DEBUG_ADJ,
 			    "Scrolling by %f\n", dy);
-                invalidate_all();
+                invalidate_view();
                 match_contents_clear();
 		emit_text_scrolled(dy);
 		queue_contents_changed();
@@ -7733,9 +8330,6 @@ Terminal::Terminal(bte::platform::Widget* w,
 	for (i = 0; i < BTE_PALETTE_SIZE; i++)
 		m_palette[i].sources[BTE_COLOR_SOURCE_ESCAPE].is_set = FALSE;
 
-	/* Set up I/O encodings. */
-	m_outgoing = _bte_byte_array_new();
-
 	/* Setting the terminal type and size requires the PTY master to
 	 * be set up properly first. */
         set_size(BTE_COLUMNS, BTE_ROWS);
@@ -7778,6 +8372,8 @@ Terminal::Terminal(bte::platform::Widget* w,
 
         feed(str, false);
 #endif
+
+        bte::base::ScrollbackBudget::get().add(this);
 }
 
 void
@@ -7955,6 +8551,24 @@ Terminal::~Terminal()
 
 	int sel;
 
+	/* Free any selected text, but if we currently own the selection,
+	 * throw the text onto the clipboard without an owner so that it
+	 * doesn't just disappear. Contents still to be rendered from their
+	 * span are rendered now, before anything is torn down. */
+	for (sel = BTE_SELECTION_PRIMARY; sel < LAST_BTE_SELECTION; sel++) {
+		if (m_selection_owned[sel]) {
+                        // FIXMEchpe we should also put text/html on if it's BTE_FORMAT_HTML
+                        auto const text = clipboard_contents(BteSelection(sel), BTE_FORMAT_TEXT);
+                        if (text != nullptr)
+                                ctk_clipboard_set_text(m_clipboard[sel],
+                                                       text->str,
+                                                       text->len);
+		}
+                clipboard_clear_contents(BteSelection(sel));
+	}
+
+        bte::base::ScrollbackBudget::get().remove(this);
+
         terminate_child();
         unset_pty(false /* don't notify widget */);
         remove_update_timeout(this);
@@ -7962,6 +8576,13 @@ Terminal::~Terminal()
         /* Stop processing input. */
         stop_processing(this);
 
+        clipboard_write_reset();
+
+        /* Save the scrollback session, up to the cursor's row */
+        if (!m_scrollback_session.empty() &&
+            !m_normal_screen.row_data->save_session(m_normal_screen.cursor.row + 1, m_column_count))
+                g_warning("Failed to save the scrollback session in %s", m_scrollback_session.c_str());
+
 	/* Free matching data. */
 	if (m_match_attributes != NULL) {
 		g_array_free(m_match_attributes, TRUE);
@@ -7977,23 +8598,6 @@ Terminal::~Terminal()
 	/* Cancel pending adjustment change notifications. */
 	m_adjustment_changed_pending = FALSE;
 
-	/* Free any selected text, but if we currently own the selection,
-	 * throw the text onto the clipboard without an owner so that it
-	 * doesn't just disappear. */
-	for (sel = BTE_SELECTION_PRIMARY; sel < LAST_BTE_SELECTION; sel++) {
-		if (m_selection[sel] != nullptr) {
-			if (m_selection_owned[sel]) {
-                                // FIXMEchpe we should check m_selection_format[sel]
-                                // and also put text/html on if it's BTE_FORMAT_HTML
-				ctk_clipboard_set_text(m_clipboard[sel],
-						       m_selection[sel]->str,
-						       m_selection[sel]->len);
-			}
-			g_string_free(m_selection[sel], TRUE);
-                        m_selection[sel] = nullptr;
-		}
-	}
-
         /* Stop listening for child-exited signals. */
         if (m_reaper) {
                 g_signal_handlers_disconnect_by_func(m_reaper,
@@ -8002,10 +8606,6 @@ Terminal::~Terminal()
                 g_object_unref(m_reaper);
         }
 
-	/* Discard any pending data. */
-	_bte_byte_array_free(m_outgoing);
-        m_outgoing = nullptr;
-
 	/* Free public-facing data. */
         if (m_vadjustment) {
 		/* Disconnect our signal handlers from this object. */
@@ -8160,7 +8760,7 @@ Terminal::determine_cursor_colors(BteCell const* cell,
 bool
 Terminal::text_blink_timer_callback()
 {
-        invalidate_all();
+        invalidate_view();
         return false; /* don't run again */
 }
 
@@ -8673,6 +9273,8 @@ Terminal::draw_rows(BteScreen *screen_,
         auto const column_count = m_column_count;
         uint32_t const attr_mask = m_allow_bold ? ~0 : ~BTE_ATTR_BOLD_MASK;
 
+        _BTE_TRACE_SCOPE(draw_rows, start_row, end_row);
+
         /* Need to ensure the ringview is updated. */
         ringview_update();
 
@@ -9221,6 +9823,11 @@ Terminal::widget_draw(cairo_t *cr)
         if (region == NULL)
                 return;
 
+        auto const draw_start = g_get_monotonic_time();
+
+        /* Being drawn is what counts as viewed for the scrollback budget */
+        bte::base::ScrollbackBudget::get().viewed(this);
+
         allocated_width = get_allocated_width();
         allocated_height = get_allocated_height();
 
@@ -9298,6 +9905,8 @@ Terminal::widget_draw(cairo_t *cr)
                                             bte::glib::Timer::Priority::eLOW);
 
         m_invalidated_all = FALSE;
+
+        m_statistics.draw_time.record(g_get_monotonic_time() - draw_start);
 }
 
 /* Handle an expose event by painting the exposed area. */
@@ -9722,6 +10331,8 @@ Terminal::set_scrollback_lines(long lines)
 	_bte_debug_print (BTE_DEBUG_MISC,
 			"Setting scrollback lines to %ld\n", lines);
 
+        clipboard_materialize();
+
 	m_scrollback_lines = lines;
 
         /* The main screen gets the full scrollback buffer. */
@@ -9759,6 +10370,82 @@ Terminal::set_scrollback_lines(long lines)
         return true;
 }
 
+/*
+ * Terminal::set_scrollback_session:
+ * @path: the session directory
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Keeps the scrollback of the normal screen in @path, restoring the
+ * session saved there, if any. The current contents of the normal screen
+ * are discarded. The session is saved when the terminal is destroyed.
+ * If Ring::attach_session() refuses @path, nothing changes.
+ */
+bool
+Terminal::set_scrollback_session(char const* path,
+                                 GError** error)
+{
+        if (m_scrollback_session == path)
+                return true;
+
+        _bte_debug_print(BTE_DEBUG_MISC,
+                         "Setting scrollback session to %s\n", path);
+
+        if (g_mkdir_with_parents(path, 0700) != 0) {
+                auto const errsv = errno;
+                g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                            _("Cannot create the scrollback session directory %s: %s"),
+                            path, g_strerror(errsv));
+                return false;
+        }
+
+        clipboard_materialize();
+
+        auto const ring = m_normal_screen.row_data;
+        auto columns = bte::grid::column_t{0};
+        auto const restored = ring->attach_session(path, &columns, error);
+
+        /* Refused, e.g. because another terminal uses @path; the ring and
+         * its previous session, if any, are unchanged. */
+        if (ring->session_dir() != path)
+                return false;
+
+        m_scrollback_session = path;
+        if (m_screen == &m_normal_screen)
+                deselect_all();
+
+        if (restored && columns != 0 && columns != m_column_count && m_rewrap_on_resize) {
+                BteVisualPosition* markers[7];
+                memset(&markers, 0, sizeof(markers));
+
+                if (_bte_ring_length(ring) > BTE_REWRAP_LAZY_ROWS_MIN) {
+                        ring->rewrap_from(m_column_count,
+                                          MAX(_bte_ring_next(ring) - m_row_count, _bte_ring_delta(ring)),
+                                          markers);
+                        if (ring->rewrap_pending())
+                                m_rewrap_timer.schedule_idle(bte::glib::Timer::Priority::eLOW);
+                } else {
+                        _bte_ring_rewrap(ring, m_column_count, markers);
+                }
+        }
+
+        /* Continue below the restored rows, like after a reset */
+        m_normal_screen.scroll_delta = m_normal_screen.insert_delta = _bte_ring_next(ring);
+        m_normal_screen.cursor.row = m_normal_screen.insert_delta;
+        m_normal_screen.cursor.col = 0;
+        save_cursor(&m_normal_screen);
+
+        m_ringview.invalidate();
+        if (m_screen == &m_normal_screen) {
+                /* Hack: force a change in scroll_delta, see bug 730599. */
+                m_screen->scroll_delta = -1;
+                queue_adjustment_value_changed(m_screen->insert_delta);
+                adjust_adjustments_full();
+                invalidate_all();
+        }
+
+        return restored;
+}
+
 bool
 Terminal::set_backspace_binding(EraseMode binding)
 {
@@ -9833,12 +10520,14 @@ Terminal::reset(bool clear_tabstops,
         if (from_api && !m_input_enabled)
                 return;
 
+        clipboard_materialize();
+
         auto const freezer = bte::glib::FreezeObjectNotify{m_terminal};
 
         m_bell_pending = false;
 
 	/* Clear the output buffer. */
-	_bte_byte_array_clear(m_outgoing);
+	outgoing_clear();
 
 	/* Reset charset substitution state. */
 
@@ -9848,6 +10537,7 @@ Terminal::reset(bool clear_tabstops,
         /* Reset parser */
         m_parser.reset();
         m_last_graphic_character = 0;
+        clipboard_write_reset();
 
         /* Reset modes */
         m_modes_ecma.reset();
@@ -9940,10 +10630,12 @@ Terminal::unset_pty(bool notify_widget)
 
         m_child_exited_eos_wait_timer.abort();
 
-        /* Clear incoming and outgoing queues */
+        /* Clear incoming and outgoing queues. The child is going away,
+         * so there's no bracket to close for it either. */
         m_input_bytes = 0;
         m_incoming_queue = {};
-        _bte_byte_array_clear(m_outgoing);
+        m_paste_queue.cancel();
+        outgoing_clear();
 
         stop_processing(this); // FIXMEchpe only if m_incoming_queue.empty() !!!
 
@@ -10005,6 +10697,46 @@ Terminal::subscribe_accessible_events()
 {
 #ifdef WITH_A11Y
 	m_accessible_emit = true;
+        m_accessible_damage.damage_all();
+#endif
+}
+
+/* Record that the contents of the given rows might have changed, so that
+ * the accessible only needs to look at these when updating its text.
+ * This is fed from the same places that invalidate the rows for drawing. */
+void
+Terminal::accessible_damage_rows(bte::grid::row_t row_start,
+                                 bte::grid::row_t row_end /* exclusive */)
+{
+#ifdef WITH_A11Y
+        if (!m_accessible_emit)
+                return;
+
+        m_accessible_damage.damage_rows(row_start, row_end);
+#endif
+}
+
+/* Get the rows whose contents might have changed or that scrolled into view
+ * since the previous call, clipped to the ones that get_text_displayed_a11y()
+ * covers, and start collecting them anew. *@top_row is the first row it now
+ * covers; the accessible drops the ones that scrolled out of view.
+ * Returns false if the whole text needs to be refreshed, e.g. because the
+ * view was scrolled by a screenful, or the whole terminal was invalidated.
+ * The row pointers can be nullptr to just reset the state after the
+ * accessible took a full snapshot. */
+bool
+Terminal::accessible_take_damage(bte::grid::row_t* top_row,
+                                 bte::grid::row_t* start_row,
+                                 bte::grid::row_t* end_row)
+{
+#ifdef WITH_A11Y
+        auto const top = bte::grid::row_t(m_screen->scroll_delta);
+
+        if (top_row != nullptr)
+                *top_row = top;
+        return m_accessible_damage.take(top, m_row_count, start_row, end_row);
+#else
+        return false;
 #endif
 }
 
@@ -10277,6 +11009,171 @@ Terminal::time_process_incoming()
 	m_max_input_bytes = (m_max_input_bytes + target) / 2;
 }
 
+/*
+ * Terminal::statistics:
+ *
+ * Returns: (transfer floating): the statistics as an "a{sv}" variant, see
+ *   bte_terminal_get_statistics()
+ */
+GVariant*
+Terminal::statistics() const
+{
+        auto statistics = m_statistics;
+
+        for (auto const screen : {&m_normal_screen, &m_alternate_screen}) {
+                auto const ring = screen->row_data;
+                statistics.ring_freezes += ring->n_freezes();
+                statistics.ring_thaws += ring->n_thaws();
+
+                auto const& stream = ring->stream_statistics();
+                statistics.stream_block_reads += stream.block_reads;
+                statistics.stream_block_writes += stream.block_writes;
+                statistics.stream_bytes_uncompressed += stream.bytes_uncompressed;
+                statistics.stream_bytes_compressed += stream.bytes_compressed;
+        }
+
+        m_draw.font_cache_statistics(statistics.font_cache_hits,
+                                     statistics.font_cache_misses);
+
+        return statistics.to_variant();
+}
+
+void
+Terminal::scrollback_usage(uint64_t& disk,
+                           uint64_t& memory) const noexcept
+{
+        disk = m_normal_screen.row_data->stream_bytes();
+        memory = m_normal_screen.row_data->memory_bytes() +
+                m_alternate_screen.row_data->memory_bytes();
+}
+
+/*
+ * Terminal::evict_scrollback:
+ * @bytes: the number of bytes to release
+ *
+ * Drops the oldest rows of the normal screen's scrollback, as the
+ * #ScrollbackBudget requests, and updates the scroll position the same
+ * way as set_scrollback_lines() does.
+ *
+ * Returns: the number of bytes released
+ */
+uint64_t
+Terminal::evict_scrollback(uint64_t bytes)
+{
+        auto scrn = &m_normal_screen;
+        if (_bte_ring_delta(scrn->row_data) == _bte_ring_next(scrn->row_data))
+                return 0;
+
+        /* The selection may extend into the evicted rows */
+        clipboard_materialize();
+
+        auto const released = scrn->row_data->evict(bytes);
+        if (released == 0)
+                return 0;
+
+        _bte_debug_print(BTE_DEBUG_RING,
+                         "Evicted %" G_GUINT64_FORMAT " bytes of scrollback\n",
+                         guint64(released));
+
+        auto const low = _bte_ring_delta(scrn->row_data);
+        scrn->insert_delta = MAX(scrn->insert_delta, low);
+        scrn->scroll_delta = MAX(scrn->scroll_delta, double(low));
+
+        if (m_screen == scrn) {
+                /* See set_scrollback_lines() */
+                auto const scroll_delta = m_screen->scroll_delta;
+                m_screen->scroll_delta = -1;
+                queue_adjustment_value_changed(scroll_delta);
+                adjust_adjustments_full();
+        }
+
+        return released;
+}
+
+#ifdef HAVE_MALLOC_TRIM
+static guint malloc_trim_tag = 0;
+
+/* Returns the memory freed by idle_trim() to the OS; this is done once for
+ * all terminals that were trimmed at about the same time.
+ */
+static gboolean
+malloc_trim_cb(gpointer data) noexcept
+{
+        malloc_trim(0);
+        malloc_trim_tag = 0;
+        return G_SOURCE_REMOVE;
+}
+#endif
+
+/* Starts the countdown to idle_trim(), unless it's already running */
+void
+Terminal::note_activity()
+{
+        m_last_activity_time = g_get_monotonic_time();
+        if (!m_has_focus && !m_idle_trim_timer)
+                m_idle_trim_timer.schedule_seconds(BTE_IDLE_TRIM_TIMEOUT, bte::glib::Timer::Priority::eLOW);
+}
+
+bool
+Terminal::idle_trim_timer_callback()
+{
+        if (m_has_focus)
+                return false;
+
+        /* There was activity since the timer was scheduled; wait for the rest */
+        auto const idle = g_get_monotonic_time() - m_last_activity_time;
+        if (idle < BTE_IDLE_TRIM_TIMEOUT * G_USEC_PER_SEC) {
+                m_idle_trim_timer.schedule((BTE_IDLE_TRIM_TIMEOUT * G_USEC_PER_SEC - idle) / 1000 + 1,
+                                           bte::glib::Timer::Priority::eLOW);
+                return false;
+        }
+
+        idle_trim();
+        return false;
+}
+
+/*
+ * Terminal::idle_trim:
+ *
+ * Releases the memory of an idle, unfocused terminal that is rebuilt on
+ * demand: the writable rows beyond the screen, unused cell arrays, the
+ * ringview and its BiDi rows, and the contents cached for matching.
+ */
+void
+Terminal::idle_trim()
+{
+        _bte_debug_print(BTE_DEBUG_MISC, "Trimming idle terminal\n");
+
+        m_normal_screen.row_data->trim();
+        m_alternate_screen.row_data->trim();
+
+        m_ringview.pause();
+
+        /* The rows freed above went to the pool */
+        _bte_row_data_pool_trim();
+
+        /* Keep the hovered match highlighted */
+        if (!m_mouse_cursor_over_widget)
+                match_contents_clear();
+
+        if (m_update_rects->len == 0) {
+                g_array_free(m_update_rects, TRUE);
+                m_update_rects = g_array_sized_new(FALSE /* zero terminated */,
+                                                   FALSE /* clear */,
+                                                   sizeof(cairo_rectangle_int_t),
+                                                   32 /* preallocated size */);
+        }
+
+        /* Nothing is being processed, so the free chunks aren't needed either */
+        if (g_active_terminals == nullptr)
+                bte::base::Chunk::prune(0);
+
+#ifdef HAVE_MALLOC_TRIM
+        if (malloc_trim_tag == 0)
+                malloc_trim_tag = g_idle_add_full(G_PRIORITY_LOW, malloc_trim_cb, nullptr, nullptr);
+#endif
+}
+
 bool
 Terminal::process(bool emit_adj_changed)
 {
@@ -10610,6 +11507,8 @@ Terminal::search_rows(pcre2_match_context_8 *match_context,
 	GArray *attrs;
 	gdouble value, page_size;
 
+        _BTE_TRACE_SCOPE(search_rows, start_row, end_row, int(backward));
+
 	auto row_text = get_text(start_row, 0,
                                  end_row, 0,
                                  false /* block */,
@@ -10840,7 +11739,7 @@ Terminal::set_input_enabled (bool enabled)
                         widget()->im_focus_out();
 
                 disconnect_pty_write();
-                _bte_byte_array_clear(m_outgoing);
+                outgoing_clear();
 
                 ctk_style_context_add_class (context, CTK_STYLE_CLASS_READ_ONLY);
         }
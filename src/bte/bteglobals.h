@@ -35,6 +35,16 @@ const char *bte_get_features (void) _BTE_CXX_NOEXCEPT;
 _BTE_PUBLIC
 BteFeatureFlags bte_get_feature_flags(void) _BTE_CXX_NOEXCEPT;
 
+_BTE_PUBLIC
+void bte_set_scrollback_budget(guint64 bytes) _BTE_CXX_NOEXCEPT;
+
+_BTE_PUBLIC
+guint64 bte_get_scrollback_budget(void) _BTE_CXX_NOEXCEPT;
+
+_BTE_PUBLIC
+void bte_get_scrollback_usage(guint64 *disk_bytes,
+                              guint64 *memory_bytes) _BTE_CXX_NOEXCEPT;
+
 #define BTE_TEST_FLAGS_NONE (G_GUINT64_CONSTANT(0))
 #define BTE_TEST_FLAGS_ALL (~G_GUINT64_CONSTANT(0))
 
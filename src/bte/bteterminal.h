@@ -311,6 +311,21 @@ void bte_terminal_set_scrollback_lines(BteTerminal *terminal,
 _BTE_PUBLIC
 glong bte_terminal_get_scrollback_lines(BteTerminal *terminal) _BTE_CXX_NOEXCEPT _BTE_GNUC_NONNULL(1);
 
+/* Keep the scrollback in a directory, and restore it from there. */
+_BTE_PUBLIC
+gboolean bte_terminal_set_scrollback_session(BteTerminal *terminal,
+                                             const char *path,
+                                             GError **error) _BTE_CXX_NOEXCEPT _BTE_GNUC_NONNULL(1) _BTE_GNUC_NONNULL(2);
+_BTE_PUBLIC
+const char *bte_terminal_get_scrollback_session(BteTerminal *terminal) _BTE_CXX_NOEXCEPT _BTE_GNUC_NONNULL(1);
+
+/* Let the child write to the clipboard with OSC 52, up to a size. */
+_BTE_PUBLIC
+void bte_terminal_set_clipboard_write_limit(BteTerminal *terminal,
+                                            gsize limit) _BTE_CXX_NOEXCEPT _BTE_GNUC_NONNULL(1);
+_BTE_PUBLIC
+gsize bte_terminal_get_clipboard_write_limit(BteTerminal *terminal) _BTE_CXX_NOEXCEPT _BTE_GNUC_NONNULL(1);
+
 /* Set or retrieve the current font. */
 _BTE_PUBLIC
 void bte_terminal_set_font(BteTerminal *terminal,
@@ -519,6 +534,10 @@ gboolean bte_terminal_write_contents_sync (BteTerminal *terminal,
                                            GCancellable *cancellable,
                                            GError **error) _BTE_CXX_NOEXCEPT _BTE_GNUC_NONNULL(1) _BTE_GNUC_NONNULL(2);
 
+/* Statistics */
+_BTE_PUBLIC
+GVariant *bte_terminal_get_statistics(BteTerminal *terminal) _BTE_CXX_NOEXCEPT _BTE_GNUC_NONNULL(1);
+
 /* Images */
 
 /* Set or get whether SIXEL image support is enabled */
@@ -196,6 +196,100 @@ emit_text_changed_delete(GObject *object,
 	g_signal_emit_by_name(object, "text-changed::delete", start, count);
 }
 
+/* Find the offsets (in characters) of the beginning of each line, from the
+ * characters and their attributes, from the character @from on. The ones
+ * before it are still valid and kept. */
+static void
+update_linebreaks(BteTerminalAccessiblePrivate *priv, guint from)
+{
+	struct _BteCharAttributes attrs;
+	long row, offset;
+	guint i, lo, hi;
+
+	from = MIN(from, priv->snapshot_characters->len);
+
+	lo = 0;
+	hi = priv->snapshot_linebreaks->len;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		if ((guint) g_array_index(priv->snapshot_linebreaks, int, mid) < from) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	g_array_set_size(priv->snapshot_linebreaks, lo);
+
+	row = 0;
+	if (from > 0) {
+		offset = g_array_index(priv->snapshot_characters,
+				       int, from - 1);
+		row = g_array_index(priv->snapshot_attributes,
+				    struct _BteCharAttributes,
+				    offset).row;
+	}
+	for (i = from; i < priv->snapshot_characters->len; i++) {
+		/* Get the attributes for the current cell. */
+		offset = g_array_index(priv->snapshot_characters,
+				       int, i);
+		attrs = g_array_index(priv->snapshot_attributes,
+				      struct _BteCharAttributes,
+				      offset);
+		/* If this character is on a row different from the row
+		 * the character we looked at previously was on, then
+		 * it's a new line and we need to keep track of where
+		 * it is. */
+		if ((i == 0) || (attrs.row != row)) {
+			_bte_debug_print(BTE_DEBUG_ALLY,
+					"Row %d/%ld begins at %u.\n",
+					priv->snapshot_linebreaks->len,
+					attrs.row, i);
+			g_array_append_val(priv->snapshot_linebreaks, i);
+		}
+		row = attrs.row;
+	}
+	/* Add the final line break. */
+	g_array_append_val(priv->snapshot_linebreaks, i);
+}
+
+/* Find the offset (in bytes) of the first character of the given row in the
+ * snapshot, or the length of the text if there's no such character. */
+static guint
+offset_from_row(BteTerminalAccessiblePrivate *priv, long row)
+{
+	guint lo = 0, hi = priv->snapshot_attributes->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		if (g_array_index(priv->snapshot_attributes,
+				  struct _BteCharAttributes,
+				  mid).row < row) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/* Find the index of the first character that begins at or after the given
+ * offset (in bytes) in the snapshot. */
+static guint
+character_from_offset(BteTerminalAccessiblePrivate *priv, guint offset)
+{
+	guint lo = 0, hi = priv->snapshot_characters->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		if ((guint) g_array_index(priv->snapshot_characters, int, mid) < offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
 static void
 bte_terminal_accessible_update_private_data_if_needed(BteTerminalAccessible *accessible,
                                                       GString **old_text,
@@ -204,7 +298,7 @@ bte_terminal_accessible_update_private_data_if_needed(BteTerminalAccessible *acc
 	BteTerminalAccessiblePrivate *priv = (BteTerminalAccessiblePrivate *)_bte_terminal_accessible_get_instance_private(accessible);
 	struct _BteCharAttributes attrs;
 	char *next;
-	long row, offset, caret;
+	long offset, caret;
 	long ccol, crow;
 	guint i;
 
@@ -302,30 +396,12 @@ bte_terminal_accessible_update_private_data_if_needed(BteTerminalAccessible *acc
 			}
 		}
 		/* Find offsets for the beginning of lines. */
-		for (i = 0, row = 0; i < priv->snapshot_characters->len; i++) {
-			/* Get the attributes for the current cell. */
-			offset = g_array_index(priv->snapshot_characters,
-					       int, i);
-			attrs = g_array_index(priv->snapshot_attributes,
-					      struct _BteCharAttributes,
-					      offset);
-			/* If this character is on a row different from the row
-			 * the character we looked at previously was on, then
-			 * it's a new line and we need to keep track of where
-			 * it is. */
-			if ((i == 0) || (attrs.row != row)) {
-				_bte_debug_print(BTE_DEBUG_ALLY,
-						"Row %d/%ld begins at %u.\n",
-						priv->snapshot_linebreaks->len,
-						attrs.row, i);
-				g_array_append_val(priv->snapshot_linebreaks, i);
-			}
-			row = attrs.row;
-		}
-		/* Add the final line break. */
-		g_array_append_val(priv->snapshot_linebreaks, i);
+		update_linebreaks(priv, 0);
 		/* We're finished updating this. */
 		priv->snapshot_contents_invalid = FALSE;
+
+		/* Further updates can be incremental, starting from here. */
+		impl->accessible_take_damage(nullptr, nullptr, nullptr);
 	}
 
 	/* Update the caret position. */
@@ -367,6 +443,207 @@ bte_terminal_accessible_update_private_data_if_needed(BteTerminalAccessible *acc
 			(long)priv->snapshot_characters->len);
 }
 
+/* Bring the snapshot up to date after the rows from @start_row to @end_row
+ * (exclusive) might have changed, re-reading only these rows and emitting
+ * text-changed signals for the difference. The caret is not updated.
+ * Returns whether any text was deleted. */
+static gboolean
+bte_terminal_accessible_update_rows(BteTerminalAccessible *accessible,
+                                    long start_row,
+                                    long end_row)
+{
+	BteTerminalAccessiblePrivate *priv = (BteTerminalAccessiblePrivate *)_bte_terminal_accessible_get_instance_private(accessible);
+	GString *text;
+	GArray *attributes, *characters;
+	const char *old, *current, *next;
+	glong offset, olen, clen, delta;
+	guint start, end, i, c;
+
+	attributes = g_array_new(FALSE, FALSE, sizeof(struct _BteCharAttributes));
+	try {
+		text = IMPL_FROM_ACCESSIBLE(accessible)->get_text_displayed_a11y_rows(start_row,
+										    end_row,
+										    true /* wrap */,
+										    attributes);
+	} catch (...) {
+		text = g_string_new("");
+		g_array_set_size(attributes, 0);
+	}
+
+	/* The bytes of the snapshot that belong to these rows. */
+	start = offset_from_row(priv, start_row);
+	end = offset_from_row(priv, end_row);
+
+	old = priv->snapshot_text->str + start;
+	olen = end - start;
+	current = text->str;
+	clen = text->len;
+
+	/* Find the offset where they don't match, at a character boundary. */
+	offset = 0;
+	while ((offset < olen) && (offset < clen)) {
+		if (old[offset] != current[offset]) {
+			break;
+		}
+		offset++;
+	}
+	while (offset > 0 && offset < olen && (old[offset] & 0xc0) == 0x80) {
+		offset--;
+	}
+
+	/* Back up from both end points until we find the *last* point
+	 * where they differed. */
+	if ((offset < olen) || (offset < clen)) {
+		const char *op = old + olen;
+		const char *cp = current + clen;
+		while (op > old + offset && cp > current + offset) {
+			const char *opp = g_utf8_prev_char (op);
+			const char *cpp = g_utf8_prev_char (cp);
+			if (g_utf8_get_char (opp) != g_utf8_get_char (cpp)) {
+				break;
+			}
+			op = opp;
+			cp = cpp;
+		}
+		olen = op - old;
+		clen = cp - current;
+	} else {
+		olen = clen = offset;
+	}
+
+	/* Emit a deleted signal for text that was in the old snapshot
+	 * but isn't in the new one, while the snapshot is still the old one... */
+	if (olen > offset) {
+		emit_text_changed_delete(G_OBJECT(accessible),
+					 priv->snapshot_text->str,
+					 start + offset,
+					 olen - offset);
+	}
+
+	/* ...splice the new rows in... */
+	g_string_erase(priv->snapshot_text, start, end - start);
+	g_string_insert_len(priv->snapshot_text, start, text->str, text->len);
+	g_array_remove_range(priv->snapshot_attributes, start, end - start);
+	g_array_insert_vals(priv->snapshot_attributes, start,
+			    attributes->data, attributes->len);
+
+	delta = (glong) text->len - (glong) (end - start);
+	c = character_from_offset(priv, start);
+	i = character_from_offset(priv, end);
+	g_array_remove_range(priv->snapshot_characters, c, i - c);
+	for (i = c; i < priv->snapshot_characters->len; i++) {
+		g_array_index(priv->snapshot_characters, int, i) += delta;
+	}
+	characters = g_array_new(FALSE, FALSE, sizeof(int));
+	for (next = text->str; next < text->str + text->len; next = g_utf8_next_char(next)) {
+		int val = start + (next - text->str);
+		g_array_append_val(characters, val);
+	}
+	g_array_insert_vals(priv->snapshot_characters, c,
+			    characters->data, characters->len);
+	g_array_free(characters, TRUE);
+
+	update_linebreaks(priv, c);
+
+	/* ...and emit an inserted signal for text that wasn't in the old
+	 * snapshot but is in the new one. */
+	if (clen > offset) {
+		emit_text_changed_insert(G_OBJECT(accessible),
+					 priv->snapshot_text->str,
+					 start + offset,
+					 clen - offset);
+	}
+
+	_bte_debug_print(BTE_DEBUG_ALLY,
+			"Refreshed accessibility snapshot rows %ld..%ld, "
+			"%ld cells, %ld characters.\n",
+			start_row, end_row - 1,
+			(long)priv->snapshot_attributes->len,
+			(long)priv->snapshot_characters->len);
+
+	g_string_free(text, TRUE);
+	g_array_free(attributes, TRUE);
+
+	return olen > offset;
+}
+
+/* Drop the rows before @top_row and from @bottom_row on from the snapshot
+ * after the view scrolled, emitting text-changed signals for them.
+ * Returns whether any text was deleted. */
+static gboolean
+bte_terminal_accessible_trim_rows(BteTerminalAccessible *accessible,
+                                  long top_row,
+                                  long bottom_row)
+{
+	BteTerminalAccessiblePrivate *priv = (BteTerminalAccessiblePrivate *)_bte_terminal_accessible_get_instance_private(accessible);
+	guint start, end, c, i;
+	gboolean deleted = FALSE;
+
+	start = offset_from_row(priv, top_row);
+	end = offset_from_row(priv, bottom_row);
+
+	/* The rows that scrolled out at the bottom... */
+	if (end < priv->snapshot_text->len) {
+		emit_text_changed_delete(G_OBJECT(accessible),
+					 priv->snapshot_text->str,
+					 end,
+					 priv->snapshot_text->len - end);
+		g_string_truncate(priv->snapshot_text, end);
+		g_array_set_size(priv->snapshot_attributes, end);
+		g_array_set_size(priv->snapshot_characters,
+				 character_from_offset(priv, end));
+		update_linebreaks(priv, priv->snapshot_characters->len);
+		deleted = TRUE;
+	}
+
+	/* ...and the ones that scrolled out at the top. */
+	if (start > 0) {
+		emit_text_changed_delete(G_OBJECT(accessible),
+					 priv->snapshot_text->str,
+					 0,
+					 start);
+		c = character_from_offset(priv, start);
+		g_string_erase(priv->snapshot_text, 0, start);
+		g_array_remove_range(priv->snapshot_attributes, 0, start);
+		g_array_remove_range(priv->snapshot_characters, 0, c);
+		for (i = 0; i < priv->snapshot_characters->len; i++) {
+			g_array_index(priv->snapshot_characters, int, i) -= start;
+		}
+		update_linebreaks(priv, 0);
+		deleted = TRUE;
+	}
+
+	return deleted;
+}
+
+/* Bring the snapshot up to date incrementally, dropping the rows that
+ * scrolled out of view, and re-reading only the ones that scrolled in or
+ * might have changed. Returns FALSE if the whole snapshot needs to be
+ * refreshed instead; otherwise *@deleted tells whether any text was
+ * deleted. The caret is not updated. */
+static gboolean
+bte_terminal_accessible_update_damaged(BteTerminalAccessible *accessible,
+                                       gboolean *deleted)
+{
+	BteTerminalAccessiblePrivate *priv = (BteTerminalAccessiblePrivate *)_bte_terminal_accessible_get_instance_private(accessible);
+	BteTerminal *terminal = TERMINAL_FROM_ACCESSIBLE(accessible);
+	bte::grid::row_t top_row, start_row, end_row;
+
+	if (priv->snapshot_contents_invalid || priv->snapshot_text == NULL ||
+	    !IMPL(terminal)->accessible_take_damage(&top_row, &start_row, &end_row))
+		return FALSE;
+
+	*deleted = bte_terminal_accessible_trim_rows(accessible,
+						      top_row,
+						      top_row + bte_terminal_get_row_count(terminal));
+	if (start_row < end_row) {
+		*deleted = bte_terminal_accessible_update_rows(accessible,
+							       start_row,
+							       end_row) || *deleted;
+	}
+	return TRUE;
+}
+
 static void
 bte_terminal_accessible_maybe_emit_text_caret_moved(BteTerminalAccessible *accessible)
 {
@@ -389,8 +666,35 @@ bte_terminal_accessible_text_modified(BteTerminal *terminal, gpointer data)
 	char *old, *current;
 	glong offset, caret_offset, olen, clen;
 	gint old_snapshot_caret;
+	gboolean deleted;
 
 	old_snapshot_caret = priv->snapshot_caret;
+
+	/* Only re-read the rows that might have changed, if possible. */
+	if (bte_terminal_accessible_update_damaged(accessible, &deleted)) {
+		priv->snapshot_caret_invalid = TRUE;
+		bte_terminal_accessible_update_private_data_if_needed(accessible,
+								      NULL, NULL);
+
+		/* Check if we just backspaced over a space. */
+		if (!deleted && old_snapshot_caret == priv->snapshot_caret + 1 &&
+		    (guint) priv->snapshot_caret < priv->snapshot_characters->len) {
+			caret_offset = g_array_index(priv->snapshot_characters,
+						     int, priv->snapshot_caret);
+			if (priv->snapshot_text->str[caret_offset] == ' ') {
+				emit_text_changed_delete(G_OBJECT(accessible),
+							 priv->snapshot_text->str,
+							 caret_offset, 1);
+				emit_text_changed_insert(G_OBJECT(accessible),
+							 priv->snapshot_text->str,
+							 caret_offset, 1);
+			}
+		}
+
+		bte_terminal_accessible_maybe_emit_text_caret_moved(accessible);
+		return;
+	}
+
 	priv->snapshot_contents_invalid = TRUE;
 	bte_terminal_accessible_update_private_data_if_needed(accessible,
                                                               &old_text,
@@ -502,11 +806,21 @@ bte_terminal_accessible_text_scrolled(BteTerminal *terminal,
 	struct _BteCharAttributes attr;
 	long delta, row_count;
 	guint i, len;
+	gboolean deleted;
 
         /* TODOegmont: Fix this for smooth scrolling */
         /* g_assert(howmuch != 0); */
         if (howmuch == 0) return;
 
+	/* Shift the snapshot, re-reading only the rows that scrolled in. */
+	if (bte_terminal_accessible_update_damaged(accessible, &deleted)) {
+		priv->snapshot_caret_invalid = TRUE;
+		bte_terminal_accessible_update_private_data_if_needed(accessible,
+								      NULL, NULL);
+		bte_terminal_accessible_maybe_emit_text_caret_moved(accessible);
+		return;
+	}
+
         row_count = bte_terminal_get_row_count(terminal);
 	if (((howmuch < 0) && (howmuch <= -row_count)) ||
 	    ((howmuch > 0) && (howmuch >= row_count))) {
@@ -1427,13 +1741,17 @@ bte_terminal_accessible_get_selection(AtkText *text, gint selection_number,
 
         try {
                 auto impl = IMPL_FROM_WIDGET(widget);
-                if (impl->m_selection_resolved.empty() || impl->m_selection[BTE_SELECTION_PRIMARY] == nullptr)
+                if (impl->m_selection_resolved.empty())
+                        return nullptr;
+
+                auto const selection = impl->clipboard_contents(BTE_SELECTION_PRIMARY, BTE_FORMAT_TEXT);
+                if (selection == nullptr)
                         return nullptr;
 
                 *start_offset = offset_from_xy (priv, impl->m_selection_resolved.start_column(), impl->m_selection_resolved.start_row());
                 *end_offset = offset_from_xy (priv, impl->m_selection_resolved.end_column(), impl->m_selection_resolved.end_row());
 
-                return g_strdup(impl->m_selection[BTE_SELECTION_PRIMARY]->str);
+                return g_strndup(selection->str, selection->len);
         } catch (...) {
                 return nullptr;
         }
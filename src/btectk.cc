@@ -2077,7 +2077,8 @@ bte_get_features (void) noexcept
                 "-BIDI"
 #endif
                 " "
-#ifdef WITH_GNUTLS
+                /* GnuTLS is only used to encrypt the scrollback */
+#ifdef WITH_STREAM_ENCRYPTION
                 "+GNUTLS"
 #else
                 "-GNUTLS"
@@ -2218,6 +2219,69 @@ bte_set_test_flags(guint64 flags) noexcept
 #endif
 }
 
+/**
+ * bte_set_scrollback_budget:
+ * @bytes: the maximum number of bytes, or 0 for no limit
+ *
+ * Limits the scrollback of all terminals in the process together to @bytes,
+ * counting both the scrollback on disk (before compression) and the rows
+ * held in memory. This is in addition to the per-terminal limit of
+ * bte_terminal_set_scrollback_lines().
+ *
+ * When the limit is exceeded, the oldest scrollback lines are dropped from
+ * the terminals that were least recently drawn on screen first. The onscreen
+ * rows themselves are never dropped, so the usage may stay above a very
+ * small limit.
+ *
+ * Since: 0.66
+ */
+void
+bte_set_scrollback_budget(guint64 bytes) noexcept
+try
+{
+        bte::base::ScrollbackBudget::get().set_limit(bytes);
+}
+catch (...)
+{
+        bte::log_exception();
+}
+
+/**
+ * bte_get_scrollback_budget:
+ *
+ * Returns: the limit set with bte_set_scrollback_budget(), or 0 for no limit
+ *
+ * Since: 0.66
+ */
+guint64
+bte_get_scrollback_budget(void) noexcept
+{
+        return bte::base::ScrollbackBudget::get().limit();
+}
+
+/**
+ * bte_get_scrollback_usage:
+ * @disk_bytes: (out) (optional): a location to store the bytes of scrollback on disk, or %NULL
+ * @memory_bytes: (out) (optional): a location to store the bytes of rows in memory, or %NULL
+ *
+ * Gets the current usage of all terminals in the process, as limited by
+ * bte_set_scrollback_budget(). The size on disk is before compression,
+ * so the actual files are usually much smaller.
+ *
+ * Since: 0.66
+ */
+void
+bte_get_scrollback_usage(guint64 *disk_bytes,
+                         guint64 *memory_bytes) noexcept
+{
+        uint64_t disk, memory;
+        bte::base::ScrollbackBudget::get().usage(disk, memory);
+        if (disk_bytes)
+                *disk_bytes = disk;
+        if (memory_bytes)
+                *memory_bytes = memory;
+}
+
 /**
  * bte_get_encodings:
  * @include_aliases: whether to include alias names
@@ -5338,6 +5402,120 @@ catch (...)
         return 0;
 }
 
+/**
+ * bte_terminal_set_scrollback_session:
+ * @terminal: a #BteTerminal
+ * @path: a directory
+ * @error: (allow-none): return location for a #GError, or %NULL
+ *
+ * Keeps the scrollback of the normal screen buffer in files in @path, which
+ * is created if it doesn't exist, and saves it there when @terminal is
+ * destroyed. If @path contains a session saved like this, it's restored, so
+ * the scrollback of a previous terminal is shown above the new output; the
+ * current contents of the normal screen buffer are discarded.
+ *
+ * The session contains the scrollback's encryption keys, so @path must be
+ * owned by the user and only accessible to them. Only one terminal can use
+ * @path at a time. The session is lost if the process doesn't destroy
+ * @terminal, e.g. when it crashes.
+ *
+ * Returns: %TRUE on success, or %FALSE with @error set if the directory could
+ *   not be created or the saved session could not be restored. If @path is
+ *   accessible to others, or in use by another terminal, nothing changes
+ *   and @terminal keeps its previous session, if any.
+ *
+ * Since: 0.66
+ */
+gboolean
+bte_terminal_set_scrollback_session(BteTerminal *terminal,
+                                    const char *path,
+                                    GError **error) noexcept
+try
+{
+        g_return_val_if_fail(BTE_IS_TERMINAL(terminal), FALSE);
+        g_return_val_if_fail(path != nullptr, FALSE);
+        g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+        return IMPL(terminal)->set_scrollback_session(path, error);
+}
+catch (...)
+{
+        return bte::glib::set_error_from_exception(error);
+}
+
+/**
+ * bte_terminal_get_scrollback_session:
+ * @terminal: a #BteTerminal
+ *
+ * Returns: (nullable) (transfer none): the directory set with
+ *   bte_terminal_set_scrollback_session(), or %NULL
+ *
+ * Since: 0.66
+ */
+const char *
+bte_terminal_get_scrollback_session(BteTerminal *terminal) noexcept
+try
+{
+        g_return_val_if_fail(BTE_IS_TERMINAL(terminal), nullptr);
+        auto const& session = IMPL(terminal)->scrollback_session();
+        return session.empty() ? nullptr : session.c_str();
+}
+catch (...)
+{
+        bte::log_exception();
+        return nullptr;
+}
+
+/**
+ * bte_terminal_set_clipboard_write_limit:
+ * @terminal: a #BteTerminal
+ * @limit: the maximum size in bytes, or 0
+ *
+ * Allows the child to put text on the clipboard and on the primary selection
+ * with the OSC 52 escape sequence, as long as the decoded text is no longer
+ * than @limit bytes; text that is longer is dropped. The base64 data is
+ * decoded while it arrives, so it doesn't need to be held in full.
+ *
+ * If @limit is 0, which is the default, OSC 52 is ignored. Reading the
+ * clipboard with OSC 52 is not supported.
+ *
+ * Since: 0.66
+ */
+void
+bte_terminal_set_clipboard_write_limit(BteTerminal *terminal,
+                                       gsize limit) noexcept
+try
+{
+        g_return_if_fail(BTE_IS_TERMINAL(terminal));
+
+        IMPL(terminal)->set_clipboard_write_limit(limit);
+}
+catch (...)
+{
+        bte::log_exception();
+}
+
+/**
+ * bte_terminal_get_clipboard_write_limit:
+ * @terminal: a #BteTerminal
+ *
+ * Returns: the limit set with bte_terminal_set_clipboard_write_limit()
+ *
+ * Since: 0.66
+ */
+gsize
+bte_terminal_get_clipboard_write_limit(BteTerminal *terminal) noexcept
+try
+{
+        g_return_val_if_fail(BTE_IS_TERMINAL(terminal), 0);
+        return IMPL(terminal)->clipboard_write_limit();
+}
+catch (...)
+{
+        bte::log_exception();
+        return 0;
+}
+
 /**
  * bte_terminal_set_scroll_on_keystroke:
  * @terminal: a #BteTerminal
@@ -5550,6 +5728,55 @@ catch (...)
         return bte::glib::set_error_from_exception(error);
 }
 
+/**
+ * bte_terminal_get_statistics:
+ * @terminal: a #BteTerminal
+ *
+ * Returns counters and histograms about what @terminal has done since it
+ * was created, for diagnosing performance problems. They are always
+ * collected, independent of %BTE_DEBUG.
+ *
+ * The result is a dictionary with these entries:
+ * - "bytes-read" (t): the number of bytes read from the PTY
+ * - "bytes-processed" ((ttat)): the number of bytes processed per cycle
+ * - "process-time" ((ttat)): the time spent processing per cycle, in µs
+ * - "sequences" (a{st}): the number of parsed sequences by type, e.g. "graphic" or "csi"
+ * - "invalidated-rects" (t): the number of invalidated rectangles
+ * - "draw-time" ((ttat)): the time spent drawing per frame, in µs
+ * - "ring-freezes", "ring-thaws" (t): the number of rows moved to and from
+ *   the scrollback streams
+ * - "stream-block-reads", "stream-block-writes" (t): the number of blocks read
+ *   from and written to the scrollback files
+ * - "stream-bytes-uncompressed", "stream-bytes-compressed" (t): the number of
+ *   bytes written, before and after compression
+ * - "stream-compression-ratio" (d): the ratio of the two, or 0 if nothing was written
+ * - "font-cache-hits", "font-cache-misses" (t): glyph cache lookups of the
+ *   fonts in use; these are shared with other terminals using the same font
+ *
+ * A histogram is the number of values, their sum, and 32 buckets: bucket 0
+ * counts the value 0, bucket i counts the values from 2^(i-1) to 2^i - 1,
+ * and the last bucket all larger values too.
+ *
+ * More entries may be added in the future.
+ *
+ * Returns: (transfer full): a new #GVariant of type "a{sv}"
+ *
+ * Since: 0.66
+ */
+GVariant*
+bte_terminal_get_statistics(BteTerminal *terminal) noexcept
+try
+{
+        g_return_val_if_fail(BTE_IS_TERMINAL(terminal), nullptr);
+
+        return g_variant_ref_sink(IMPL(terminal)->statistics());
+}
+catch (...)
+{
+        bte::log_exception();
+        return nullptr;
+}
+
 /**
  * bte_terminal_set_clear_background:
  * @terminal: a #BteTerminal
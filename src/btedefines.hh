@@ -82,6 +82,11 @@
 #define BTE_CHILD_INPUT_PRIORITY	G_PRIORITY_DEFAULT_IDLE
 #define BTE_CHILD_OUTPUT_PRIORITY	G_PRIORITY_HIGH
 #define BTE_MAX_INPUT_READ		0x1000
+/* While pasting, convert and queue this many bytes of the paste for the child
+ * at a time, whenever less than BTE_OUTGOING_LOW_WATER bytes are waiting to be
+ * written. */
+#define BTE_PASTE_PULL_SIZE		0x10000
+#define BTE_OUTGOING_LOW_WATER		0x10000
 #define BTE_DISPLAY_TIMEOUT		10
 #define BTE_UPDATE_TIMEOUT		15
 #define BTE_UPDATE_REPEAT_TIMEOUT	30
@@ -140,6 +145,26 @@
 /* Maximum length of a paragraph, in lines, that might get proper RingView (BiDi) treatment. */
 #define BTE_RINGVIEW_PARAGRAPH_LENGTH_MAX   500
 
+/* Number of paragraphs whose BiDi mapping a RingView keeps cached before forgetting the no longer displayed ones. */
+#define BTE_RINGVIEW_BIDI_CACHE_SIZE_MAX   256
+
+/* On resize, rings longer than this many rows are rewrapped from the top of the
+ * viewport down right away, and above that in the background. */
+#define BTE_REWRAP_LAZY_ROWS_MIN   10000
+
+/* Number of rows to rewrap in the background in one go. */
+#define BTE_REWRAP_LAZY_STEP_ROWS  5000
+
+/* Rewrapping splits the scrollback into paragraph aligned chunks of about this
+ * many bytes of text, and processes them on up to BTE_REWRAP_THREADS_MAX threads.
+ * Longer paragraphs are split, so this also bounds the memory of one chunk. */
+#define BTE_REWRAP_CHUNK_SIZE      (1024 * 1024)
+#define BTE_REWRAP_THREADS_MAX     8
+
+/* A terminal that got no output and didn't have the focus for this many seconds
+ * releases the memory it can rebuild on demand, see Terminal::idle_trim(). */
+#define BTE_IDLE_TRIM_TIMEOUT      (30)
+
 #define BTE_VERSION_NUMERIC ((BTE_MAJOR_VERSION) * 10000 + (BTE_MINOR_VERSION) * 100 + (BTE_MICRO_VERSION))
 
 #define BTE_TERMINFO_NAME "xterm-256color"
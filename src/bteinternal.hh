@@ -39,12 +39,17 @@
 #include "reaper.hh"
 #include "ring.hh"
 #include "ringview.hh"
+#include "base64.hh"
 #include "buffer.h"
 #include "parser.hh"
 #include "parser-glue.hh"
 #include "modes.hh"
+#include "paste.hh"
 #include "tabstops.hh"
+#include "a11y-damage.hh"
 #include "refptr.hh"
+#include "scrollback-budget.hh"
+#include "statistics.hh"
 
 #include "btepcre2.h"
 #include "bteregexinternal.hh"
@@ -464,7 +469,23 @@ private:
         double m_y;
 }; // class MouseEvent
 
-class Terminal {
+/*
+ * TextSink:
+ *
+ * Receives the text of a range of the terminal from Terminal::stream_text(),
+ * one row at a time, as runs of UTF-8 text whose cells have equal visual
+ * attributes. Newlines are passed with a %nullptr @attr.
+ */
+class TextSink {
+public:
+        virtual ~TextSink() = default;
+
+        virtual void append(char const* text,
+                            size_t len,
+                            BteCellAttr const* attr) = 0;
+}; // class TextSink
+
+class Terminal : private bte::base::ScrollbackBudget::Client {
         friend class bte::platform::Widget;
 
 private:
@@ -623,8 +644,19 @@ public:
         size_t m_input_bytes;
         long m_max_input_bytes{BTE_MAX_INPUT_READ};
 
-	/* Output data queue. */
-        BteByteArray *m_outgoing; /* pending input characters */
+        /* Always collected, see bte_terminal_get_statistics() */
+        bte::terminal::Statistics m_statistics{};
+
+	/* Output data queue, pending input characters.
+         * Chunks are appended at the back, and written from the front;
+         * the first m_outgoing_offset bytes of the front chunk are already written.
+         */
+        std::queue<bte::base::Chunk::unique_type, std::list<bte::base::Chunk::unique_type>> m_outgoing_queue;
+        size_t m_outgoing_offset{0};
+        size_t m_outgoing_bytes{0};
+
+        /* Paste in progress, and the input to send after it */
+        bte::terminal::PasteQueue m_paste_queue;
 
 #ifdef WITH_ICU
         /* Legacy charset support */
@@ -675,11 +707,38 @@ public:
 
 	/* Clipboard data information. */
         bool m_selection_owned[LAST_BTE_SELECTION];
-        BteFormat m_selection_format[LAST_BTE_SELECTION];
         bool m_changing_selection;
-        GString *m_selection[LAST_BTE_SELECTION];  // FIXMEegmont rename this so that m_selection_resolved can become m_selection?
+        /* The clipboard contents are only rendered from the span when a target
+         * is requested, or before the terminal contents change (see
+         * clipboard_materialize()), whichever comes first.
+         */
+        struct ClipboardContents {
+                bte::grid::span span{};
+                bool block{false};
+                bool pending{false};
+                BteFormat format{BTE_FORMAT_TEXT};
+                GString* text{nullptr};
+                GString* html{nullptr};
+        };
+        ClipboardContents m_selection[LAST_BTE_SELECTION];  // FIXMEegmont rename this so that m_selection_resolved can become m_selection?
         CtkClipboard *m_clipboard[LAST_BTE_SELECTION];
 
+        /* OSC 52 writes to the clipboard are decoded piecewise while the
+         * sequence arrives, straight into the clipboard contents; see
+         * clipboard_write_stream().
+         */
+        struct ClipboardWrite {
+                unsigned int string_id{0}; /* of the OSC string */
+                size_t prefix_len{0};      /* of "52;selections;" */
+                bool selections[LAST_BTE_SELECTION]{};
+                bool active{false};
+                bool failed{false};
+                bte::base::Base64Decoder decoder{};
+                GString* data{nullptr};
+        };
+        ClipboardWrite m_clipboard_write{};
+        size_t m_clipboard_write_limit{0}; /* 0 disables OSC 52 */
+
         ClipboardTextRequestCtk<Terminal> m_paste_request;
 
 	/* Miscellaneous options. */
@@ -689,6 +748,10 @@ public:
         bool m_allow_bold{true};
         bool m_bold_is_bright{false};
         bool m_rewrap_on_resize{true};
+        bool rewrap_timer_callback();
+        bte::glib::Timer m_rewrap_timer{std::bind(&Terminal::rewrap_timer_callback,
+                                                  this),
+                                        "rewrap-timer"};
         gboolean m_text_modified_flag;
         gboolean m_text_inserted_flag;
         gboolean m_text_deleted_flag;
@@ -697,6 +760,7 @@ public:
         bool m_scroll_on_output{false};
         bool m_scroll_on_keystroke{true};
         bte::grid::row_t m_scrollback_lines{0};
+        std::string m_scrollback_session{};
 
         /* Restricted scrolling */
         struct bte_scrolling_region m_scrolling_region;     /* the region we scroll in */
@@ -719,6 +783,13 @@ public:
         gint64 m_cursor_blink_time;         /* how long the cursor has been blinking yet */
         bool m_has_focus{false};            /* is the widget focused */
 
+        /* Idle trimming, see idle_trim() */
+        bool idle_trim_timer_callback();
+        bte::glib::Timer m_idle_trim_timer{std::bind(&Terminal::idle_trim_timer_callback,
+                                                     this),
+                                           "idle-trim-timer"};
+        gint64 m_last_activity_time{0};
+
         /* Contents blinking */
         bool text_blink_timer_callback();
         bte::glib::Timer m_text_blink_timer{std::bind(&Terminal::text_blink_timer_callback,
@@ -909,6 +980,9 @@ public:
 
         #ifdef WITH_A11Y
         gboolean m_accessible_emit;
+
+        /* Rows the accessible needs to look at again, see accessible_take_damage(). */
+        bte::terminal::AccessibleDamage m_accessible_damage{};
         #endif
 
         /* Adjustment updates pending. */
@@ -1034,6 +1108,7 @@ public:
         void invalidate_symmetrical_difference(bte::grid::span const& a, bte::grid::span const& b, bool block);
         void invalidate_match_span();
         void invalidate_all();
+        void invalidate_view();
 
         guint8 get_bidi_flags() const noexcept;
         void apply_bidi_attributes(bte::grid::row_t start, guint8 bidi_flags, guint8 bidi_flags_mask);
@@ -1043,6 +1118,12 @@ public:
         bool invalidate_dirty_rects_and_process_updates();
         void time_process_incoming();
         void process_incoming();
+        GVariant* statistics() const;
+        void scrollback_usage(uint64_t& disk,
+                              uint64_t& memory) const noexcept override;
+        uint64_t evict_scrollback(uint64_t bytes) override;
+        void note_activity();
+        void idle_trim();
         void process_incoming_utf8();
         #ifdef WITH_ICU
         void process_incoming_pcterm();
@@ -1196,6 +1277,11 @@ public:
                           GIOCondition const condition);
 
         void send_child(std::string_view const& data);
+        void queue_child(std::string_view const& data);
+        void outgoing_append(std::string_view const& data);
+        void outgoing_clear();
+        void paste_pull();
+        void paste_flush();
 
         void watch_child (pid_t child_pid);
         bool terminate_child () noexcept;
@@ -1246,9 +1332,22 @@ public:
 
         GString* get_text_displayed_a11y(bool wrap,
                                          GArray* attributes = nullptr);
+        GString* get_text_displayed_a11y_rows(bte::grid::row_t start_row,
+                                              bte::grid::row_t end_row,
+                                              bool wrap,
+                                              GArray* attributes = nullptr);
 
         GString* get_selected_text(GArray* attributes = nullptr);
 
+        void stream_text(bte::grid::row_t start_row,
+                         bte::grid::column_t start_col,
+                         bte::grid::row_t end_row,
+                         bte::grid::column_t end_col,
+                         bool block,
+                         TextSink& sink);
+        void stream_selected_text(TextSink& sink);
+        bool selected_text_equals(GString const* text);
+
         template<unsigned int redbits, unsigned int greenbits, unsigned int bluebits>
         inline void rgb_from_index(guint index,
                                    bte::color::rgb& color) const;
@@ -1269,12 +1368,25 @@ public:
                                             guint *pback,
                                             guint *pdeco) const;
 
-        char *cellattr_to_html(BteCellAttr const* attr,
-                               char const* text) const;
-        BteCellAttr const* char_to_cell_attr(BteCharAttributes const* attr) const;
-
-        GString* attributes_to_html(GString* text_string,
-                                    GArray* attrs);
+        GString* get_html(bte::grid::span const& span,
+                          bool block);
+
+        GString* clipboard_contents(BteSelection sel,
+                                    BteFormat format);
+        void clipboard_materialize();
+        void clipboard_clear_contents(BteSelection sel) noexcept;
+        void clipboard_take_ownership(BteSelection sel,
+                                      BteFormat format);
+
+        void clipboard_write_reset() noexcept;
+        bool clipboard_write_start(uint32_t const* str,
+                                   size_t len,
+                                   unsigned int id) noexcept;
+        void clipboard_write_feed(uint32_t const* str,
+                                  size_t len,
+                                  unsigned int id) noexcept;
+        void clipboard_write_stream() noexcept;
+        void clipboard_write_finish(bte::parser::Sequence const& seq);
 
         void start_selection(bte::view::coords const& pos,
                              SelectionType type);
@@ -1307,6 +1419,7 @@ public:
                              long old_columns,
                              long old_rows,
                              bool do_rewrap);
+        void screen_rewrap_commit(BteScreen *screen_);
 
         void vadjustment_value_changed();
 
@@ -1477,6 +1590,8 @@ public:
         bool set_cell_height_scale(double scale);
         bool set_cell_width_scale(double scale);
         bool set_cjk_ambiguous_width(int width);
+        bool set_clipboard_write_limit(size_t limit);
+        inline constexpr auto clipboard_write_limit() const noexcept { return m_clipboard_write_limit; }
         void set_color_background(bte::color::rgb const &color);
         void set_color_bold(bte::color::rgb const& color);
         void reset_color_bold();
@@ -1511,6 +1626,9 @@ public:
         bool set_mouse_autohide(bool autohide);
         bool set_rewrap_on_resize(bool rewrap);
         bool set_scrollback_lines(long lines);
+        bool set_scrollback_session(char const* path,
+                                    GError** error);
+        inline auto const& scrollback_session() const noexcept { return m_scrollback_session; }
         bool set_scroll_on_keystroke(bool scroll);
         bool set_scroll_on_output(bool scroll);
         bool set_word_char_exceptions(std::optional<std::string_view> stropt);
@@ -1590,6 +1708,11 @@ public:
                                    bte::grid::column_t end_col);
 
         void subscribe_accessible_events();
+        void accessible_damage_rows(bte::grid::row_t row_start,
+                                    bte::grid::row_t row_end /* exclusive */);
+        bool accessible_take_damage(bte::grid::row_t* top_row,
+                                    bte::grid::row_t* start_row,
+                                    bte::grid::row_t* end_row);
         void select_text(bte::grid::column_t start_col,
                          bte::grid::row_t start_row,
                          bte::grid::column_t end_col,
@@ -25,7 +25,9 @@
 
 #include <string.h>
 
+#include <array>
 #include <type_traits>
+#include <vector>
 
 /* This will be true now that BteCell is POD, but make sure it'll be true
  * once that changes.
@@ -55,23 +57,138 @@ _bte_cells_for_cell_array (BteCell *cells)
 	return (BteCells *) (((guchar *) cells) - G_STRUCT_OFFSET (BteCells, cells));
 }
 
+/*
+ * Free cell arrays, kept per size class for reuse.
+ *
+ * Cell arrays only come in sizes of 2^n - 1 cells, starting at 127, so a
+ * terminal's rows mostly share one or two classes. Freeing a row (e.g. when
+ * the RingView is paused, or a ring goes away) puts its cells here, and
+ * the next row of that class takes them instead of going to malloc. Each
+ * thread has its own pool, so this needs no locking.
+ */
+
+#define BTE_CELLS_MIN_BITS 7   /* 127 cells */
+#define BTE_CELLS_MAX_BITS 16  /* 65535 cells, see _bte_row_data_ensure() */
+#define BTE_CELLS_POOL_CLASSES (BTE_CELLS_MAX_BITS - BTE_CELLS_MIN_BITS + 1)
+#define BTE_CELLS_POOL_MAX_BYTES (512 * 1024)  /* per class, but at least one array */
+
+static inline gsize
+_bte_cells_size (guint32 alloc_len)
+{
+	return G_STRUCT_OFFSET (BteCells, cells) + alloc_len * sizeof (BteCell);
+}
+
+namespace {
+
+class CellsPool {
+public:
+	CellsPool() = default;
+	~CellsPool() { clear(); }
+
+	CellsPool(CellsPool const&) = delete;
+	CellsPool(CellsPool&&) = delete;
+	CellsPool& operator= (CellsPool const&) = delete;
+	CellsPool& operator= (CellsPool&&) = delete;
+
+	/* Returns the size class of @alloc_len, or -1 if it isn't pooled */
+	static inline int size_class (guint32 alloc_len)
+	{
+		auto const bits = int(g_bit_storage (alloc_len));
+		if (alloc_len != (1u << bits) - 1 ||
+		    bits < BTE_CELLS_MIN_BITS || bits > BTE_CELLS_MAX_BITS)
+			return -1;
+
+		return bits - BTE_CELLS_MIN_BITS;
+	}
+
+	inline BteCells* take (int klass)
+	{
+		auto& arrays = m_arrays[klass];
+		if (arrays.empty())
+			return nullptr;
+
+		auto const cells = arrays.back();
+		arrays.pop_back();
+		return cells;
+	}
+
+	inline bool give (BteCells* cells)
+	{
+		auto const klass = size_class (cells->alloc_len);
+		if (klass == -1)
+			return false;
+
+		auto& arrays = m_arrays[klass];
+		if (!arrays.empty() &&
+		    (arrays.size() + 1) * _bte_cells_size (cells->alloc_len) > BTE_CELLS_POOL_MAX_BYTES)
+			return false;
+
+		arrays.push_back (cells);
+		return true;
+	}
+
+	void clear ()
+	{
+		for (auto& arrays : m_arrays) {
+			for (auto cells : arrays)
+				g_free (cells);
+			arrays.clear();
+			arrays.shrink_to_fit();
+		}
+	}
+
+private:
+	std::array<std::vector<BteCells*>, BTE_CELLS_POOL_CLASSES> m_arrays{};
+};
+
+} // anonymous namespace
+
+static thread_local CellsPool cells_pool;
+
 static BteCells *
 _bte_cells_realloc (BteCells *cells, guint32 len)
 {
 	guint32 alloc_len = (1 << g_bit_storage (MAX (len, 80))) - 1;
 
 	_bte_debug_print(BTE_DEBUG_RING, "Enlarging cell array of %d cells to %d cells\n", cells ? cells->alloc_len : 0, alloc_len);
-	cells = (BteCells *)g_realloc (cells, G_STRUCT_OFFSET (BteCells, cells) + alloc_len * sizeof (cells->cells[0]));
-	cells->alloc_len = alloc_len;
 
-	return cells;
+	auto const klass = CellsPool::size_class (alloc_len);
+	auto new_cells = klass != -1 ? cells_pool.take (klass) : nullptr;
+	if (!new_cells) {
+		if (!cells || CellsPool::size_class (cells->alloc_len) == -1) {
+			/* Not pooled, so let realloc try to grow it in place */
+			cells = (BteCells *)g_realloc (cells, _bte_cells_size (alloc_len));
+			cells->alloc_len = alloc_len;
+			return cells;
+		}
+
+		new_cells = (BteCells *)g_malloc (_bte_cells_size (alloc_len));
+	}
+
+	new_cells->alloc_len = alloc_len;
+	if (cells) {
+		memcpy (new_cells->cells, cells->cells, MIN (cells->alloc_len, alloc_len) * sizeof (cells->cells[0]));
+		if (!cells_pool.give (cells))
+			g_free (cells);
+	}
+
+	return new_cells;
 }
 
 static void
 _bte_cells_free (BteCells *cells)
 {
 	_bte_debug_print(BTE_DEBUG_RING, "Freeing cell array of %d cells\n", cells->alloc_len);
-	g_free (cells);
+
+	if (!cells_pool.give (cells))
+		g_free (cells);
+}
+
+/* Frees the pooled cell arrays of the calling thread */
+void
+_bte_row_data_pool_trim (void)
+{
+	cells_pool.clear ();
 }
 
 
@@ -85,6 +202,17 @@ _bte_row_data_init (BteRowData *row)
 	memset (row, 0, sizeof (*row));
 }
 
+/* Returns the size of the cell array allocated for @row */
+gsize
+_bte_row_data_alloc_size (const BteRowData *row)
+{
+	BteCells *cells = _bte_cells_for_cell_array (row->cells);
+	if (!cells)
+		return 0;
+
+	return _bte_cells_size (cells->alloc_len);
+}
+
 void
 _bte_row_data_clear (BteRowData *row)
 {
@@ -140,6 +268,28 @@ void _bte_row_data_append (BteRowData *row, const BteCell *cell)
 	row->len++;
 }
 
+/* Appends a cell in @attr for each of the @len bytes of @text, which must
+ * be ASCII */
+void _bte_row_data_append_ascii (BteRowData *row, const char *text, gulong len, const BteCellAttr *attr)
+{
+	BteCell *cells;
+	gulong i;
+
+	if (G_UNLIKELY (!_bte_row_data_ensure (row, row->len + len))) {
+		/* Append what fits, like _bte_row_data_append() does */
+		len = row->len < 0xFFFE ? 0xFFFE - row->len : 0;
+		if (!len || !_bte_row_data_ensure (row, row->len + len))
+			return;
+	}
+
+	cells = row->cells + row->len;
+	for (i = 0; i < len; i++) {
+		cells[i].c = (guchar) text[i];
+		cells[i].attr = *attr;
+	}
+	row->len += len;
+}
+
 void _bte_row_data_remove (BteRowData *row, gulong col)
 {
 	gulong i;
@@ -172,6 +322,24 @@ void _bte_row_data_shrink (BteRowData *row, gulong max_len)
 		row->len = max_len;
 }
 
+/* Shrinks the cell array to the length of the row, or frees it if the row is empty */
+void _bte_row_data_compact (BteRowData *row)
+{
+	BteCells *cells = _bte_cells_for_cell_array (row->cells);
+	if (!cells || cells->alloc_len == row->len)
+		return;
+
+	if (row->len == 0) {
+		_bte_cells_free (cells);
+		row->cells = NULL;
+		return;
+	}
+
+	cells = (BteCells *)g_realloc (cells, _bte_cells_size (row->len));
+	cells->alloc_len = row->len;
+	row->cells = cells->cells;
+}
+
 void _bte_row_data_copy (const BteRowData *src, BteRowData *dst)
 {
         _bte_row_data_ensure (dst, src->len);
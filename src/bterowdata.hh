@@ -72,15 +72,90 @@ _bte_row_data_get_writable (BteRowData *row, gulong col)
 	return &row->cells[col];
 }
 
+/*
+ * Checks whether all cells of @row have the same attributes and each holds
+ * a single character from the BMP, and whether they're all printable ASCII.
+ * Such a row can be frozen in one go, see Ring::freeze_row().
+ *
+ * The attrs are compared as two 64-bit words, and the loop has no branches
+ * or early exits; rows are short enough that scanning a complex row to the
+ * end costs less than the branches would.
+ */
+static inline bool
+_bte_row_data_is_uniform (const BteRowData *row,
+                          bool *is_ascii)
+{
+        BteCell const* cells = row->cells;
+        uint64_t first[2], differ = 0;
+        uint32_t wide = 0, non_ascii = 0;
+
+        memcpy(first, &cells[0].attr, sizeof (first));
+        for (int i = 0; i < row->len; i++) {
+                uint64_t attr[2];
+                memcpy(attr, &cells[i].attr, sizeof (attr));
+                differ |= (attr[0] ^ first[0]) | (attr[1] ^ first[1]);
+
+                uint32_t const c = cells[i].c;
+                wide |= c >> 16;
+                non_ascii |= uint32_t(c - 32) > 126 - 32;
+        }
+
+        *is_ascii = non_ascii == 0;
+        return differ == 0 && wide == 0 && !cells[0].attr.fragment();
+}
+
+/*
+ * Appends the characters of @row to @buffer as UTF-8, for rows that passed
+ * _bte_row_data_is_uniform().
+ */
+static inline void
+_bte_row_data_append_utf8 (const BteRowData *row,
+                           bool is_ascii,
+                           GString *buffer)
+{
+        BteCell const* cells = row->cells;
+        gsize const start = buffer->len;
+
+        if (is_ascii) {
+                g_string_set_size (buffer, start + row->len);
+                char* p = buffer->str + start;
+                for (int i = 0; i < row->len; i++)
+                        p[i] = char(cells[i].c);
+                return;
+        }
+
+        /* At most 3 bytes per BMP character */
+        g_string_set_size (buffer, start + 3 * row->len);
+        auto p = reinterpret_cast<guchar*>(buffer->str + start);
+        for (int i = 0; i < row->len; i++) {
+                uint32_t const c = cells[i].c;
+                if (c < 0x80) {
+                        *p++ = c;
+                } else if (c < 0x800) {
+                        *p++ = 0xc0 | (c >> 6);
+                        *p++ = 0x80 | (c & 0x3f);
+                } else {
+                        *p++ = 0xe0 | (c >> 12);
+                        *p++ = 0x80 | ((c >> 6) & 0x3f);
+                        *p++ = 0x80 | (c & 0x3f);
+                }
+        }
+        g_string_set_size (buffer, reinterpret_cast<char*>(p) - buffer->str);
+}
+
 void _bte_row_data_init (BteRowData *row);
 void _bte_row_data_clear (BteRowData *row);
 void _bte_row_data_fini (BteRowData *row);
 void _bte_row_data_insert (BteRowData *row, gulong col, const BteCell *cell);
 void _bte_row_data_append (BteRowData *row, const BteCell *cell);
+void _bte_row_data_append_ascii (BteRowData *row, const char *text, gulong len, const BteCellAttr *attr);
 void _bte_row_data_remove (BteRowData *row, gulong col);
 void _bte_row_data_fill (BteRowData *row, const BteCell *cell, gulong len);
 void _bte_row_data_shrink (BteRowData *row, gulong max_len);
+void _bte_row_data_compact (BteRowData *row);
 void _bte_row_data_copy (const BteRowData *src, BteRowData *dst);
 guint16 _bte_row_data_nonempty_length (const BteRowData *row);
+gsize _bte_row_data_alloc_size (const BteRowData *row);
+void _bte_row_data_pool_trim (void);
 
 G_END_DECLS
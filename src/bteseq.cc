@@ -6493,6 +6493,10 @@ Terminal::OSC(bte::parser::Sequence const& seq)
                 reset_color(BTE_HIGHLIGHT_FG, BTE_COLOR_SOURCE_ESCAPE);
                 break;
 
+        case BTE_OSC_XTERM_SET_XSELECTION:
+                clipboard_write_finish(seq);
+                break;
+
         case BTE_OSC_XTERM_SET_XPROPERTY:
         case BTE_OSC_XTERM_SET_COLOR_MOUSE_CURSOR_FG:
         case BTE_OSC_XTERM_SET_COLOR_MOUSE_CURSOR_BG:
@@ -6501,7 +6505,6 @@ Terminal::OSC(bte::parser::Sequence const& seq)
         case BTE_OSC_XTERM_SET_COLOR_TEK_CURSOR:
         case BTE_OSC_XTERM_LOGFILE:
         case BTE_OSC_XTERM_SET_FONT:
-        case BTE_OSC_XTERM_SET_XSELECTION:
         case BTE_OSC_XTERM_SET_COLOR_MODE:
         case BTE_OSC_XTERM_RESET_COLOR_MOUSE_CURSOR_FG:
         case BTE_OSC_XTERM_RESET_COLOR_MOUSE_CURSOR_BG:
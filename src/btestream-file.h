@@ -70,7 +70,8 @@
  *   requests are batched up until there's a complete block to be compressed,
  *   encrypted and written to disk. Read requests are answered by reading,
  *   decrypting and uncompressing possibly more underlying blocks, and sped up
- *   by caching the result.
+ *   by caching the result. Large reads bypass the cache, and have their whole
+ *   blocks decrypted and uncompressed in batches on several threads.
  *
  * Design discussions: https://bugzilla.gnome.org/show_bug.cgi?id=738601
  */
@@ -84,7 +85,7 @@
 #include <unistd.h>
 #include <zlib.h>
 
-#ifdef WITH_GNUTLS
+#ifdef WITH_STREAM_ENCRYPTION
 # include <gnutls/gnutls.h>
 # include <gnutls/crypto.h>
 #endif
@@ -93,7 +94,7 @@
 
 G_BEGIN_DECLS
 
-#ifdef WITH_GNUTLS
+#ifdef WITH_STREAM_ENCRYPTION
 /* Currently the code requires that a stream cipher (e.g. GCM) is used
  * which can encrypt any amount of data without need for padding. */
 # define BTE_CIPHER_ALGORITHM    GNUTLS_CIPHER_AES_256_GCM
@@ -121,6 +122,11 @@ typedef guint8 _bte_overwrite_counter_t;
 #define BTE_OVERWRITE_COUNTER_SIZE sizeof(_bte_overwrite_counter_t)
 #define BTE_BOA_BLOCKSIZE (BTE_SNAKE_BLOCKSIZE - BTE_BLOCK_DATALENGTH_SIZE - BTE_OVERWRITE_COUNTER_SIZE - BTE_CIPHER_TAG_SIZE)
 
+/* Reads of many whole blocks decrypt and uncompress up to BTE_BOA_READ_BATCH
+ * of them in one go, on up to BTE_BOA_READ_THREADS threads. */
+#define BTE_BOA_READ_BATCH      16
+#define BTE_BOA_READ_THREADS    4
+
 #define OFFSET_BOA_TO_SNAKE(x) ((x) / BTE_BOA_BLOCKSIZE * BTE_SNAKE_BLOCKSIZE)
 #define ALIGN_BOA(x) ((x) / BTE_BOA_BLOCKSIZE * BTE_BOA_BLOCKSIZE)
 #define MOD_BOA(x)   ((x) % BTE_BOA_BLOCKSIZE)
@@ -339,6 +345,9 @@ _file_write (int fd, const char *data, gsize len, gsize offset)
 typedef struct _BteSnake {
         GObject parent;
         int fd;
+        char *dir;              /* If set, the file is created here with a name, rather than anonymously. */
+        char *path;             /* The file's name in that case. */
+        gboolean keep;          /* Whether to keep that file when done, see _bte_file_stream_save_session(). */
         int state;
         struct {
                 gsize st_tail;  /* Stream's logical tail offset. */
@@ -380,6 +389,10 @@ _bte_snake_finalize (GObject *object)
         BteSnake *snake = (BteSnake *) object;
 
         _file_close (snake->fd);
+        if (snake->path != NULL && !snake->keep)
+                unlink (snake->path);
+        g_free (snake->path);
+        g_free (snake->dir);
 
         G_OBJECT_CLASS (_bte_snake_parent_class)->finalize(object);
 }
@@ -390,6 +403,16 @@ _bte_snake_ensure_file (BteSnake *snake)
         if (G_LIKELY (snake->fd != -1))
                 return;
 
+        if (snake->dir != NULL) {
+                char *path = g_build_filename (snake->dir, "streamXXXXXX", NULL);
+                snake->fd = g_mkstemp_full (path, O_RDWR | O_CLOEXEC, 0600);
+                if (snake->fd != -1)
+                        snake->path = path;
+                else
+                        g_free (path);
+                return;
+        }
+
         snake->fd = _bte_mkstemp ();
 }
 
@@ -629,7 +652,7 @@ _bte_snake_class_init (BteSnakeClass *klass)
  * - T..64k (T..10): Area not written to the file, most of that leaving sparse FS blocks (dots for unit testing)
  */
 
-#if !defined BTESTREAM_MAIN && defined WITH_GNUTLS
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
         /* The IV (nonce) consists of the offset within the stream, and an overwrite counter so that
          * we don't reuse the same IVs when a block at a certain logical offset is overwritten.
          * The padding is there to make sure the structure is at least BTE_CIPHER_IV_SIZE bytes large.
@@ -646,11 +669,19 @@ typedef struct _BteBoa {
         BteSnake parent;
         gsize tail, head;
 
-#if !defined BTESTREAM_MAIN && defined WITH_GNUTLS
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
         gnutls_cipher_hd_t cipher_hd;
         BteIv iv;
+        /* A cipher handle can only be used by one thread at a time, so the
+         * other threads of a batched read have their own ones, created when
+         * first needed from the key. */
+        gnutls_cipher_hd_t worker_cipher_hd[BTE_BOA_READ_THREADS - 1];
+        unsigned char *key;
 #endif
         int compressBound;
+
+        /* Not owned, may be NULL */
+        BteStreamStatistics *statistics;
 } BteBoa;
 
 typedef struct _BteBoaClass {
@@ -679,7 +710,7 @@ static void
 _bte_boa_encrypt (BteBoa *boa, gsize offset, guint32 overwrite_counter, char *data, unsigned int len)
 {
 #ifndef BTESTREAM_MAIN
-# ifdef WITH_GNUTLS
+# ifdef WITH_STREAM_ENCRYPTION
         boa->iv.offset = offset;
         boa->iv.overwrite_counter = overwrite_counter;
         gnutls_cipher_set_iv (boa->cipher_hd, &boa->iv, BTE_CIPHER_IV_SIZE);
@@ -701,21 +732,26 @@ _bte_boa_encrypt (BteBoa *boa, gsize offset, guint32 overwrite_counter, char *da
 #endif
 }
 
-/* Decrypt: data is len bytes of data + BTE_CIPHER_TAG_SIZE more bytes of tag. Returns FALSE on tag mismatch. */
+/* Decrypt: data is len bytes of data + BTE_CIPHER_TAG_SIZE more bytes of tag. Returns FALSE on tag mismatch.
+ * worker is the thread's index within a batched read, 0 for the calling thread. */
 static gboolean
-_bte_boa_decrypt (BteBoa *boa, gsize offset, guint32 overwrite_counter, char *data, unsigned int len)
+_bte_boa_decrypt_on_worker (BteBoa *boa, unsigned int worker, gsize offset, guint32 overwrite_counter, char *data, unsigned int len)
 {
         unsigned char tag[BTE_CIPHER_TAG_SIZE];
         unsigned int i, j;
         guint8 faulty = 0;
 
 #ifndef BTESTREAM_MAIN
-# ifdef WITH_GNUTLS
-        boa->iv.offset = offset;
-        boa->iv.overwrite_counter = overwrite_counter;
-        gnutls_cipher_set_iv (boa->cipher_hd, &boa->iv, BTE_CIPHER_IV_SIZE);
-        gnutls_cipher_decrypt (boa->cipher_hd, data, len);
-        gnutls_cipher_tag (boa->cipher_hd, tag, BTE_CIPHER_TAG_SIZE);
+# ifdef WITH_STREAM_ENCRYPTION
+        gnutls_cipher_hd_t cipher_hd = worker == 0 ? boa->cipher_hd : boa->worker_cipher_hd[worker - 1];
+        BteIv iv;
+
+        explicit_bzero(&iv, sizeof(iv));
+        iv.offset = offset;
+        iv.overwrite_counter = overwrite_counter;
+        gnutls_cipher_set_iv (cipher_hd, &iv, BTE_CIPHER_IV_SIZE);
+        gnutls_cipher_decrypt (cipher_hd, data, len);
+        gnutls_cipher_tag (cipher_hd, tag, BTE_CIPHER_TAG_SIZE);
 # endif
 #else
         /* Fake decryption for unit testing; see above. */
@@ -734,6 +770,14 @@ _bte_boa_decrypt (BteBoa *boa, gsize offset, guint32 overwrite_counter, char *da
         return !faulty;
 }
 
+#ifdef BTESTREAM_MAIN
+static gboolean
+_bte_boa_decrypt (BteBoa *boa, gsize offset, guint32 overwrite_counter, char *data, unsigned int len)
+{
+        return _bte_boa_decrypt_on_worker (boa, 0, offset, overwrite_counter, data, len);
+}
+#endif
+
 static int
 _bte_boa_compressBound (unsigned int len)
 {
@@ -815,8 +859,7 @@ _bte_boa_uncompress (char *dst, unsigned int dstlen, const char *src, unsigned i
 static void
 _bte_boa_init (BteBoa *boa)
 {
-#if !defined BTESTREAM_MAIN && defined WITH_GNUTLS
-        unsigned char key[BTE_CIPHER_KEY_SIZE];
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
         gnutls_datum_t datum_key;
 
         gnutls_global_init ();
@@ -828,13 +871,13 @@ _bte_boa_init (BteBoa *boa)
         /* Assert that IV does indeed include all the data we want to use (offset and overwrite_counter). */
         g_assert_cmpuint (offsetof(struct _BteIv, padding), <=, BTE_CIPHER_IV_SIZE);
 
-        /* Strong random for the key. */
-        gnutls_rnd(GNUTLS_RND_KEY, key, BTE_CIPHER_KEY_SIZE);
+        /* Strong random for the key. It's kept for the worker threads' cipher handles. */
+        boa->key = (unsigned char *) g_malloc (BTE_CIPHER_KEY_SIZE);
+        gnutls_rnd(GNUTLS_RND_KEY, boa->key, BTE_CIPHER_KEY_SIZE);
 
-        datum_key.data = key;
+        datum_key.data = boa->key;
         datum_key.size = BTE_CIPHER_KEY_SIZE;
         gnutls_cipher_init(&boa->cipher_hd, BTE_CIPHER_ALGORITHM, &datum_key, NULL);
-        explicit_bzero(key, BTE_CIPHER_KEY_SIZE);
 
         /* Empty IV. */
         explicit_bzero(&boa->iv, sizeof(boa->iv));
@@ -843,14 +886,54 @@ _bte_boa_init (BteBoa *boa)
         boa->compressBound = _bte_boa_compressBound(BTE_BOA_BLOCKSIZE);
 }
 
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
+static void
+_bte_boa_clear_worker_ciphers (BteBoa *boa)
+{
+        unsigned int i;
+
+        for (i = 0; i < BTE_BOA_READ_THREADS - 1; i++) {
+                if (boa->worker_cipher_hd[i] != NULL) {
+                        gnutls_cipher_deinit (boa->worker_cipher_hd[i]);
+                        boa->worker_cipher_hd[i] = NULL;
+                }
+        }
+}
+#endif
+
+/* Make sure that workers 1..n_workers-1 have their cipher handles. Returns
+ * the number of workers that can be used, at least 1. */
+static unsigned int
+_bte_boa_ensure_workers (BteBoa *boa, unsigned int n_workers)
+{
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
+        gnutls_datum_t datum_key;
+        unsigned int i;
+
+        datum_key.data = boa->key;
+        datum_key.size = BTE_CIPHER_KEY_SIZE;
+        for (i = 1; i < n_workers; i++) {
+                if (boa->worker_cipher_hd[i - 1] == NULL &&
+                    gnutls_cipher_init(&boa->worker_cipher_hd[i - 1], BTE_CIPHER_ALGORITHM, &datum_key, NULL) < 0) {
+                        boa->worker_cipher_hd[i - 1] = NULL;
+                        return i;
+                }
+        }
+#endif
+        return n_workers;
+}
+
 static void
 _bte_boa_finalize (GObject *object)
 {
-#if !defined BTESTREAM_MAIN && defined WITH_GNUTLS
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
         BteBoa *boa = (BteBoa *) object;
 
         explicit_bzero(&boa->iv, sizeof(boa->iv));
+        explicit_bzero(boa->key, BTE_CIPHER_KEY_SIZE);
+        g_free (boa->key);
 
+        _bte_boa_clear_worker_ciphers (boa);
         gnutls_cipher_deinit (boa->cipher_hd);
         gnutls_global_deinit ();
 #endif
@@ -858,6 +941,23 @@ _bte_boa_finalize (GObject *object)
         G_OBJECT_CLASS (_bte_boa_parent_class)->finalize(object);
 }
 
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
+/* Replace the random key by @key. */
+static void
+_bte_boa_set_key (BteBoa *boa, const unsigned char *key)
+{
+        gnutls_datum_t datum_key;
+
+        memcpy (boa->key, key, BTE_CIPHER_KEY_SIZE);
+
+        _bte_boa_clear_worker_ciphers (boa);
+        gnutls_cipher_deinit (boa->cipher_hd);
+        datum_key.data = boa->key;
+        datum_key.size = BTE_CIPHER_KEY_SIZE;
+        gnutls_cipher_init(&boa->cipher_hd, BTE_CIPHER_ALGORITHM, &datum_key, NULL);
+}
+#endif
+
 static void
 _bte_boa_reset (BteBoa *boa, gsize offset)
 {
@@ -879,19 +979,13 @@ _bte_boa_reset (BteBoa *boa, gsize offset)
         boa->head = MAX(boa->head, offset);
 }
 
-/* Place BTE_BOA_BLOCKSIZE bytes at data.
- * data can be NULL if we're only interested in integrity verification and the overwrite_counter. */
+/* Verify, decrypt and uncompress the snake block buf, read from offset, to BTE_BOA_BLOCKSIZE bytes at data.
+ * data can be NULL if we're only interested in integrity verification and the overwrite_counter.
+ * This runs on worker threads of batched reads, so it must not modify boa. */
 static gboolean
-_bte_boa_read_with_overwrite_counter (BteBoa *boa, gsize offset, char *data, _bte_overwrite_counter_t *overwrite_counter)
+_bte_boa_decode (BteBoa *boa, unsigned int worker, gsize offset, char *buf, char *data, _bte_overwrite_counter_t *overwrite_counter)
 {
         _bte_block_datalength_t compressed_len;
-        char *buf = g_newa(char, BTE_SNAKE_BLOCKSIZE);
-
-        g_assert_cmpuint (offset % BTE_BOA_BLOCKSIZE, ==, 0);
-
-        /* Read */
-        if (G_UNLIKELY (!_bte_snake_read (&boa->parent, OFFSET_BOA_TO_SNAKE(offset), buf)))
-                return FALSE;
 
         compressed_len = *((_bte_block_datalength_t *) buf);
         *overwrite_counter = *((_bte_overwrite_counter_t *) (buf + BTE_BLOCK_DATALENGTH_SIZE));
@@ -901,7 +995,7 @@ _bte_boa_read_with_overwrite_counter (BteBoa *boa, gsize offset, char *data, _bt
                 return FALSE;
 
         /* Decrypt, bail out on tag mismatch */
-        if (G_UNLIKELY (!_bte_boa_decrypt (boa, offset, *overwrite_counter, buf + BTE_BLOCK_DATALENGTH_SIZE + BTE_OVERWRITE_COUNTER_SIZE, compressed_len)))
+        if (G_UNLIKELY (!_bte_boa_decrypt_on_worker (boa, worker, offset, *overwrite_counter, buf + BTE_BLOCK_DATALENGTH_SIZE + BTE_OVERWRITE_COUNTER_SIZE, compressed_len)))
                 return FALSE;
 
         /* Uncompress, or copy if wasn't compressable */
@@ -917,6 +1011,29 @@ _bte_boa_read_with_overwrite_counter (BteBoa *boa, gsize offset, char *data, _bt
         return TRUE;
 }
 
+/* Place BTE_BOA_BLOCKSIZE bytes at data.
+ * data can be NULL if we're only interested in integrity verification and the overwrite_counter. */
+static gboolean
+_bte_boa_read_with_overwrite_counter (BteBoa *boa, gsize offset, char *data, _bte_overwrite_counter_t *overwrite_counter)
+{
+        char *buf = g_newa(char, BTE_SNAKE_BLOCKSIZE);
+
+        g_assert_cmpuint (offset % BTE_BOA_BLOCKSIZE, ==, 0);
+
+        _BTE_TRACE_SCOPE(boa_read, offset);
+
+        /* Read */
+        if (G_UNLIKELY (!_bte_snake_read (&boa->parent, OFFSET_BOA_TO_SNAKE(offset), buf)))
+                return FALSE;
+
+        if (G_UNLIKELY (!_bte_boa_decode (boa, 0, offset, buf, data, overwrite_counter)))
+                return FALSE;
+
+        if (data != NULL && boa->statistics)
+                boa->statistics->block_reads++;
+        return TRUE;
+}
+
 static gboolean
 _bte_boa_read (BteBoa *boa, gsize offset, char *data)
 {
@@ -924,6 +1041,81 @@ _bte_boa_read (BteBoa *boa, gsize offset, char *data)
         return _bte_boa_read_with_overwrite_counter (boa, offset, data, &overwrite_counter);
 }
 
+typedef struct _BteBoaBatch {
+        BteBoa *boa;
+        gsize offset;
+        unsigned int n_blocks;
+        unsigned int n_workers;
+        char *bufs;   /* n_blocks snake blocks */
+        char *data;   /* n_blocks boa blocks */
+        gboolean ok[BTE_BOA_READ_BATCH];
+} BteBoaBatch;
+
+/* Decode every n_workers'th block of the batch, starting at the worker'th one.
+ * Run by _bte_run_parallel(), which runs every worker exactly once, so each
+ * one has its cipher handle to itself. */
+static void
+_bte_boa_decode_batch (gpointer user_data, unsigned int worker)
+{
+        BteBoaBatch *batch = (BteBoaBatch *) user_data;
+        _bte_overwrite_counter_t overwrite_counter;
+        unsigned int i;
+
+        for (i = worker; i < batch->n_blocks; i += batch->n_workers) {
+                batch->ok[i] = _bte_boa_decode (batch->boa, worker,
+                                                batch->offset + i * BTE_BOA_BLOCKSIZE,
+                                                batch->bufs + i * BTE_SNAKE_BLOCKSIZE,
+                                                batch->data + i * BTE_BOA_BLOCKSIZE,
+                                                &overwrite_counter);
+        }
+}
+
+/* Place n_blocks * BTE_BOA_BLOCKSIZE bytes at data, n_blocks <= BTE_BOA_READ_BATCH.
+ * The blocks are read from the file here, but verified, decrypted and uncompressed on up to
+ * BTE_BOA_READ_THREADS threads of the shared pool, each one with its own cipher handle. */
+static gboolean
+_bte_boa_read_blocks (BteBoa *boa, gsize offset, unsigned int n_blocks, char *data)
+{
+        BteBoaBatch batch;
+        unsigned int i;
+        gboolean ok = TRUE;
+
+        g_assert_cmpuint (offset % BTE_BOA_BLOCKSIZE, ==, 0);
+        g_assert_cmpuint (n_blocks, >=, 1);
+        g_assert_cmpuint (n_blocks, <=, BTE_BOA_READ_BATCH);
+
+        _BTE_TRACE_SCOPE(boa_read_blocks, offset, n_blocks);
+
+        batch.boa = boa;
+        batch.offset = offset;
+        batch.n_blocks = n_blocks;
+        batch.data = data;
+        batch.bufs = (char *) g_malloc (n_blocks * BTE_SNAKE_BLOCKSIZE);
+
+        /* Read */
+        for (i = 0; i < n_blocks; i++) {
+                if (G_UNLIKELY (!_bte_snake_read (&boa->parent, OFFSET_BOA_TO_SNAKE(offset + i * BTE_BOA_BLOCKSIZE),
+                                                  batch.bufs + i * BTE_SNAKE_BLOCKSIZE))) {
+                        g_free (batch.bufs);
+                        return FALSE;
+                }
+        }
+
+        /* Decode */
+        batch.n_workers = _bte_boa_ensure_workers (boa, CLAMP (MIN ((unsigned int) g_get_num_processors (), n_blocks),
+                                                                1, BTE_BOA_READ_THREADS));
+        _bte_run_parallel (batch.n_workers, _bte_boa_decode_batch, &batch);
+
+        g_free (batch.bufs);
+
+        for (i = 0; i < n_blocks; i++)
+                ok = ok && batch.ok[i];
+
+        if (ok && boa->statistics)
+                boa->statistics->block_reads += n_blocks;
+        return ok;
+}
+
 /*
  * offset is either within the stream (overwrite data), or at its head (append data).
  * data is BTE_BOA_BLOCKSIZE bytes large.
@@ -945,6 +1137,8 @@ _bte_boa_write (BteBoa *boa, gsize offset, const char *data)
         g_assert_cmpuint (offset, <=, boa->head);
         g_assert_cmpuint (offset % BTE_BOA_BLOCKSIZE, ==, 0);
 
+        _BTE_TRACE_SCOPE(boa_write, offset);
+
         if (G_UNLIKELY (offset < boa->head)) {
                 /* Overwriting an existing block. This only happens around a window resize.
                  * We need to read back that block and verify its integrity to get the previous overwrite_counter,
@@ -974,6 +1168,12 @@ _bte_boa_write (BteBoa *boa, gsize offset, const char *data)
                 compressed_len = BTE_BOA_BLOCKSIZE;
         }
 
+        if (boa->statistics) {
+                boa->statistics->block_writes++;
+                boa->statistics->bytes_uncompressed += BTE_BOA_BLOCKSIZE;
+                boa->statistics->bytes_compressed += compressed_len;
+        }
+
         *((_bte_block_datalength_t *) buf) = (_bte_block_datalength_t) compressed_len;
         *((_bte_overwrite_counter_t *) (buf + BTE_BLOCK_DATALENGTH_SIZE)) = (_bte_overwrite_counter_t) overwrite_counter;
 
@@ -1063,6 +1263,140 @@ _bte_file_stream_new (void)
 	return (BteStream *) g_object_new (BTE_TYPE_FILE_STREAM, NULL);
 }
 
+/* A stream whose file is created in @dir, so that it can be saved there and
+ * reopened later; see _bte_file_stream_save_session(). */
+BteStream *
+_bte_file_stream_new_in_dir (const char *dir)
+{
+        BteFileStream *stream = (BteFileStream *) g_object_new (BTE_TYPE_FILE_STREAM, NULL);
+
+        stream->boa->parent.dir = g_strdup (dir);
+
+        return (BteStream *) stream;
+}
+
+/*
+ * Write out everything that's needed to reopen @astream with
+ * _bte_file_stream_new_from_session(), and keep its file when the stream
+ * goes away. Only for streams created by _bte_file_stream_new_in_dir().
+ *
+ * The partial last block goes to the file too, like any other block; when
+ * reopening, it's read back to the write buffer, and appending to the stream
+ * then overwrites it with an incremented overwrite counter.
+ */
+gboolean
+_bte_file_stream_save_session (BteStream *astream, BteStreamSession *session)
+{
+        BteFileStream *stream = (BteFileStream *) astream;
+        BteBoa *boa = stream->boa;
+        BteSnake *snake = &boa->parent;
+        int i;
+
+        if (snake->dir == NULL)
+                return FALSE;
+
+        if (stream->wbuf_len != 0) {
+                memset (stream->wbuf + stream->wbuf_len, 0, BTE_BOA_BLOCKSIZE - stream->wbuf_len);
+                _bte_boa_write (boa, ALIGN_BOA(stream->head), stream->wbuf);
+        }
+
+        _bte_snake_ensure_file (snake);
+        if (snake->fd == -1 || fsync (snake->fd) == -1)
+                return FALSE;
+
+        memset (session, 0, sizeof (*session));
+        g_strlcpy (session->name, strrchr (snake->path, G_DIR_SEPARATOR) + 1, sizeof (session->name));
+        session->block_size = BTE_SNAKE_BLOCKSIZE;
+        session->tail = stream->tail;
+        session->head = stream->head;
+        session->boa_tail = boa->tail;
+        session->boa_head = boa->head;
+        session->snake_state = snake->state;
+        session->snake_tail = snake->tail;
+        session->snake_head = snake->head;
+        for (i = 0; i < 3; i++) {
+                session->segment[i][0] = snake->segment[i].st_tail;
+                session->segment[i][1] = snake->segment[i].st_head;
+                session->segment[i][2] = snake->segment[i].fd_tail;
+                session->segment[i][3] = snake->segment[i].fd_head;
+        }
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
+        G_STATIC_ASSERT (BTE_CIPHER_KEY_SIZE <= sizeof (session->key));
+        memcpy (session->key, boa->key, BTE_CIPHER_KEY_SIZE);
+#endif
+
+        snake->keep = TRUE;
+        return TRUE;
+}
+
+/*
+ * Reopen a stream saved by _bte_file_stream_save_session() in @dir. Only the
+ * partial last block is read; returns NULL if that, or opening the file, fails.
+ */
+BteStream *
+_bte_file_stream_new_from_session (const char *dir, const BteStreamSession *session)
+{
+        BteFileStream *stream;
+        BteSnake *snake;
+        int i;
+
+        if (session->block_size != BTE_SNAKE_BLOCKSIZE ||
+            memchr (session->name, '\0', sizeof (session->name)) == NULL ||
+            !g_str_has_prefix (session->name, "stream") ||
+            strchr (session->name, G_DIR_SEPARATOR) != NULL ||
+            session->snake_state < 1 || session->snake_state > 4 ||
+            session->tail > session->head ||
+            ALIGN_BOA(session->tail) != session->boa_tail ||
+            session->boa_head < ALIGN_BOA(session->head) ||
+            session->snake_tail != OFFSET_BOA_TO_SNAKE(session->boa_tail) ||
+            session->snake_head != OFFSET_BOA_TO_SNAKE(session->boa_head))
+                return NULL;
+
+        stream = (BteFileStream *) _bte_file_stream_new_in_dir (dir);
+        snake = &stream->boa->parent;
+
+        snake->path = g_build_filename (dir, session->name, NULL);
+        snake->fd = open (snake->path, O_RDWR | O_CLOEXEC);
+        if (snake->fd == -1) {
+                g_object_unref (stream);
+                return NULL;
+        }
+
+        snake->state = session->snake_state;
+        snake->tail = session->snake_tail;
+        snake->head = session->snake_head;
+        for (i = 0; i < 3; i++) {
+                snake->segment[i].st_tail = session->segment[i][0];
+                snake->segment[i].st_head = session->segment[i][1];
+                snake->segment[i].fd_tail = session->segment[i][2];
+                snake->segment[i].fd_head = session->segment[i][3];
+        }
+        stream->boa->tail = session->boa_tail;
+        stream->boa->head = session->boa_head;
+#if !defined BTESTREAM_MAIN && defined WITH_STREAM_ENCRYPTION
+        _bte_boa_set_key (stream->boa, session->key);
+#endif
+        stream->tail = session->tail;
+        stream->head = session->head;
+
+        stream->wbuf_len = MOD_BOA(stream->head);
+        if (stream->wbuf_len != 0 &&
+            !_bte_boa_read (stream->boa, ALIGN_BOA(stream->head), stream->wbuf)) {
+                g_object_unref (stream);
+                return NULL;
+        }
+
+        return (BteStream *) stream;
+}
+
+void
+_bte_file_stream_set_statistics (BteStream *astream, BteStreamStatistics *statistics)
+{
+        BteFileStream *stream = (BteFileStream *) astream;
+
+        stream->boa->statistics = statistics;
+}
+
 static void
 _bte_file_stream_init (BteFileStream *stream)
 {
@@ -1135,6 +1469,20 @@ _bte_file_stream_read (BteStream *astream, gsize offset, char *data, gsize len)
         while (len && offset < ALIGN_BOA(stream->head)) {
                 gsize l = MIN(BTE_BOA_BLOCKSIZE - MOD_BOA(offset), len);
                 gsize offset_aligned = ALIGN_BOA(offset);
+
+                /* Read runs of whole blocks in batches, directly to data */
+                if (MOD_BOA(offset) == 0) {
+                        gsize n_blocks = MIN(MIN(len, ALIGN_BOA(stream->head) - offset) / BTE_BOA_BLOCKSIZE,
+                                             BTE_BOA_READ_BATCH);
+                        if (n_blocks >= 2) {
+                                if (G_UNLIKELY (!_bte_boa_read_blocks (stream->boa, offset, n_blocks, data)))
+                                        return FALSE;
+                                l = n_blocks * BTE_BOA_BLOCKSIZE;
+                                offset += l; data += l; len -= l;
+                                continue;
+                        }
+                }
+
                 if (offset_aligned != stream->rbuf_offset) {
                         if (G_UNLIKELY (!_bte_boa_read (stream->boa, offset_aligned, stream->rbuf)))
                                 return FALSE;
@@ -1758,6 +2106,109 @@ test_stream (void)
         g_object_unref (astream);
 }
 
+/* Reads of several whole blocks go through _bte_boa_read_blocks() */
+static void
+test_stream_batched_read (void)
+{
+        BteStreamStatistics statistics;
+        char buf[200], expected[200];
+        int i;
+
+        BteStream *astream = _bte_file_stream_new();
+        BteFileStream *stream = (BteFileStream *) astream;
+        memset (&statistics, 0, sizeof (statistics));
+        _bte_file_stream_set_statistics (astream, &statistics);
+
+        /* 18 whole blocks and a partial one */
+        expected[0] = '\0';
+        for (i = 0; i < 5; i++)
+                strcat (expected, "abcdefghijklmnopqrstuvwxyz");
+        stream_append (astream, expected);
+        g_assert_cmpuint (_bte_stream_head (astream), ==, 130);
+
+        /* Two batches, then the write buffer */
+        g_assert (_bte_stream_read (astream, 0, buf, 130));
+        g_assert (memcmp (buf, expected, 130) == 0);
+        g_assert_cmpuint (statistics.block_reads, ==, 18);
+        g_assert_cmpuint (stream->rbuf_offset, ==, 1);
+
+        /* Partial blocks through the read cache, a batch in between */
+        g_assert (_bte_stream_read (astream, 3, buf, 40));
+        g_assert (memcmp (buf, expected + 3, 40) == 0);
+        g_assert_cmpuint (statistics.block_reads, ==, 18 + 1 + 5 + 1);
+
+        /* A corrupted block fails the whole batch, but not the others */
+        _bte_snake_write (&stream->boa->parent, 50, "\007\001XXXXXXX\000", 10);
+        g_assert_false (_bte_stream_read (astream, 0, buf, 126));
+        g_assert (_bte_stream_read (astream, 0, buf, 35));
+        g_assert (memcmp (buf, expected, 35) == 0);
+
+        g_object_unref (astream);
+}
+
+static void
+test_stream_session (void)
+{
+        BteStreamSession session;
+        BteFileStream *stream;
+        BteBoa *boa;
+        char *dir, *path;
+
+        dir = g_dir_make_tmp ("btestreamXXXXXX", NULL);
+        g_assert (dir != NULL);
+
+        /* A stream that isn't saved doesn't leave its file behind */
+        BteStream *astream = _bte_file_stream_new_in_dir (dir);
+        stream_append (astream, "axolotl");
+        stream = (BteFileStream *) astream;
+        path = g_strdup (stream->boa->parent.path);
+        g_assert (g_file_test (path, G_FILE_TEST_EXISTS));
+        g_object_unref (astream);
+        g_assert (!g_file_test (path, G_FILE_TEST_EXISTS));
+        g_free (path);
+
+        /* Save with a partial last block */
+        astream = _bte_file_stream_new_in_dir (dir);
+        stream_append (astream, "axolotl" "beeee");
+        g_assert (_bte_file_stream_save_session (astream, &session));
+        g_assert (g_str_has_prefix (session.name, "stream"));
+        g_assert_cmpuint (session.tail, ==, 0);
+        g_assert_cmpuint (session.head, ==, 12);
+        g_assert_cmpuint (session.boa_head, ==, 14);
+        g_object_unref (astream);
+
+        path = g_build_filename (dir, session.name, NULL);
+        g_assert (g_file_test (path, G_FILE_TEST_EXISTS));
+
+        /* Reopen, and carry on appending */
+        astream = _bte_file_stream_new_from_session (dir, &session);
+        g_assert (astream != NULL);
+        stream = (BteFileStream *) astream;
+        boa = stream->boa;
+        assert_stream (astream, 0, 12, "axolotl" "beeee");
+        stream_append (astream, "es" "cat");
+        assert_boa (boa, 0, 14, "axolotl" "beeeees");
+        assert_stream (astream, 0, 17, "axolotl" "beeeees" "cat");
+
+        /* The rewritten block got a new overwrite counter */
+        char buf[BTE_SNAKE_BLOCKSIZE];
+        g_assert (_bte_snake_read (&boa->parent, 10, buf));
+        g_assert_cmpuint (buf[1], ==, 2);
+
+        /* Done without saving: the file goes away */
+        g_object_unref (astream);
+        g_assert (!g_file_test (path, G_FILE_TEST_EXISTS));
+
+        /* Reopening fails without the file, or with a bogus state */
+        g_assert (_bte_file_stream_new_from_session (dir, &session) == NULL);
+        session.head = 100;
+        g_assert (_bte_file_stream_new_from_session (dir, &session) == NULL);
+
+        g_free (path);
+        rmdir (dir);
+        g_free (dir);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1766,6 +2217,8 @@ main (int argc, char **argv)
         test_snake();
         test_boa();
         test_stream();
+        test_stream_batched_read();
+        test_stream_session();
 
         printf("btestream-file tests passed :)\n");
         return 0;
@@ -22,6 +22,7 @@
 
 #include "debug.h"
 #include "btestream.h"
+#include "trace.hh"
 
 
 /*
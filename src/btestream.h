@@ -41,6 +41,32 @@ gsize _bte_stream_head (BteStream *stream);
 BteStream *
 _bte_file_stream_new (void);
 
+/* Counters of the underlying block I/O, summed over all streams sharing them */
+typedef struct _BteStreamStatistics {
+	guint64 block_reads;
+	guint64 block_writes;
+	guint64 bytes_uncompressed;
+	guint64 bytes_compressed;
+} BteStreamStatistics;
+
+void _bte_file_stream_set_statistics (BteStream *stream, BteStreamStatistics *statistics);
+
+/* What's needed to reopen a file stream saved to a session directory */
+typedef struct _BteStreamSession {
+	char name[32];          /* of the file within the directory */
+	guint32 block_size;
+	guint32 snake_state;
+	guint64 tail, head;
+	guint64 boa_tail, boa_head;
+	guint64 snake_tail, snake_head;
+	guint64 segment[3][4];
+	guint8 key[32];
+} BteStreamSession;
+
+BteStream *_bte_file_stream_new_in_dir (const char *dir);
+gboolean _bte_file_stream_save_session (BteStream *stream, BteStreamSession *session);
+BteStream *_bte_file_stream_new_from_session (const char *dir, const BteStreamSession *session);
+
 G_END_DECLS
 
 #endif
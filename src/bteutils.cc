@@ -92,3 +92,117 @@ _bte_mkstemp (void)
 
         return fd;
 }
+
+typedef struct _BteParallelRun {
+        BteParallelFunc func;
+        gpointer user_data;
+        unsigned int n_tasks;
+        int next_task;           /* atomic */
+        unsigned int n_done;     /* protected by mutex */
+        int ref_count;           /* atomic */
+        GMutex mutex;
+        GCond cond;
+} BteParallelRun;
+
+static void
+_bte_parallel_run_unref (BteParallelRun *run)
+{
+        if (!g_atomic_int_dec_and_test (&run->ref_count))
+                return;
+        g_mutex_clear (&run->mutex);
+        g_cond_clear (&run->cond);
+        g_free (run);
+}
+
+/* Run the tasks nobody has claimed yet. */
+static void
+_bte_parallel_run_claim (BteParallelRun *run)
+{
+        unsigned int task, n_done = 0;
+
+        while ((task = (unsigned int) g_atomic_int_add (&run->next_task, 1)) < run->n_tasks) {
+                run->func (run->user_data, task);
+                n_done++;
+        }
+
+        if (n_done == 0)
+                return;
+        g_mutex_lock (&run->mutex);
+        run->n_done += n_done;
+        if (run->n_done == run->n_tasks)
+                g_cond_signal (&run->cond);
+        g_mutex_unlock (&run->mutex);
+}
+
+static void
+_bte_parallel_worker (gpointer data, gpointer pool_data)
+{
+        BteParallelRun *run = (BteParallelRun *) data;
+
+        _bte_parallel_run_claim (run);
+        _bte_parallel_run_unref (run);
+}
+
+static GThreadPool *
+_bte_parallel_get_pool (void)
+{
+        static gsize initialized = 0;
+        static GThreadPool *pool = NULL;
+
+        if (g_once_init_enter (&initialized)) {
+                /* Not exclusive, so that the threads are shared with the other
+                 * pools of the process, and idle ones are kept around for a
+                 * while to serve the next batch. */
+                pool = g_thread_pool_new (_bte_parallel_worker, NULL, -1, FALSE, NULL);
+                g_once_init_leave (&initialized, 1);
+        }
+        return pool;
+}
+
+/*
+ * _bte_run_parallel:
+ * @n_tasks: the number of tasks
+ * @func: called once for every task from 0 to @n_tasks - 1
+ * @user_data: passed to @func
+ *
+ * Runs the tasks on the calling thread and on a shared thread pool, and
+ * returns once all of them are done. Every task is run exactly once, on
+ * whichever thread claims it first, so the calling thread finishes the work
+ * itself if no pool thread is available.
+ */
+void
+_bte_run_parallel (unsigned int n_tasks, BteParallelFunc func, gpointer user_data)
+{
+        BteParallelRun *run;
+        GThreadPool *pool;
+        unsigned int i;
+
+        pool = n_tasks > 1 ? _bte_parallel_get_pool () : NULL;
+        if (pool == NULL) {
+                for (i = 0; i < n_tasks; i++)
+                        func (user_data, i);
+                return;
+        }
+
+        run = g_new0 (BteParallelRun, 1);
+        run->func = func;
+        run->user_data = user_data;
+        run->n_tasks = n_tasks;
+        run->ref_count = n_tasks;  /* ours, and one for every pushed worker */
+        g_mutex_init (&run->mutex);
+        g_cond_init (&run->cond);
+
+        /* Even if a push fails, the worker is queued and releases its reference
+         * once it eventually runs. */
+        for (i = 1; i < n_tasks; i++)
+                g_thread_pool_push (pool, run, NULL);
+
+        _bte_parallel_run_claim (run);
+
+        g_mutex_lock (&run->mutex);
+        while (run->n_done < run->n_tasks)
+                g_cond_wait (&run->cond, &run->mutex);
+        g_mutex_unlock (&run->mutex);
+
+        _bte_parallel_run_unref (run);
+}
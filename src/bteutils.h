@@ -25,6 +25,10 @@ G_BEGIN_DECLS
 
 int _bte_mkstemp (void);
 
+typedef void (*BteParallelFunc) (gpointer user_data, unsigned int task);
+
+void _bte_run_parallel (unsigned int n_tasks, BteParallelFunc func, gpointer user_data);
+
 G_END_DECLS
 
 #endif /* __BTE_UTILS_H__ */
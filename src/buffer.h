@@ -33,7 +33,6 @@ typedef GByteArray BteByteArray;
 #define _bte_byte_array_append(B, data, length)	g_byte_array_append (B, (const guint8 *) (data), length)
 #define _bte_byte_array_length(B)			((B)->len)
 #define _bte_byte_array_data(B)                         ((B)->data)
-#define _bte_byte_array_consume(B, length)		g_byte_array_remove_range (B, 0, length)
 #define _bte_byte_array_clear(B)			g_byte_array_set_size (B, 0)
 #define _bte_byte_array_set_minimum_size(B, length)	g_byte_array_set_size (B, (guint) MAX ((gint) (length), (gint) (B)->len))
 
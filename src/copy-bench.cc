@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Measures the time and peak memory of copying the whole scrollback to
+ * the clipboard as text and as HTML, which stream the text, and compares
+ * it to bte_terminal_get_text_range() with attributes, which does not.
+ *
+ * Since the peak RSS only grows, each mode is measured in a fresh process;
+ * pass the mode (text, html or attributes) as the argument.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <ctk/ctk.h>
+#include <bte/bte.h>
+
+#include "bench-common.hh"
+
+int
+main(int argc,
+     char* argv[])
+{
+        auto n_lines = gint{200000};
+        GOptionEntry const entries[] = {
+                { "lines", 'n', 0, G_OPTION_ARG_INT, &n_lines, "Number of lines of scrollback", "N" },
+                { nullptr }
+        };
+
+        if (!bench_init(&argc, &argv, "text|html|attributes", entries))
+                return BENCH_EXIT_SKIP;
+
+        auto const mode = argc > 1 ? argv[1] : "html";
+
+        auto terminal = BTE_TERMINAL(g_object_ref_sink(bte_terminal_new()));
+        bte_terminal_set_size(terminal, 80, 24);
+        bte_terminal_set_scrollback_lines(terminal, n_lines);
+
+        /* Every cell has its own colours, like perf/256test.sh */
+        auto line = g_string_new(nullptr);
+        for (auto i = 0; i < n_lines; ++i) {
+                g_string_truncate(line, 0);
+                for (auto j = 0; j < 8; ++j)
+                        g_string_append_printf(line, "\e[38;5;%dm%08d ", (i + j) & 0xff, i);
+                g_string_append(line, "\e[m\r\n");
+                bte_terminal_feed(terminal, line->str, line->len);
+
+                if ((i & 0x3ff) == 0) {
+                        while (g_main_context_pending(nullptr))
+                                g_main_context_iteration(nullptr, false);
+                }
+        }
+        g_string_free(line, true);
+        while (g_main_context_pending(nullptr))
+                g_main_context_iteration(nullptr, false);
+
+        auto const rss_before = bench_peak_rss_kb();
+        auto const start = g_get_monotonic_time();
+        auto size = gsize{0};
+
+        if (strcmp(mode, "attributes") == 0) {
+                auto attributes = g_array_new(false, true, sizeof(BteCharAttributes));
+                glong rows, columns;
+                bte_terminal_get_cursor_position(terminal, &columns, &rows);
+                auto text = bte_terminal_get_text_range(terminal,
+                                                        rows - n_lines, 0,
+                                                        rows, 80,
+                                                        nullptr, nullptr,
+                                                        attributes);
+                size = text ? strlen(text) : 0;
+                g_free(text);
+                g_array_free(attributes, true);
+        } else {
+                bte_terminal_select_all(terminal);
+                bte_terminal_copy_clipboard_format(terminal,
+                                                   strcmp(mode, "text") == 0 ? BTE_FORMAT_TEXT : BTE_FORMAT_HTML);
+                auto clipboard = ctk_widget_get_clipboard(CTK_WIDGET(terminal), CDK_SELECTION_CLIPBOARD);
+                auto text = ctk_clipboard_wait_for_text(clipboard);
+                size = text ? strlen(text) : 0;
+                g_free(text);
+        }
+
+        auto const elapsed = g_get_monotonic_time() - start;
+        g_print("%s: %d lines, %" G_GSIZE_FORMAT " bytes in %.3fs, peak RSS grew by %ld kB\n",
+                mode, n_lines, size,
+                double(elapsed) / G_USEC_PER_SEC,
+                bench_peak_rss_kb() - rss_before);
+
+        g_object_unref(terminal);
+        return 0;
+}
@@ -87,6 +87,31 @@ DrawingContext::clear_font_cache()
         }
 }
 
+/* Sums the glyph cache counters of the fonts in use. The fonts are shared
+ * with other terminals using the same font, and so are their counters.
+ */
+void
+DrawingContext::font_cache_statistics(uint64_t& hits,
+                                      uint64_t& misses) const noexcept
+{
+        hits = misses = 0;
+	for (auto style = int{0}; style < 4; ++style) {
+                auto const font = m_fonts[style];
+                if (font == nullptr)
+                        continue;
+
+                /* Styles without their own font share the normal one */
+                auto shared = false;
+                for (auto other = int{0}; other < style; ++other)
+                        shared |= m_fonts[other] == font;
+                if (shared)
+                        continue;
+
+                hits += font->cache_hits();
+                misses += font->cache_misses();
+        }
+}
+
 void
 DrawingContext::set_cairo(cairo_t* cr) noexcept
 {
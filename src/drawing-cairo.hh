@@ -130,6 +130,9 @@ public:
         auto cell_width()  const noexcept { return m_cell_width; }
         auto cell_height() const noexcept { return m_cell_height; }
 
+        void font_cache_statistics(uint64_t& hits,
+                                   uint64_t& misses) const noexcept;
+
 private:
         void set_source_color_alpha (bte::color::rgb const* color,
                                      double alpha);
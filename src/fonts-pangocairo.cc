@@ -394,8 +394,12 @@ FontInfo::get_unistr_info(bteunistr c)
 	PangoLayoutLine *line;
 
 	auto uinfo = find_unistr_info(c);
-	if (G_LIKELY (uinfo->coverage() != UnistrInfo::Coverage::UNKNOWN))
+	if (G_LIKELY (uinfo->coverage() != UnistrInfo::Coverage::UNKNOWN)) {
+                ++m_cache_hits;
 		return uinfo;
+        }
+
+        ++m_cache_misses;
 
 	auto ufi = &uinfo->m_ufi;
 
@@ -215,6 +215,8 @@ public:
         }; // struct UnistrInfo
 
         UnistrInfo *get_unistr_info(bteunistr c);
+        inline constexpr auto cache_hits() const noexcept { return m_cache_hits; }
+        inline constexpr auto cache_misses() const noexcept { return m_cache_misses; }
         inline constexpr int width() const { return m_width; }
         inline constexpr int height() const { return m_height; }
         inline constexpr int ascent() const { return m_ascent; }
@@ -255,6 +257,10 @@ private:
         int m_height{1};
         int m_ascent{0};
 
+        /* get_unistr_info() lookups that found the info already measured, or not */
+        uint64_t m_cache_hits{0};
+        uint64_t m_cache_misses{0};
+
 	/* reusable string for UTF-8 conversion */
         // FIXME: use std::string
 	GString* m_string{nullptr};
@@ -0,0 +1,449 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+#include "html-export.hh"
+
+using namespace bte::terminal;
+
+/* The xterm palette, with black on white default colours */
+static uint32_t
+resolve_color(uint32_t index,
+              bool deco)
+{
+        if (deco) {
+                if (index & BTE_RGB_COLOR_MASK(4, 5, 4))
+                        return BTE_RGB_COLOR_GET_COMPONENT(index, 9, 4) << 16 |
+                                BTE_RGB_COLOR_GET_COMPONENT(index, 4, 5) << 8 |
+                                BTE_RGB_COLOR_GET_COMPONENT(index, 0, 4);
+        } else if (index & BTE_RGB_COLOR_MASK(8, 8, 8)) {
+                return index & 0xffffffu;
+        }
+
+        auto const dim = (index & BTE_DIM_COLOR) != 0;
+        index &= ~BTE_DIM_COLOR;
+        if (index >= BTE_LEGACY_COLORS_OFFSET)
+                index -= BTE_LEGACY_COLORS_OFFSET;
+
+        uint32_t r, g, b;
+        if (index < 16) {
+                static uint8_t const standard[16][3] = {
+                        {0x00, 0x00, 0x00}, {0xcd, 0x00, 0x00}, {0x00, 0xcd, 0x00}, {0xcd, 0xcd, 0x00},
+                        {0x00, 0x00, 0xee}, {0xcd, 0x00, 0xcd}, {0x00, 0xcd, 0xcd}, {0xe5, 0xe5, 0xe5},
+                        {0x7f, 0x7f, 0x7f}, {0xff, 0x00, 0x00}, {0x00, 0xff, 0x00}, {0xff, 0xff, 0x00},
+                        {0x5c, 0x5c, 0xff}, {0xff, 0x00, 0xff}, {0x00, 0xff, 0xff}, {0xff, 0xff, 0xff},
+                };
+                r = standard[index][0];
+                g = standard[index][1];
+                b = standard[index][2];
+        } else if (index < 232) {
+                auto const level = [](uint32_t v) -> uint32_t { return v ? v * 40 + 55 : 0; };
+                r = level((index - 16) / 36);
+                g = level((index - 16) / 6 % 6);
+                b = level((index - 16) % 6);
+        } else if (index < 256) {
+                r = g = b = (index - 232) * 10 + 8;
+        } else if (index == BTE_DEFAULT_BG) {
+                r = g = b = 0xff;
+        } else {
+                r = g = b = 0;
+        }
+
+        if (dim) {
+                r = r * 2 / 3;
+                g = g * 2 / 3;
+                b = b * 2 / 3;
+        }
+
+        return r << 16 | g << 8 | b;
+}
+
+static std::string
+export_runs(std::vector<std::pair<std::string, HtmlStyle>> const& runs)
+{
+        auto string = g_string_new(nullptr);
+        auto exporter = HtmlExporter{string, resolve_color};
+        for (auto const& [text, style] : runs) {
+                if (text == "\n")
+                        exporter.newline();
+                else
+                        exporter.append(text.data(), text.size(), style);
+        }
+        exporter.finish();
+
+        auto result = std::string{string->str, string->len};
+        g_string_free(string, true);
+        return result;
+}
+
+/* The markup as it was before HtmlExporter: nested old-style tags for
+ * each run, with all colours inline.
+ */
+static void
+legacy_append(GString* out,
+              char const* text,
+              size_t len,
+              HtmlStyle const& style)
+{
+        auto escaped = g_markup_escape_text(text, len);
+        auto string = g_string_new(escaped);
+        g_free(escaped);
+
+        if (style.bold) {
+                g_string_prepend(string, "<b>");
+                g_string_append(string, "</b>");
+        }
+        if (style.italic) {
+                g_string_prepend(string, "<i>");
+                g_string_append(string, "</i>");
+        }
+        if (style.underline != 0) {
+                static char const styles[][7] = {"", "single", "double", "wavy"};
+                auto colorattr = style.deco != BTE_DEFAULT_FG
+                        ? g_strdup_printf(";text-decoration-color:#%06X", resolve_color(style.deco, true))
+                        : g_strdup("");
+                auto tag = g_strdup_printf("<u style=\"text-decoration-style:%s%s\">",
+                                           styles[style.underline], colorattr);
+                g_string_prepend(string, tag);
+                g_free(tag);
+                g_free(colorattr);
+                g_string_append(string, "</u>");
+        }
+        if (style.fore != BTE_DEFAULT_FG || style.reverse) {
+                auto tag = g_strdup_printf("<font color=\"#%06X\">", resolve_color(style.fore, false));
+                g_string_prepend(string, tag);
+                g_free(tag);
+                g_string_append(string, "</font>");
+        }
+        if (style.back != BTE_DEFAULT_BG || style.reverse) {
+                auto tag = g_strdup_printf("<span style=\"background-color:#%06X\">",
+                                           resolve_color(style.back, false));
+                g_string_prepend(string, tag);
+                g_free(tag);
+                g_string_append(string, "</span>");
+        }
+        if (style.strikethrough) {
+                g_string_prepend(string, "<strike>");
+                g_string_append(string, "</strike>");
+        }
+        if (style.overline) {
+                g_string_prepend(string, "<span style=\"text-decoration-line:overline\">");
+                g_string_append(string, "</span>");
+        }
+        if (style.blink) {
+                g_string_prepend(string, "<blink>");
+                g_string_append(string, "</blink>");
+        }
+
+        g_string_append_len(out, string->str, string->len);
+        g_string_free(string, true);
+}
+
+static std::string
+legacy_export_runs(std::vector<std::pair<std::string, HtmlStyle>> const& runs)
+{
+        auto string = g_string_new("<pre>");
+        for (auto const& [text, style] : runs) {
+                if (text == "\n")
+                        g_string_append_c(string, '\n');
+                else
+                        legacy_append(string, text.data(), text.size(), style);
+        }
+        g_string_append(string, "</pre>");
+
+        auto result = std::string{string->str, string->len};
+        g_string_free(string, true);
+        return result;
+}
+
+/* Interprets the SGR sequences in @data, which is all that perf/256test.sh
+ * uses, and splits it into runs of equal style like stream_text() does.
+ */
+static std::vector<std::pair<std::string, HtmlStyle>>
+runs_from_sgr(char const* data,
+              size_t len)
+{
+        auto runs = std::vector<std::pair<std::string, HtmlStyle>>{};
+        auto fore = uint32_t{BTE_DEFAULT_FG}, back = uint32_t{BTE_DEFAULT_BG};
+        auto bold = false, dim = false;
+        auto text = std::string{};
+        auto text_style = HtmlStyle{};
+
+        auto const flush = [&]() {
+                if (!text.empty())
+                        runs.emplace_back(text, text_style);
+                text.clear();
+        };
+
+        auto const end = data + len;
+        for (auto p = data; p < end; ) {
+                if (*p == '\n') {
+                        flush();
+                        runs.emplace_back("\n", HtmlStyle{});
+                        ++p;
+                        continue;
+                }
+
+                if (*p == '\e' && p + 1 < end && p[1] == '[') {
+                        auto q = p + 2;
+                        while (q < end && (g_ascii_isdigit(*q) || *q == ';' || *q == ':'))
+                                ++q;
+                        if (q < end && *q == 'm') {
+                                auto params = std::vector<int>{};
+                                auto tokens = g_strsplit_set(std::string(p + 2, q).c_str(), ";:", -1);
+                                for (auto t = tokens; *t; ++t)
+                                        params.push_back(atoi(*t));
+                                g_strfreev(tokens);
+
+                                for (auto i = size_t{0}; i < params.size(); ++i) {
+                                        auto const param = params[i];
+                                        if (param == 0) {
+                                                fore = BTE_DEFAULT_FG;
+                                                back = BTE_DEFAULT_BG;
+                                                bold = dim = false;
+                                        } else if (param == 1) {
+                                                bold = true;
+                                        } else if (param == 2) {
+                                                dim = true;
+                                        } else if (param == 22) {
+                                                bold = dim = false;
+                                        } else if (param >= 30 && param <= 37) {
+                                                fore = BTE_LEGACY_COLORS_OFFSET + param - 30;
+                                        } else if (param >= 40 && param <= 47) {
+                                                back = BTE_LEGACY_COLORS_OFFSET + param - 40;
+                                        } else if (param >= 90 && param <= 97) {
+                                                fore = BTE_LEGACY_COLORS_OFFSET + param - 90 + BTE_COLOR_BRIGHT_OFFSET;
+                                        } else if (param >= 100 && param <= 107) {
+                                                back = BTE_LEGACY_COLORS_OFFSET + param - 100 + BTE_COLOR_BRIGHT_OFFSET;
+                                        } else if ((param == 38 || param == 48) &&
+                                                   i + 2 < params.size() && params[i + 1] == 5) {
+                                                (param == 38 ? fore : back) = params[i + 2] & 0xff;
+                                                i += 2;
+                                        } else if (param == 39) {
+                                                fore = BTE_DEFAULT_FG;
+                                        } else if (param == 49) {
+                                                back = BTE_DEFAULT_BG;
+                                        }
+                                }
+                        }
+                        p = q < end ? q + 1 : end;
+                        continue;
+                }
+
+                /* Like Terminal::determine_colors() */
+                auto style = HtmlStyle{};
+                style.fore = fore;
+                style.back = back;
+                style.bold = bold;
+                if (bold &&
+                    fore >= BTE_LEGACY_COLORS_OFFSET &&
+                    fore < BTE_LEGACY_COLORS_OFFSET + BTE_LEGACY_COLOR_SET_SIZE)
+                        style.fore += BTE_COLOR_BRIGHT_OFFSET;
+                if (dim)
+                        style.fore |= BTE_DIM_COLOR;
+
+                if (style != text_style) {
+                        flush();
+                        text_style = style;
+                }
+                text.push_back(*p++);
+        }
+        flush();
+
+        return runs;
+}
+
+static void
+test_html_export_plain(void)
+{
+        auto const html = export_runs({
+                        {"a < b && c > d", HtmlStyle{}},
+                        {"\n", HtmlStyle{}},
+                        {"e", HtmlStyle{}},
+                });
+        g_assert_cmpstr(html.c_str(), ==, "<pre>a &lt; b &amp;&amp; c &gt; d\ne</pre>");
+}
+
+static void
+test_html_export_runs(void)
+{
+        auto red = HtmlStyle{};
+        red.fore = BTE_LEGACY_COLORS_OFFSET + 1;
+        auto bold_red = red;
+        bold_red.bold = true;
+        auto dim_blue = HtmlStyle{};
+        dim_blue.fore = 4 | BTE_DIM_COLOR;
+        dim_blue.underline = 2;
+        dim_blue.strikethrough = true;
+
+        auto const html = export_runs({
+                        {"a", red},
+                        {"b", red},
+                        {"c", bold_red},
+                        {"\n", HtmlStyle{}},
+                        {"d", dim_blue},
+                        {"e", HtmlStyle{}},
+                });
+        g_assert_cmpstr(html.c_str(), ==,
+                        "<pre><span style=color:#CD0000>ab</span>"
+                        "<span style=color:#CD0000><b>c</b></span>\n"
+                        "<span style=\"color:#00009E;text-decoration-line:underline line-through;"
+                        "text-decoration-style:double\">d</span>e</pre>");
+}
+
+/* Colours have to survive without the stylesheet */
+static void
+test_html_export_colors(void)
+{
+        auto style = HtmlStyle{};
+        style.fore = BTE_LEGACY_COLORS_OFFSET + 2;
+        style.back = 17;
+        auto reverse = HtmlStyle{};
+        reverse.fore = BTE_DEFAULT_BG;
+        reverse.back = BTE_DEFAULT_FG;
+        reverse.reverse = true;
+
+        auto const html = export_runs({
+                        {"a", style},
+                        {"b", reverse},
+                });
+        g_assert_cmpstr(html.c_str(), ==,
+                        "<pre><span style=\"color:#00CD00;background-color:#00005F\">a</span>"
+                        "<span style=\"color:#FFFFFF;background-color:#000000\">b</span></pre>");
+}
+
+/* Nor may the other attributes rely on a stylesheet */
+static void
+test_html_export_attributes(void)
+{
+        auto bold = HtmlStyle{};
+        bold.bold = true;
+        auto italic = HtmlStyle{};
+        italic.italic = true;
+        italic.underline = 1;
+        auto lines = HtmlStyle{};
+        lines.bold = true;
+        lines.italic = true;
+        lines.underline = 3;
+        lines.strikethrough = true;
+        lines.overline = true;
+        auto overline = HtmlStyle{};
+        overline.overline = true;
+
+        auto const html = export_runs({
+                        {"a", bold},
+                        {"b", italic},
+                        {"c", lines},
+                        {"d", overline},
+                });
+        g_assert_null(strstr(html.c_str(), "<style"));
+        g_assert_null(strstr(html.c_str(), "class="));
+        g_assert_cmpstr(html.c_str(), ==,
+                        "<pre><b>a</b>"
+                        "<span style=text-decoration-line:underline><i>b</i></span>"
+                        "<span style=\"text-decoration-line:underline line-through overline;"
+                        "text-decoration-style:wavy\"><b><i>c</i></b></span>"
+                        "<span style=text-decoration-line:overline>d</span></pre>");
+}
+
+static void
+test_html_export_direct(void)
+{
+        auto style = HtmlStyle{};
+        style.fore = BTE_RGB_COLOR(8, 8, 8, 0x12, 0x34, 0x56);
+        style.back = 7;
+        style.underline = 1;
+        style.deco = BTE_RGB_COLOR(4, 5, 4, 0xff, 0x00, 0xff);
+
+        auto const html = export_runs({{"x", style}});
+        g_assert_cmpstr(html.c_str(), ==,
+                        "<pre><span style=\"color:#123456;background-color:#E5E5E5;"
+                        "text-decoration-line:underline;text-decoration-color:#F804F8\">x</span></pre>");
+}
+
+static void
+test_html_export_256test(void)
+{
+        auto const script = g_test_build_filename(G_TEST_DIST, "..", "perf", "256test.sh", nullptr);
+        char* argv[] = {(char*)"bash", script, nullptr};
+        auto output = (char*)nullptr;
+        auto status = int{};
+        auto error = (GError*)nullptr;
+        if (!g_spawn_sync(nullptr, argv, nullptr, GSpawnFlags(G_SPAWN_SEARCH_PATH | G_SPAWN_STDERR_TO_DEV_NULL),
+                          nullptr, nullptr, &output, nullptr, &status, &error) ||
+            !g_spawn_check_exit_status(status, nullptr)) {
+                g_test_skip(error ? error->message : "Failed to run 256test.sh");
+                g_clear_error(&error);
+                g_free(output);
+                g_free(script);
+                return;
+        }
+
+        auto const runs = runs_from_sgr(output, strlen(output));
+        g_free(output);
+        g_free(script);
+
+        auto const n_iterations = 50;
+        auto html = std::string{}, legacy_html = std::string{};
+
+        auto start = g_get_monotonic_time();
+        for (auto i = 0; i < n_iterations; ++i)
+                html = export_runs(runs);
+        auto const elapsed = g_get_monotonic_time() - start;
+
+        start = g_get_monotonic_time();
+        for (auto i = 0; i < n_iterations; ++i)
+                legacy_html = legacy_export_runs(runs);
+        auto const legacy_elapsed = g_get_monotonic_time() - start;
+
+        g_test_message("256test.sh: %zu runs, %zu bytes in %.3fms as spans, "
+                       "%zu bytes in %.3fms as nested tags",
+                       runs.size(),
+                       html.size(), double(elapsed) / n_iterations / 1000.,
+                       legacy_html.size(), double(legacy_elapsed) / n_iterations / 1000.);
+
+        /* Nearly every cell of 256test.sh has its own colour, so there is
+         * nothing to merge, and all attributes are inline in both; the saving
+         * is in the markup around them and in the time to produce it.
+         */
+        g_assert_cmpuint(html.size(), <, legacy_html.size());
+        g_assert_null(strstr(html.c_str(), "<style"));
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/html-export/plain", test_html_export_plain);
+        g_test_add_func("/bte/html-export/runs", test_html_export_runs);
+        g_test_add_func("/bte/html-export/colors", test_html_export_colors);
+        g_test_add_func("/bte/html-export/attributes", test_html_export_attributes);
+        g_test_add_func("/bte/html-export/direct", test_html_export_direct);
+        g_test_add_func("/bte/html-export/256test", test_html_export_256test);
+
+        return g_test_run();
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "html-export.hh"
+
+#include <utility>
+
+namespace bte {
+
+namespace terminal {
+
+HtmlExporter::HtmlExporter(GString* string,
+                           resolver_type resolver)
+        : m_string{string},
+          m_resolver{std::move(resolver)}
+{
+        g_string_append(m_string, "<pre>");
+}
+
+void
+HtmlExporter::append_escaped(char const* text,
+                             size_t len)
+{
+        auto const end = text + len;
+        while (text < end) {
+                auto p = text;
+                while (p < end && *p != '&' && *p != '<' && *p != '>')
+                        ++p;
+
+                g_string_append_len(m_string, text, p - text);
+                if (p == end)
+                        break;
+
+                switch (*p) {
+                case '&': g_string_append(m_string, "&amp;"); break;
+                case '<': g_string_append(m_string, "&lt;"); break;
+                case '>': g_string_append(m_string, "&gt;"); break;
+                }
+                text = p + 1;
+        }
+}
+
+void
+HtmlExporter::append_color(uint32_t color)
+{
+        static char const hex[] = "0123456789ABCDEF";
+        char buf[7] = {'#'};
+        for (auto i = 0; i < 6; ++i)
+                buf[1 + i] = hex[(color >> (20 - 4 * i)) & 0xf];
+        g_string_append_len(m_string, buf, sizeof(buf));
+}
+
+void
+HtmlExporter::open_span(HtmlStyle const& style)
+{
+        auto const has_fore = style.fore != BTE_DEFAULT_FG || style.reverse;
+        auto const has_back = style.back != BTE_DEFAULT_BG || style.reverse;
+        auto const n_lines = int(style.underline != 0) + int(style.strikethrough) +
+                int(style.overline) + int(style.blink);
+        auto const has_deco_style = style.underline > 1; /* single ones are solid by default */
+        auto const has_deco_color = style.underline != 0 && style.deco != BTE_DEFAULT_FG;
+        auto const n_declarations = int(has_fore) + int(has_back) + int(n_lines != 0) +
+                int(has_deco_style) + int(has_deco_color);
+
+        m_span = n_declarations != 0;
+        if (m_span) {
+                /* A single declaration without spaces needs no quotes */
+                auto const quoted = n_declarations > 1 || n_lines > 1;
+                auto n_added = 0;
+                auto const add_property = [&](char const* property) {
+                        if (n_added++)
+                                g_string_append_c(m_string, ';');
+                        g_string_append(m_string, property);
+                };
+
+                g_string_append(m_string, quoted ? "<span style=\"" : "<span style=");
+                if (has_fore) {
+                        add_property("color:");
+                        append_color(m_resolver(style.fore, false));
+                }
+                if (has_back) {
+                        add_property("background-color:");
+                        append_color(m_resolver(style.back, false));
+                }
+                if (n_lines != 0) {
+                        /* All lines in one declaration, since each
+                         * text-decoration-line replaces the previous one */
+                        add_property("text-decoration-line:");
+                        auto n_added_lines = 0;
+                        auto const add_line = [&](char const* line) {
+                                if (n_added_lines++)
+                                        g_string_append_c(m_string, ' ');
+                                g_string_append(m_string, line);
+                        };
+                        if (style.underline != 0)
+                                add_line("underline");
+                        if (style.strikethrough)
+                                add_line("line-through");
+                        if (style.overline)
+                                add_line("overline");
+                        if (style.blink)
+                                add_line("blink");
+                }
+                if (has_deco_style) {
+                        static char const* const underline_styles[] = {"", "solid", "double", "wavy"};
+                        add_property("text-decoration-style:");
+                        g_string_append(m_string, underline_styles[style.underline & 3]);
+                }
+                if (has_deco_color) {
+                        add_property("text-decoration-color:");
+                        append_color(m_resolver(style.deco, true));
+                }
+                g_string_append(m_string, quoted ? "\">" : ">");
+        }
+
+        if (style.bold)
+                g_string_append_len(m_string, "<b>", 3);
+        if (style.italic)
+                g_string_append_len(m_string, "<i>", 3);
+}
+
+void
+HtmlExporter::close_span()
+{
+        if (m_style.italic)
+                g_string_append_len(m_string, "</i>", 4);
+        if (m_style.bold)
+                g_string_append_len(m_string, "</b>", 4);
+        if (m_span)
+                g_string_append_len(m_string, "</span>", 7);
+        m_span = false;
+}
+
+/*
+ * HtmlExporter::append:
+ * @text: UTF-8 text, which must not contain newlines
+ * @len: the length of @text in bytes
+ * @style: the attributes of @text
+ *
+ * Appends @text marked up with @style. Consecutive runs of the same style
+ * (e.g. that only differ in their hyperlink) share one span.
+ */
+void
+HtmlExporter::append(char const* text,
+                     size_t len,
+                     HtmlStyle const& style)
+{
+        if (style != m_style) {
+                close_span();
+                open_span(style);
+                m_style = style;
+        }
+
+        append_escaped(text, len);
+}
+
+void
+HtmlExporter::newline()
+{
+        close_span();
+        m_style = HtmlStyle{};
+        g_string_append_c(m_string, '\n');
+}
+
+void
+HtmlExporter::finish()
+{
+        close_span();
+        g_string_append(m_string, "</pre>");
+}
+
+} // namespace terminal
+
+} // namespace bte
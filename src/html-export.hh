@@ -0,0 +1,112 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <glib.h>
+
+#include "btedefines.hh"
+
+namespace bte {
+
+namespace terminal {
+
+/* The resolved attributes of a run of text, as determine_colors() returns them */
+struct HtmlStyle {
+        uint32_t fore{BTE_DEFAULT_FG};
+        uint32_t back{BTE_DEFAULT_BG};
+        uint32_t deco{BTE_DEFAULT_FG};
+        uint8_t underline{0}; /* 0: none, 1: single, 2: double, 3: curly */
+        bool bold{false};
+        bool italic{false};
+        bool strikethrough{false};
+        bool overline{false};
+        bool blink{false};
+        bool reverse{false};
+
+        bool operator==(HtmlStyle const& other) const noexcept
+        {
+                return fore == other.fore &&
+                        back == other.back &&
+                        deco == other.deco &&
+                        underline == other.underline &&
+                        bold == other.bold &&
+                        italic == other.italic &&
+                        strikethrough == other.strikethrough &&
+                        overline == other.overline &&
+                        blink == other.blink &&
+                        reverse == other.reverse;
+        }
+
+        bool operator!=(HtmlStyle const& other) const noexcept { return !operator==(other); }
+};
+
+/*
+ * Marks up text runs in HTML, appending directly to a GString.
+ *
+ * Each run of equal style becomes a single <span>, with all of its
+ * attributes inline: mail editors and the like drop any <style> element
+ * of pasted HTML, so the markup can't rely on one. The colours and the
+ * decoration lines are in the span's style attribute; bold and italic
+ * are <b> and <i> inside it, which are shorter.
+ */
+class HtmlExporter {
+public:
+        /* Returns the colour for a palette or direct colour index as 0xRRGGBB.
+         * @deco is true for underline colours, which use the R4G5B4 encoding.
+         */
+        using resolver_type = std::function<uint32_t(uint32_t index, bool deco)>;
+
+        HtmlExporter(GString* string,
+                     resolver_type resolver);
+        ~HtmlExporter() noexcept = default;
+
+        HtmlExporter(HtmlExporter const&) = delete;
+        HtmlExporter(HtmlExporter&&) = delete;
+        HtmlExporter& operator= (HtmlExporter const&) = delete;
+        HtmlExporter& operator= (HtmlExporter&&) = delete;
+
+        void append(char const* text,
+                    size_t len,
+                    HtmlStyle const& style);
+
+        /* Appends a line break; spans never extend over it */
+        void newline();
+
+        /* Closes the <pre>. Call exactly once. */
+        void finish();
+
+private:
+        GString* m_string;
+        resolver_type m_resolver;
+
+        HtmlStyle m_style{};  /* of the open run */
+        bool m_span{false};   /* whether the open run has a <span> */
+
+        void append_escaped(char const* text,
+                            size_t len);
+        void append_color(uint32_t color);
+        void open_span(HtmlStyle const& style);
+        void close_span();
+}; // class HtmlExporter
+
+} // namespace terminal
+
+} // namespace bte
@@ -22,23 +22,25 @@
 #include <cassert>
 #include <memory>
 
+#include <unicode/utf16.h>
+
 #include "icu-decoder.hh"
 
 namespace bte::base {
 
 /*
- * ICUDecoder::decode:
+ * ICUDecoder::decode_icu:
  * @sptr: inout pointer to input data
  * @flush: whether to flush
  *
- * Decodes input, and advances *@sptr for input consumed. At most
+ * Decodes input with ICU, and advances *@sptr for input consumed. At most
  * one byte of input is consumed; if flushing, no input is consumed.
  *
  * Returns: whether there is an output character available
  */
 ICUDecoder::Result
-ICUDecoder::decode(uint8_t const** sptr,
-                   bool flush) noexcept
+ICUDecoder::decode_icu(uint8_t const** sptr,
+                       bool flush) noexcept
 {
         switch (m_state) {
         case State::eOutput:
@@ -137,6 +139,58 @@ ICUDecoder::decode(uint8_t const** sptr,
         }
 }
 
+/*
+ * ICUDecoder::make_single_byte_table:
+ *
+ * If the charset is single-byte and stateless, decodes each byte like
+ * decode_icu() would, and keeps the results for decode() to look up.
+ * The table is only used if every byte decodes to exactly one character
+ * right away, so it gives the same output as ICU, including the
+ * substitution character for unmapped bytes.
+ */
+void
+ICUDecoder::make_single_byte_table()
+{
+        auto const converter = m_charset_converter.get();
+        switch (ucnv_getType(converter)) {
+        case UCNV_SBCS:
+        case UCNV_LATIN_1:
+        case UCNV_US_ASCII:
+                break;
+        default:
+                return;
+        }
+
+        auto table = std::make_unique<std::array<char32_t, 256>>();
+        auto err = icu::ErrorCode{};
+        for (auto c = 0u; c < table->size(); ++c) {
+                auto const byte = char(c);
+                auto source = &byte;
+                char16_t u16[4];
+                auto target = &u16[0];
+
+                ucnv_toUnicode(converter,
+                               &target, u16 + G_N_ELEMENTS(u16),
+                               &source, &byte + 1,
+                               nullptr /* offsets */,
+                               false /* flush */,
+                               err);
+                ucnv_resetToUnicode(converter);
+                if (err.isFailure() || source != &byte + 1)
+                        return;
+
+                auto const n = target - u16;
+                if (n == 1 && !U16_IS_SURROGATE(u16[0]))
+                        (*table)[c] = u16[0];
+                else if (n == 2 && U16_IS_LEAD(u16[0]) && U16_IS_TRAIL(u16[1]))
+                        (*table)[c] = U16_GET_SUPPLEMENTARY(u16[0], u16[1]);
+                else
+                        return;
+        }
+
+        m_single_byte_table = std::move(table);
+}
+
 void
 ICUDecoder::reset() noexcept
 {
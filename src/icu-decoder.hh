@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 
 #include <unicode/errorcode.h>
@@ -28,6 +29,10 @@ namespace bte::base {
  * bte::base::Decoder:
  *
  * Converts input from any ICU-supported charset to UTF-32, one input byte at a time.
+ *
+ * Stateless single-byte charsets, like CP437, ISO-8859-x and KOI8-R, are
+ * decoded by looking up each byte in a table that is precomputed with ICU
+ * when the decoder is created; all other charsets go through ICU.
  */
 class ICUDecoder {
 public:
@@ -38,7 +43,9 @@ public:
                    converter_shared_type u32_converter)
                 : m_charset_converter{charset_converter},
                   m_u32_converter{u32_converter}
-        { }
+        {
+                make_single_byte_table();
+        }
 
         ~ICUDecoder() noexcept { }
 
@@ -63,8 +70,19 @@ public:
 
         constexpr auto codepoint() const noexcept { return m_u32_buffer[m_index]; }
 
-        Result decode(uint8_t const** sptr,
-                      bool flush = false) noexcept;
+        inline Result decode(uint8_t const** sptr,
+                             bool flush = false) noexcept
+        {
+                if (!m_single_byte_table)
+                        return decode_icu(sptr, flush);
+
+                /* Every byte is a character, so there is nothing to flush */
+                if (flush)
+                        return Result::eNothing;
+
+                m_u32_buffer[0] = (*m_single_byte_table)[*(*sptr)++];
+                return Result::eSomething;
+        }
 
         void reset() noexcept;
 
@@ -82,6 +100,9 @@ private:
 
         icu::ErrorCode m_err{};
 
+        /* The character of each byte, if the charset is single-byte and stateless */
+        std::unique_ptr<std::array<char32_t, 256>> m_single_byte_table{};
+
         int m_available{0}; /* how many output characters are available */
         int m_index{0};     /* index of current output character in m_u32_buffer */
 
@@ -97,6 +118,11 @@ private:
         constexpr auto u16_buffer_end() const noexcept { return &m_u16_buffer[0] + 32; }
         constexpr auto u32_buffer_end() const noexcept { return &m_u32_buffer[0] + 32; }
 
+        Result decode_icu(uint8_t const** sptr,
+                          bool flush) noexcept;
+
+        void make_single_byte_table();
+
 }; // class ICUDecoder
 
 } // namespace bte::base
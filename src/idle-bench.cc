@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Measures the resident memory of many tabs that went idle, before and
+ * after they trim their memory, i.e. BTE_IDLE_TRIM_TIMEOUT seconds after
+ * their last output.
+ *
+ * The terminals are tabs in a notebook, so only the current one is drawn,
+ * and none of them has the focus.
+ */
+
+#include "config.h"
+
+#include <ctk/ctk.h>
+#include <bte/bte.h>
+
+#include "bench-common.hh"
+#include "btedefines.hh"
+
+static void
+iterate_for(gint64 usec)
+{
+        auto const end = g_get_monotonic_time() + usec;
+        while (g_get_monotonic_time() < end) {
+                if (!g_main_context_iteration(nullptr, false))
+                        g_usleep(10000);
+        }
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        auto n_tabs = gint{100};
+        auto n_lines = gint{2000};
+        GOptionEntry const entries[] = {
+                { "tabs", 't', 0, G_OPTION_ARG_INT, &n_tabs, "Number of tabs", "N" },
+                { "lines", 'n', 0, G_OPTION_ARG_INT, &n_lines, "Number of lines of output per tab", "N" },
+                { nullptr }
+        };
+
+        if (!bench_init(&argc, &argv, nullptr, entries))
+                return BENCH_EXIT_SKIP;
+
+        auto window = ctk_window_new(CTK_WINDOW_TOPLEVEL);
+        auto notebook = ctk_notebook_new();
+        ctk_container_add(CTK_CONTAINER(window), notebook);
+
+        auto const rss_start = bench_rss_kb();
+
+        /* Output like a build log, with some colours and wide lines */
+        auto line = g_string_new(nullptr);
+        for (auto i = 0; i < n_tabs; ++i) {
+                auto terminal = bte_terminal_new();
+                bte_terminal_set_size(BTE_TERMINAL(terminal), 160, 50);
+                ctk_notebook_append_page(CTK_NOTEBOOK(notebook), terminal, nullptr);
+                ctk_widget_show(terminal);
+
+                for (auto j = 0; j < n_lines; ++j) {
+                        g_string_printf(line, "\e[32m[%4d/%d]\e[m \e[1mCXX\e[m src/file-%d.cc -o obj/file-%d.o "
+                                        "-I. -Isrc -O2 -g -Wall -Wextra -pipe -fPIC -std=gnu++17\r\n",
+                                        j, n_lines, j, j);
+                        bte_terminal_feed(BTE_TERMINAL(terminal), line->str, line->len);
+                }
+        }
+        g_string_free(line, true);
+
+        ctk_widget_show_all(window);
+
+        /* Let all tabs process their output, and draw the current one */
+        iterate_for(2 * G_USEC_PER_SEC);
+        auto const rss_idle = bench_rss_kb();
+
+        /* Wait for the idle trim, plus a bit for the timers to fire */
+        g_print("Waiting %ds for the idle trim...\n", BTE_IDLE_TRIM_TIMEOUT);
+        iterate_for((BTE_IDLE_TRIM_TIMEOUT + 3) * G_USEC_PER_SEC);
+        auto const rss_trimmed = bench_rss_kb();
+
+        g_print("%d tabs of %d lines: RSS %ld kB when idle, %ld kB after trimming (%ld kB, %.1f%% less; %ld kB per tab)\n",
+                n_tabs, n_lines,
+                rss_idle - rss_start,
+                rss_trimmed - rss_start,
+                rss_idle - rss_trimmed,
+                rss_idle > rss_start ? 100. * (rss_idle - rss_trimmed) / (rss_idle - rss_start) : 0.,
+                n_tabs ? (rss_idle - rss_trimmed) / n_tabs : 0);
+
+        /* Switching to a tab rebuilds what it needs */
+        ctk_notebook_set_current_page(CTK_NOTEBOOK(notebook), n_tabs / 2);
+        iterate_for(G_USEC_PER_SEC / 2);
+        g_print("RSS %ld kB after switching tabs\n", bench_rss_kb() - rss_start);
+
+        ctk_widget_destroy(window);
+        return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <vector>
+
+#include <glib.h>
+
+#include "libc-glue.hh"
+
+#include "missing.hh"
+
+#define N_MANY_FDS (50000)
+
+static std::vector<int>
+open_fds(int n)
+{
+        auto devnull = bte::libc::FD{open("/dev/null", O_RDONLY | O_CLOEXEC)};
+        g_assert_true(bool(devnull));
+
+        auto fds = std::vector<int>{};
+        fds.reserve(n);
+        for (auto i = 0; i < n; ++i) {
+                /* Not O_CLOEXEC */
+                auto const fd = fcntl(devnull.get(), F_DUPFD, 3);
+                if (fd == -1)
+                        break;
+                fds.push_back(fd);
+        }
+
+        return fds;
+}
+
+static void
+close_fds(std::vector<int> const& fds)
+{
+        for (auto fd : fds)
+                close(fd);
+}
+
+static void
+test_fdwalk_set_cloexec(void)
+{
+        auto const fds = open_fds(16);
+        g_assert_cmpuint(fds.size(), ==, 16);
+
+        auto const lowfd = fds[8];
+        g_assert_cmpint(fdwalk_set_cloexec(lowfd), ==, 0);
+
+        for (auto fd : fds) {
+                if (fd < lowfd)
+                        g_assert_false(bte::libc::fd_get_cloexec(fd));
+                else
+                        g_assert_true(bte::libc::fd_get_cloexec(fd));
+        }
+
+        close_fds(fds);
+}
+
+/* Spawns a child the way SpawnContext::exec() does, with many FDs open,
+ * and returns the time it took in µs.
+ */
+static gint64
+spawn_with_fds(void)
+{
+        auto const start = g_get_monotonic_time();
+
+        auto const pid = fork();
+        g_assert_cmpint(pid, !=, -1);
+        if (pid == 0) {
+                if (fdwalk_set_cloexec(3) != 0)
+                        _exit(EXIT_FAILURE);
+
+                execl("/bin/sh", "sh", "-c", "exit 0", nullptr);
+                _exit(127);
+        }
+
+        int status;
+        g_assert_cmpint(waitpid(pid, &status, 0), ==, pid);
+        g_assert_true(WIFEXITED(status));
+        g_assert_cmpint(WEXITSTATUS(status), ==, 0);
+
+        return g_get_monotonic_time() - start;
+}
+
+static void
+test_fdwalk_set_cloexec_many(void)
+{
+        /* Raise the soft limit as far as allowed */
+        struct rlimit rlim;
+        g_assert_cmpint(getrlimit(RLIMIT_NOFILE, &rlim), ==, 0);
+        auto const saved_rlim = rlim;
+        if (rlim.rlim_max == RLIM_INFINITY || rlim.rlim_max > N_MANY_FDS + 64)
+                rlim.rlim_cur = N_MANY_FDS + 64;
+        else
+                rlim.rlim_cur = rlim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rlim);
+
+        auto const fds = open_fds(N_MANY_FDS);
+        if (fds.size() < N_MANY_FDS) {
+                close_fds(fds);
+                setrlimit(RLIMIT_NOFILE, &saved_rlim);
+                g_test_skip("Could not open enough file descriptors");
+                return;
+        }
+
+        /* Verify in a child, to not disturb our own FDs */
+        auto const pid = fork();
+        g_assert_cmpint(pid, !=, -1);
+        if (pid == 0) {
+                if (fdwalk_set_cloexec(3) != 0)
+                        _exit(EXIT_FAILURE);
+                for (auto fd : fds) {
+                        if (!bte::libc::fd_get_cloexec(fd))
+                                _exit(EXIT_FAILURE);
+                }
+                _exit(EXIT_SUCCESS);
+        }
+
+        int status;
+        g_assert_cmpint(waitpid(pid, &status, 0), ==, pid);
+        g_assert_true(WIFEXITED(status));
+        g_assert_cmpint(WEXITSTATUS(status), ==, EXIT_SUCCESS);
+
+        auto const n_runs = 10;
+        auto elapsed = gint64{0};
+        for (auto i = 0; i < n_runs; ++i)
+                elapsed += spawn_with_fds();
+
+        auto const close_range_supported = close_range(~0U, ~0U, CLOSE_RANGE_CLOEXEC) == 0;
+        g_test_message("Spawning with %d open FDs took %.3fms on average (close_range %s)",
+                       N_MANY_FDS,
+                       double(elapsed) / n_runs / 1000.,
+                       close_range_supported ? "supported" : "unsupported");
+
+        close_fds(fds);
+        setrlimit(RLIMIT_NOFILE, &saved_rlim);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/missing/fdwalk-set-cloexec", test_fdwalk_set_cloexec);
+        g_test_add_func("/bte/missing/fdwalk-set-cloexec/many", test_fdwalk_set_cloexec_many);
+
+        return g_test_run();
+}
@@ -28,6 +28,8 @@
 #include <sys/syscall.h>  /* for syscall and SYS_getdents64 */
 #endif
 
+#include "libc-glue.hh"
+
 #include "missing.hh"
 
 /* BEGIN copied from glib
@@ -212,3 +214,67 @@ strchrnul(char const* s,
 #endif /* !HAVE_STRCHRNUL */
 
 /* END copied from glib */
+
+#ifndef HAVE_CLOSE_RANGE
+/* This function is called between fork and execve/_exit and so must be
+ * async-signal-safe; see man:signal-safety(7).
+ */
+int
+close_range(unsigned int first,
+            unsigned int last,
+            int flags)
+{
+#if defined(__linux__) && defined(SYS_close_range)
+        return syscall(SYS_close_range, first, last, flags);
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+}
+#endif /* !HAVE_CLOSE_RANGE */
+
+/* This function is called between fork and execve/_exit and so must be
+ * async-signal-safe; see man:signal-safety(7).
+ */
+static int
+set_cloexec_cb(void* data,
+               int fd)
+{
+        if (fd >= *reinterpret_cast<int*>(data)) {
+                auto r = bte::libc::fd_set_cloexec(fd);
+                /* Ignore EBADF because the libc or fallback implementation
+                 * of fdwalk may call this function on invalid file descriptors.
+                 */
+                if (r < 0 && errno == EBADF)
+                        r = 0;
+                return r;
+        }
+        return 0;
+}
+
+/*
+ * fdwalk_set_cloexec:
+ * @lowfd: the lowest file descriptor to change
+ *
+ * Sets FD_CLOEXEC on all file descriptors >= @lowfd.
+ *
+ * This uses close_range() with CLOSE_RANGE_CLOEXEC if the running kernel
+ * supports it (Linux 5.11), which is a single syscall regardless of the
+ * number of open file descriptors, and falls back to fdwalk() otherwise.
+ *
+ * This function is called between fork and execve/_exit and so must be
+ * async-signal-safe; see man:signal-safety(7).
+ *
+ * Returns: 0 on success, or -1 with errno set on failure
+ */
+int
+fdwalk_set_cloexec(int lowfd)
+{
+        /* Fails with ENOSYS if close_range() is unsupported, and with EINVAL
+         * on kernels that support close_range() but not CLOSE_RANGE_CLOEXEC.
+         */
+        if (close_range(unsigned(lowfd), ~0U, CLOSE_RANGE_CLOEXEC) == 0)
+                return 0;
+
+        return fdwalk(set_cloexec_cb, &lowfd);
+}
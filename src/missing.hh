@@ -24,6 +24,16 @@
 #define NSIG (8 * sizeof(sigset_t))
 #endif
 
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+
+#ifndef HAVE_CLOSE_RANGE
+int close_range(unsigned int first,
+                unsigned int last,
+                int flags);
+#endif
+
 #ifndef HAVE_FDWALK
 int fdwalk(int (*cb)(void* data, int fd),
            void* data);
@@ -33,3 +43,5 @@ int fdwalk(int (*cb)(void* data, int fd),
 char* strchrnul(char const* s,
                 int c);
 #endif
+
+int fdwalk_set_cloexec(int lowfd);
@@ -676,6 +676,11 @@ private:
                                         if (ret != BTE_SEQ_NONE) {
                                                 m_cmd_stats[seq.command()]++;
                                                 func(seq);
+                                        } else {
+                                                auto const n = parser.feed_string(sptr + 1,
+                                                                                  bufend - sptr - 1);
+                                                m_seq_stats[BTE_SEQ_NONE] += n;
+                                                sptr += n;
                                         }
                                         break;
                                 }
@@ -53,6 +53,39 @@ public:
                 return bte_parser_feed(&m_parser, raw);
         }
 
+        /* Returns the number of bytes of @data consumed by an OSC or
+         * DCS string in progress; see bte_parser_feed_string().
+         */
+        inline size_t feed_string(uint8_t const* data,
+                                  size_t len) noexcept
+        {
+                return bte_parser_feed_string(&m_parser, data, len);
+        }
+
+        /* Whether feed_string() might consume anything */
+        inline bool in_string() const noexcept
+        {
+                return bte_parser_in_string(&m_parser);
+        }
+
+        inline bool in_osc_string() const noexcept
+        {
+                return bte_parser_in_osc_string(&m_parser);
+        }
+
+        /* Returns the OSC string in progress, if any, and its ID */
+        inline uint32_t const* osc_string(size_t* len,
+                                          unsigned int* id) const noexcept
+        {
+                *id = m_parser.seq.string_id;
+                return bte_parser_get_osc_string(&m_parser, len);
+        }
+
+        inline void truncate_string(size_t len) noexcept
+        {
+                bte_parser_truncate_string(&m_parser, len);
+        }
+
         inline void reset() noexcept
         {
                 bte_parser_reset(&m_parser);
@@ -173,6 +206,18 @@ public:
                 return m_seq->intermediates;
         }
 
+        /* string_id:
+         *
+         * This identifies the string of an OSC sequence; see
+         * Parser::osc_string().
+         *
+         * Returns: the string ID
+         */
+        inline constexpr unsigned int string_id() const noexcept
+        {
+                return m_seq->string_id;
+        }
+
         // FIXMEchpe: upgrade to C++17 and use the u32string_view version below, instead
         /*
          * string:
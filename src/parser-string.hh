@@ -99,6 +99,36 @@ static inline bool bte_seq_string_push(bte_seq_string_t* str,
         return true;
 }
 
+/*
+ * bte_seq_string_append_ascii:
+ * @string:
+ * @data: ASCII characters
+ * @len: the number of characters in @data
+ *
+ * Appends the characters in @data to @str, as far as they fit into the
+ * maximum length.
+ *
+ * Returns: the number of characters appended
+ */
+static inline size_t bte_seq_string_append_ascii(bte_seq_string_t* str,
+                                                 uint8_t const* data,
+                                                 size_t len) noexcept
+{
+        if (len > BTE_SEQ_STRING_MAX_CAPACITY - str->len)
+                len = BTE_SEQ_STRING_MAX_CAPACITY - str->len;
+
+        if (str->len + len > str->capacity) {
+                while (str->len + len > str->capacity)
+                        str->capacity *= 2;
+                str->buf = (uint32_t*)g_realloc_n(str->buf, str->capacity, sizeof(uint32_t));
+        }
+
+        for (size_t i = 0; i < len; ++i)
+                str->buf[str->len + i] = data[i];
+        str->len += len;
+        return len;
+}
+
 /*
  * bte_seq_string_finish:
  * @string:
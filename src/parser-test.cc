@@ -1343,6 +1343,55 @@ test_seq_osc(void)
         }
 }
 
+static int
+feed_parser_bulk(std::string const& str)
+{
+        auto const data = reinterpret_cast<uint8_t const*>(str.data());
+        auto rv = int{BTE_SEQ_NONE};
+        for (size_t i = 0; i < str.size(); ++i) {
+                rv = parser.feed(data[i]);
+                if (rv == BTE_SEQ_NONE)
+                        i += parser.feed_string(data + i + 1, str.size() - i - 1);
+        }
+        return rv;
+}
+
+static void
+test_seq_string_bulk(void)
+{
+        /* OSC, including the controls that end the run */
+        parser.reset();
+        auto rv = feed_parser_bulk("\e]0;title with spaces\x01 and a control~\a"s);
+        g_assert_cmpint(rv, ==, BTE_SEQ_OSC);
+        g_assert_true(seq.string() == U"0;title with spaces and a control~"s);
+
+        /* DCS */
+        parser.reset();
+        rv = feed_parser_bulk("\eP1;2|some data\e\\"s);
+        g_assert_cmpint(rv, ==, BTE_SEQ_DCS);
+        g_assert_true(seq.string() == U"some data"s);
+
+        /* String of the maximum length */
+        auto payload = std::string(BTE_SEQ_STRING_MAX_CAPACITY - 3, 'A');
+        parser.reset();
+        rv = feed_parser_bulk("\e]52;"s + payload + "\a"s);
+        g_assert_cmpint(rv, ==, BTE_SEQ_OSC);
+        g_assert_cmpuint(seq.string().size(), ==, BTE_SEQ_STRING_MAX_CAPACITY);
+
+        /* Length exceeded; the rest of the string is ignored */
+        payload.push_back('A');
+        parser.reset();
+        rv = feed_parser_bulk("\e]52;"s + payload + "\x9c"s);
+        g_assert_cmpint(rv, ==, BTE_SEQ_IGNORE);
+
+        rv = feed_parser_bulk("\eP|"s + payload + payload + "\x9c"s);
+        g_assert_cmpint(rv, ==, BTE_SEQ_NONE);
+
+        /* Nothing is consumed outside of strings */
+        parser.reset();
+        g_assert_cmpuint(parser.feed_string(reinterpret_cast<uint8_t const*>("text"), 4), ==, 0);
+}
+
 static void
 test_seq_glue_string(void)
 {
@@ -1483,6 +1532,7 @@ main(int argc,
 
         g_test_add_func("/bte/parser/sequences/arg", test_seq_arg);
         g_test_add_func("/bte/parser/sequences/string", test_seq_string);
+        g_test_add_func("/bte/parser/sequences/string/bulk", test_seq_string_bulk);
         g_test_add_func("/bte/parser/sequences/glue/arg", test_seq_glue_arg);
         g_test_add_func("/bte/parser/sequences/glue/string", test_seq_glue_string);
         g_test_add_func("/bte/parser/sequences/glue/string-tokeniser", test_seq_glue_string_tokeniser);
@@ -20,6 +20,7 @@
 
 #include "parser.hh"
 
+#include <array>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
@@ -493,111 +494,390 @@ bte_parse_host_sci(bte_seq_t const* seq)
  * It was written from scratch and extended where needed.
  * This parser is fully compatible up to the vt500 series. We expect UCS-4 as
  * input. It's the callers responsibility to do any UTF-8 parsing.
+ * The states are in parser.hh.
  */
 
-enum parser_state_t {
-        STATE_GROUND,           /* initial state and ground */
-        STATE_DCS_PASS_ESC,     /* ESC after DCS which may be ESC \ aka C0 ST */
-        STATE_OSC_STRING_ESC,   /* ESC after OSC which may be ESC \ aka C0 ST */
-        STATE_ESC,              /* ESC sequence was started */
-        STATE_ESC_INT,          /* intermediate escape characters */
-        STATE_CSI_ENTRY,        /* starting CSI sequence */
-        STATE_CSI_PARAM,        /* CSI parameters */
-        STATE_CSI_INT,          /* intermediate CSI characters */
-        STATE_CSI_IGNORE,       /* CSI error; ignore this CSI sequence */
-        STATE_DCS_ENTRY,        /* starting DCS sequence */
-        STATE_DCS_PARAM,        /* DCS parameters */
-        STATE_DCS_INT,          /* intermediate DCS characters */
-        STATE_DCS_PASS,         /* DCS data passthrough */
-        STATE_DCS_IGNORE,       /* DCS error; ignore this DCS sequence */
-        STATE_OSC_STRING,       /* parsing OSC sequence */
-        STATE_ST_IGNORE,        /* unimplemented seq; ignore until ST */
-        STATE_SCI,              /* single character introducer sequence was started */
-
-        STATE_N,
-};
+/*
+ * Byte classes
+ *
+ * The input is UCS-4, but all codepoints from 0xa0 up behave the same in
+ * every state, so the classes of the codepoints below that are looked up in
+ * a table, and all others are CLASS_GRAPHIC.
+ * The classes from CLASS_CAN on have the same transition in every state
+ * ("anywhere" transitions in the state diagram).
+ */
 
-/* Parser state transitioning */
+enum parser_class_t {
+        CLASS_C0,               /* C0 \ { BEL, BS..CR, CAN, SUB, ESC } */
+        CLASS_BEL,              /* BEL */
+        CLASS_FORMAT,           /* BS, HT, LF, VT, FF, CR */
+        CLASS_ESC,              /* ESC */
+        CLASS_INTERMEDIATE,     /* [' ' - '/'] */
+        CLASS_DIGIT,            /* ['0' - '9'] */
+        CLASS_COLON,            /* ':' */
+        CLASS_SEMICOLON,        /* ';' */
+        CLASS_PARAMETER,        /* ['<' - '?'] */
+        CLASS_FINAL,            /* ['@' - '~'] \ { 'P', 'X', 'Z', '[', '\', ']', '^', '_' } */
+        CLASS_FINAL_DCS,        /* 'P' */
+        CLASS_FINAL_SOS_PM_APC, /* 'X', '^', '_' */
+        CLASS_FINAL_SCI,        /* 'Z' */
+        CLASS_FINAL_CSI,        /* '[' */
+        CLASS_FINAL_ST,         /* '\' */
+        CLASS_FINAL_OSC,        /* ']' */
+        CLASS_ST,               /* ST */
+        CLASS_GRAPHIC,          /* >= 0xa0 */
+
+        CLASS_CAN,              /* CAN */
+        CLASS_SUB,              /* SUB */
+        CLASS_DEL,              /* DEL */
+        CLASS_C1,               /* C1 \ { DCS, SOS, SCI, CSI, ST, OSC, PM, APC } */
+        CLASS_C1_DCS,           /* DCS */
+        CLASS_C1_SOS_PM_APC,    /* SOS, PM, APC */
+        CLASS_C1_SCI,           /* SCI */
+        CLASS_C1_CSI,           /* CSI */
+        CLASS_C1_OSC,           /* OSC */
+
+        CLASS_N,
+};
 
-typedef int (* parser_action_func)(bte_parser_t* parser, uint32_t raw);
+static constexpr uint8_t
+parser_byte_class(uint32_t raw) noexcept
+{
+        switch (raw) {
+        case 0x07:                return CLASS_BEL;
+        case 0x08 ... 0x0d:       return CLASS_FORMAT;
+        case 0x18:                return CLASS_CAN;
+        case 0x1a:                return CLASS_SUB;
+        case 0x1b:                return CLASS_ESC;
+        case 0x00 ... 0x06:
+        case 0x0e ... 0x17:
+        case 0x19:
+        case 0x1c ... 0x1f:       return CLASS_C0;
+        case 0x20 ... 0x2f:       return CLASS_INTERMEDIATE;
+        case 0x30 ... 0x39:       return CLASS_DIGIT;
+        case 0x3a:                return CLASS_COLON;
+        case 0x3b:                return CLASS_SEMICOLON;
+        case 0x3c ... 0x3f:       return CLASS_PARAMETER;
+        case 0x50:                return CLASS_FINAL_DCS;
+        case 0x58:
+        case 0x5e:
+        case 0x5f:                return CLASS_FINAL_SOS_PM_APC;
+        case 0x5a:                return CLASS_FINAL_SCI;
+        case 0x5b:                return CLASS_FINAL_CSI;
+        case 0x5c:                return CLASS_FINAL_ST;
+        case 0x5d:                return CLASS_FINAL_OSC;
+        case 0x40 ... 0x4f:
+        case 0x51 ... 0x57:
+        case 0x59:
+        case 0x60 ... 0x7e:       return CLASS_FINAL;
+        case 0x7f:                return CLASS_DEL;
+        case 0x90:                return CLASS_C1_DCS;
+        case 0x98:
+        case 0x9e:
+        case 0x9f:                return CLASS_C1_SOS_PM_APC;
+        case 0x9a:                return CLASS_C1_SCI;
+        case 0x9b:                return CLASS_C1_CSI;
+        case 0x9c:                return CLASS_ST;
+        case 0x9d:                return CLASS_C1_OSC;
+        case 0x80 ... 0x8f:
+        case 0x91 ... 0x97:
+        case 0x99:                return CLASS_C1;
+        default:                  return CLASS_GRAPHIC;
+        }
+}
 
-// FIXMEchpe: I get weird performance results here from
-// either not inlining, inlining these function or the
-// macros below. Sometimes (after a recompile) one is
-// (as much as 50%!) slower, sometimes the other one etc. ‽
+static constexpr auto
+parser_make_class_table() noexcept
+{
+        std::array<uint8_t, 0xa0> table{};
+        for (auto raw = 0u; raw < table.size(); ++raw)
+                table[raw] = parser_byte_class(raw);
+        return table;
+}
 
-#if 1 // (inline) functions
+static constexpr auto const k_parser_class_table = parser_make_class_table();
+
+/* Parser actions; see the parser_*() functions below */
+
+enum parser_action_t {
+        ACTION_NONE,
+        ACTION_CLEAR,
+        ACTION_CLEAR_INT,
+        ACTION_CLEAR_INT_AND_PARAMS,
+        ACTION_CLEAR_PARAMS_ONLY,
+        ACTION_IGNORE,
+        ACTION_PRINT,
+        ACTION_EXECUTE,
+        ACTION_COLLECT_ESC,
+        ACTION_COLLECT_CSI,
+        ACTION_COLLECT_DCS = ACTION_COLLECT_CSI,
+        ACTION_COLLECT_PARAMETER,
+        ACTION_PARAM,
+        ACTION_FINISH_PARAM,
+        ACTION_FINISH_SUBPARAM,
+        ACTION_ESC_DISPATCH,
+        ACTION_CSI_DISPATCH,
+        ACTION_DCS_START,
+        ACTION_DCS_CONSUME,
+        ACTION_DCS_COLLECT,
+        ACTION_DCS_DISPATCH,
+        ACTION_OSC_START,
+        ACTION_OSC_COLLECT,
+        ACTION_OSC_DISPATCH,
+        ACTION_SCI_DISPATCH,
+        ACTION_ESC_DEFERRED,    /* do the deferred ESC transition, then feed again */
+};
 
-// #define PTINLINE inline
-#define PTINLINE
+struct parser_transition_t {
+        uint8_t state;
+        uint8_t action;
+};
 
-/* nop */
-static PTINLINE int
-parser_nop(bte_parser_t* parser,
-           uint32_t raw)
+static constexpr bool
+parser_class_is_c0(unsigned int byte_class) noexcept
 {
-        return BTE_SEQ_NONE;
+        return byte_class == CLASS_C0 ||
+                byte_class == CLASS_BEL ||
+                byte_class == CLASS_FORMAT;
 }
-/* dispatch related actions */
-static PTINLINE int
-parser_action(bte_parser_t* parser,
-              uint32_t raw,
-              parser_action_func action)
+
+/* ['0' - '?'] */
+static constexpr bool
+parser_class_is_parameter(unsigned int byte_class) noexcept
 {
-        return action(parser, raw);
+        return byte_class >= CLASS_DIGIT && byte_class <= CLASS_PARAMETER;
 }
 
-/* perform state transition */
-static PTINLINE int
-parser_transition_no_action(bte_parser_t* parser,
-                            uint32_t raw,
-                            unsigned int state)
+/* ['@' - '~'] */
+static constexpr bool
+parser_class_is_final(unsigned int byte_class) noexcept
 {
-        parser->state = state;
-        return BTE_SEQ_NONE;
+        return byte_class >= CLASS_FINAL && byte_class <= CLASS_FINAL_OSC;
 }
 
-/* perform state transition and dispatch related actions */
-static PTINLINE int
-parser_transition(bte_parser_t* parser,
-                  uint32_t raw,
-                  unsigned int state,
-                  parser_action_func action)
+/* The transition from @state on a codepoint of @byte_class, with the
+ * action to perform after entering the new state.
+ */
+static constexpr parser_transition_t
+parser_make_transition(unsigned int state,
+                       unsigned int byte_class) noexcept
 {
-        parser->state = state;
+        auto const stay = [state](unsigned int action) constexpr -> parser_transition_t {
+                return {uint8_t(state), uint8_t(action)};
+        };
+        auto const to = [](unsigned int new_state,
+                           unsigned int action) constexpr -> parser_transition_t {
+                return {uint8_t(new_state), uint8_t(action)};
+        };
 
-        return action(parser, raw);
-}
+        /*
+         * Notes:
+         *  * DEC treats GR codes as GL. We don't do that as we require UTF-8
+         *    as charset and, thus, it doesn't make sense to treat GR special.
+         *  * During control sequences, unexpected C1 codes cancel the sequence
+         *    and immediately start a new one. C0 codes, however, may or may not
+         *    be ignored/executed depending on the sequence.
+         */
+        switch (byte_class) {
+        case CLASS_CAN:
+                return to(STATE_GROUND, ACTION_IGNORE);
+        case CLASS_SUB:
+        case CLASS_C1:
+                return to(STATE_GROUND, ACTION_EXECUTE);
+        case CLASS_DEL:
+                return stay(ACTION_NONE);
+        case CLASS_C1_SOS_PM_APC:
+                // FIXMEchpe shouldn't this use ACTION_CLEAR?
+                return to(STATE_ST_IGNORE, ACTION_NONE);
+        case CLASS_C1_DCS:
+                return to(STATE_DCS_ENTRY, ACTION_DCS_START);
+        case CLASS_C1_SCI:
+                return to(STATE_SCI, ACTION_CLEAR);
+        case CLASS_C1_OSC:
+                return to(STATE_OSC_STRING, ACTION_OSC_START);
+        case CLASS_C1_CSI:
+                return to(STATE_CSI_ENTRY, ACTION_CLEAR_INT_AND_PARAMS);
+        }
+
+        /* Apart from in the string states, ESC starts a new sequence */
+        if (byte_class == CLASS_ESC) {
+                switch (state) {
+                case STATE_DCS_PASS:
+                        return to(STATE_DCS_PASS_ESC, ACTION_NONE);
+                case STATE_OSC_STRING:
+                        return to(STATE_OSC_STRING_ESC, ACTION_NONE);
+                default:
+                        return to(STATE_ESC, ACTION_CLEAR_INT);
+                }
+        }
+
+        switch (state) {
+        case STATE_GROUND:
+                if (parser_class_is_c0(byte_class) || byte_class == CLASS_ST)
+                        return stay(ACTION_EXECUTE);
+                return stay(ACTION_PRINT);
+
+        case STATE_DCS_PASS_ESC:
+                if (byte_class == CLASS_FINAL_ST)
+                        return to(STATE_GROUND, ACTION_DCS_DISPATCH);
+                return to(STATE_ESC, ACTION_ESC_DEFERRED);
+
+        case STATE_OSC_STRING_ESC:
+                if (byte_class == CLASS_FINAL_ST)
+                        return to(STATE_GROUND, ACTION_OSC_DISPATCH);
+                return to(STATE_ESC, ACTION_ESC_DEFERRED);
+
+        case STATE_ESC:
+                if (parser_class_is_c0(byte_class))
+                        return stay(ACTION_EXECUTE);
+                switch (byte_class) {
+                case CLASS_INTERMEDIATE:
+                        return to(STATE_ESC_INT, ACTION_COLLECT_ESC);
+                case CLASS_FINAL_DCS:
+                        return to(STATE_DCS_ENTRY, ACTION_DCS_START);
+                case CLASS_FINAL_SCI:
+                        return to(STATE_SCI, ACTION_CLEAR);
+                case CLASS_FINAL_CSI:
+                        return to(STATE_CSI_ENTRY, ACTION_CLEAR_PARAMS_ONLY
+                                  /* rest already cleaned on ESC state entry */);
+                case CLASS_FINAL_OSC:
+                        return to(STATE_OSC_STRING, ACTION_OSC_START);
+                case CLASS_FINAL_SOS_PM_APC:
+                        return to(STATE_ST_IGNORE, ACTION_NONE);
+                }
+                if (parser_class_is_parameter(byte_class) ||
+                    parser_class_is_final(byte_class))
+                        return to(STATE_GROUND, ACTION_ESC_DISPATCH);
+                return to(STATE_GROUND, ACTION_IGNORE);
 
-#undef PTINLINE
+        case STATE_ESC_INT:
+                if (parser_class_is_c0(byte_class))
+                        return stay(ACTION_EXECUTE);
+                if (byte_class == CLASS_INTERMEDIATE)
+                        return stay(ACTION_COLLECT_ESC);
+                if (parser_class_is_parameter(byte_class) ||
+                    parser_class_is_final(byte_class))
+                        return to(STATE_GROUND, ACTION_ESC_DISPATCH);
+                return to(STATE_GROUND, ACTION_IGNORE);
 
-#else // macros
+        case STATE_CSI_ENTRY:
+        case STATE_CSI_PARAM:
+        case STATE_CSI_INT:
+                if (parser_class_is_c0(byte_class))
+                        return stay(ACTION_EXECUTE);
+                if (byte_class == CLASS_INTERMEDIATE)
+                        return to(STATE_CSI_INT, ACTION_COLLECT_CSI);
+                if (parser_class_is_final(byte_class))
+                        return to(STATE_GROUND, ACTION_CSI_DISPATCH);
+                if (byte_class == CLASS_ST)
+                        return to(STATE_GROUND, ACTION_IGNORE);
+                if (state == STATE_CSI_INT)
+                        return to(STATE_CSI_IGNORE, ACTION_NONE);
+                switch (byte_class) {
+                case CLASS_DIGIT:
+                        return to(STATE_CSI_PARAM, ACTION_PARAM);
+                case CLASS_COLON:
+                        return to(STATE_CSI_PARAM, ACTION_FINISH_SUBPARAM);
+                case CLASS_SEMICOLON:
+                        return to(STATE_CSI_PARAM, ACTION_FINISH_PARAM);
+                case CLASS_PARAMETER:
+                        /* Only allowed at the start of the parameters */
+                        if (state == STATE_CSI_ENTRY)
+                                return to(STATE_CSI_PARAM, ACTION_COLLECT_PARAMETER);
+                        break;
+                }
+                return to(STATE_CSI_IGNORE, ACTION_NONE);
+
+        case STATE_CSI_IGNORE:
+                if (parser_class_is_c0(byte_class))
+                        return stay(ACTION_EXECUTE);
+                if (parser_class_is_final(byte_class))
+                        return to(STATE_GROUND, ACTION_NONE);
+                if (byte_class == CLASS_ST)
+                        return to(STATE_GROUND, ACTION_IGNORE);
+                return stay(ACTION_NONE);
+
+        case STATE_DCS_ENTRY:
+        case STATE_DCS_PARAM:
+        case STATE_DCS_INT:
+                if (parser_class_is_c0(byte_class))
+                        return stay(ACTION_IGNORE);
+                if (byte_class == CLASS_INTERMEDIATE)
+                        return to(STATE_DCS_INT, ACTION_COLLECT_DCS);
+                if (byte_class == CLASS_ST)
+                        return to(STATE_GROUND, ACTION_IGNORE);
+                if (!parser_class_is_parameter(byte_class))
+                        return to(STATE_DCS_PASS, ACTION_DCS_CONSUME);
+                if (state == STATE_DCS_INT)
+                        return to(STATE_DCS_IGNORE, ACTION_NONE);
+                switch (byte_class) {
+                case CLASS_DIGIT:
+                        return to(STATE_DCS_PARAM, ACTION_PARAM);
+                case CLASS_COLON:
+                        return to(STATE_DCS_PARAM, ACTION_FINISH_SUBPARAM);
+                case CLASS_SEMICOLON:
+                        return to(STATE_DCS_PARAM, ACTION_FINISH_PARAM);
+                case CLASS_PARAMETER:
+                        /* Only allowed at the start of the parameters */
+                        if (state == STATE_DCS_ENTRY)
+                                return to(STATE_DCS_PARAM, ACTION_COLLECT_PARAMETER);
+                        break;
+                }
+                return to(STATE_DCS_IGNORE, ACTION_NONE);
 
-/* nop */
-#define parser_nop(parser,raw) \
-        ({ BTE_SEQ_NONE; })
+        case STATE_DCS_PASS:
+                if (byte_class == CLASS_ST)
+                        return to(STATE_GROUND, ACTION_DCS_DISPATCH);
+                return stay(ACTION_DCS_COLLECT);
 
-/* dispatch related actions */
-#define parser_action(p,r,a) \
-        ({ \
-                a((p), (r)); \
-        })
+        case STATE_DCS_IGNORE:
+                if (byte_class == CLASS_ST)
+                        return to(STATE_GROUND, ACTION_NONE);
+                return stay(ACTION_NONE);
 
-/* perform state transition */
-#define parser_transition_no_action(p,r,s) \
-        ({ \
-                parser->state = s; \
-                BTE_SEQ_NONE; \
-        })
+        case STATE_OSC_STRING:
+                switch (byte_class) {
+                case CLASS_C0:
+                case CLASS_FORMAT:
+                        return stay(ACTION_NONE);
+                case CLASS_BEL:
+                case CLASS_ST:
+                        return to(STATE_GROUND, ACTION_OSC_DISPATCH);
+                }
+                return stay(ACTION_OSC_COLLECT);
 
-/* perform state transition and dispatch related actions */
-#define parser_transition(p,r,s,a) \
-        ({ \
-                (p)->state = s; \
-                a((p), (r)); \
-        })
+        case STATE_ST_IGNORE:
+                if (byte_class == CLASS_ST)
+                        return to(STATE_GROUND, ACTION_IGNORE);
+                return stay(ACTION_NONE);
 
-#endif // (inline) functions or macros
+        case STATE_SCI:
+                if (byte_class == CLASS_FORMAT ||
+                    byte_class == CLASS_INTERMEDIATE ||
+                    parser_class_is_parameter(byte_class) ||
+                    parser_class_is_final(byte_class))
+                        return to(STATE_GROUND, ACTION_SCI_DISPATCH);
+                return to(STATE_GROUND, ACTION_IGNORE);
+        }
+
+        return to(STATE_GROUND, ACTION_IGNORE);
+}
+
+static constexpr auto
+parser_make_transition_table() noexcept
+{
+        std::array<std::array<parser_transition_t, CLASS_N>, STATE_N> table{};
+        for (auto state = 0u; state < STATE_N; ++state)
+                for (auto byte_class = 0u; byte_class < CLASS_N; ++byte_class)
+                        table[state][byte_class] = parser_make_transition(state, byte_class);
+        return table;
+}
+
+static constexpr auto const k_parser_transition_table = parser_make_transition_table();
+
+static_assert(k_parser_transition_table[STATE_GROUND][CLASS_GRAPHIC].action == ACTION_PRINT);
+static_assert(k_parser_transition_table[STATE_CSI_PARAM][CLASS_DIGIT].state == STATE_CSI_PARAM);
+static_assert(k_parser_transition_table[STATE_OSC_STRING_ESC][CLASS_FINAL_ST].action == ACTION_OSC_DISPATCH);
 
 /**
  * bte_parser_init() - Initialise parser object
@@ -772,10 +1052,8 @@ parser_params_overflow(bte_parser_t* parser,
          * Transition to STATE_{CSI,DCS}_IGNORE to ignore the
          * whole sequence.
          */
-        parser_transition_no_action(parser,
-                                    raw,
-                                    parser->state == STATE_CSI_PARAM ?
-                                    STATE_CSI_IGNORE : STATE_DCS_IGNORE);
+        parser->state = parser->state == STATE_CSI_PARAM ?
+                STATE_CSI_IGNORE : STATE_DCS_IGNORE;
 }
 
 /* The next two functions are only called when encountering a ';' or ':',
@@ -831,6 +1109,7 @@ parser_osc_start(bte_parser_t* parser,
         parser_clear(parser, raw);
 
         bte_seq_string_reset(&parser->seq.arg_str);
+        ++parser->seq.string_id;
 
         parser->seq.introducer = raw;
         return BTE_SEQ_NONE;
@@ -984,463 +1263,208 @@ parser_sci(bte_parser_t* parser,
         return parser->seq.type;
 }
 
-#define ACTION_CLEAR parser_clear
-#define ACTION_CLEAR_INT parser_clear_int
-#define ACTION_CLEAR_INT_AND_PARAMS parser_clear_int_and_params
-#define ACTION_CLEAR_PARAMS_ONLY parser_clear_params
-#define ACTION_IGNORE parser_ignore
-#define ACTION_PRINT parser_print
-#define ACTION_EXECUTE parser_execute
-#define ACTION_COLLECT_ESC parser_collect_esc
-#define ACTION_COLLECT_CSI parser_collect_csi
-#define ACTION_COLLECT_DCS ACTION_COLLECT_CSI
-#define ACTION_COLLECT_PARAMETER parser_collect_parameter
-#define ACTION_PARAM parser_param
-#define ACTION_FINISH_PARAM parser_finish_param
-#define ACTION_FINISH_SUBPARAM parser_finish_subparam
-#define ACTION_ESC_DISPATCH parser_esc
-#define ACTION_CSI_DISPATCH parser_csi
-#define ACTION_DCS_START parser_dcs_start
-#define ACTION_DCS_CONSUME parser_dcs_consume
-#define ACTION_DCS_COLLECT parser_dcs_collect
-#define ACTION_DCS_DISPATCH parser_dcs
-#define ACTION_OSC_START parser_osc_start
-#define ACTION_OSC_COLLECT parser_osc_collect
-#define ACTION_OSC_DISPATCH parser_osc
-#define ACTION_SCI_DISPATCH parser_sci
-
 static int
-parser_feed_to_state(bte_parser_t* parser,
-                     uint32_t raw)
+parser_feed_class(bte_parser_t* parser,
+                  uint32_t raw,
+                  unsigned int byte_class)
 {
-        switch (parser->state) {
-        case STATE_GROUND:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                case 0x80 ... 0x9f:        /* C1 */
-                        return parser_action(parser, raw,
-                                             ACTION_EXECUTE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                }
-
-                return parser_action(parser, raw,
-                                     ACTION_PRINT);
-
-        case STATE_DCS_PASS_ESC:
-        case STATE_OSC_STRING_ESC:
-                if (raw == 0x5c /* '\' */) {
-                        switch (parser->state) {
-                        case STATE_DCS_PASS_ESC:
-                                return parser_transition(parser, raw, STATE_GROUND,
-                                                         ACTION_DCS_DISPATCH);
-                        case STATE_OSC_STRING_ESC:
-                                return parser_transition(parser, raw, STATE_GROUND,
-                                                         ACTION_OSC_DISPATCH);
-                        }
-                }
-
-                /* Do the deferred clear and fallthrough to STATE_ESC */
-                parser_transition(parser, 0x1b /* ESC */, STATE_ESC,
-                                  ACTION_CLEAR_INT);
-
-                [[fallthrough]];
-        case STATE_ESC:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                                 ACTION_EXECUTE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_transition(parser, raw, STATE_ESC_INT,
-                                                 ACTION_COLLECT_ESC);
-                case 0x30 ... 0x4f:        /* ['0' - '~'] \ */
-                case 0x51 ... 0x57:        /* { 'P', 'X', 'Z' '[', ']', '^', '_' } */
-                case 0x59:
-                case 0x5c:
-                case 0x60 ... 0x7e:
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_ESC_DISPATCH);
-                case 0x50:                /* 'P' */
-                        return parser_transition(parser, raw, STATE_DCS_ENTRY,
-                                                 ACTION_DCS_START);
-                case 0x5a:                /* 'Z' */
-                        return parser_transition(parser, raw, STATE_SCI,
-                                                 ACTION_CLEAR);
-                case 0x5b:                /* '[' */
-                        return parser_transition(parser, raw, STATE_CSI_ENTRY,
-                                                 ACTION_CLEAR_PARAMS_ONLY
-                                                 /* rest already cleaned on ESC state entry */);
-                case 0x5d:                /* ']' */
-                        return parser_transition(parser, raw, STATE_OSC_STRING,
-                                                 ACTION_OSC_START);
-                case 0x58:                /* 'X' */
-                case 0x5e:                /* '^' */
-                case 0x5f:                /* '_' */
-                        return parser_transition_no_action(parser, raw, STATE_ST_IGNORE);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
-
-                return parser_transition(parser, raw, STATE_GROUND,
-                                         ACTION_IGNORE);
-        case STATE_ESC_INT:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_EXECUTE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_action(parser, raw,
-                                             ACTION_COLLECT_ESC);
-                case 0x30 ... 0x7e:        /* ['0' - '~'] */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_ESC_DISPATCH);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
+        auto const transition = k_parser_transition_table[parser->state][byte_class];
+
+        /* Enter the new state first, since some actions leave it again */
+        parser->state = transition.state;
+
+        switch (transition.action) {
+        case ACTION_NONE:
+                return BTE_SEQ_NONE;
+        case ACTION_CLEAR:
+                return parser_clear(parser, raw);
+        case ACTION_CLEAR_INT:
+                return parser_clear_int(parser, raw);
+        case ACTION_CLEAR_INT_AND_PARAMS:
+                return parser_clear_int_and_params(parser, raw);
+        case ACTION_CLEAR_PARAMS_ONLY:
+                return parser_clear_params(parser, raw);
+        case ACTION_IGNORE:
+                return parser_ignore(parser, raw);
+        case ACTION_PRINT:
+                return parser_print(parser, raw);
+        case ACTION_EXECUTE:
+                return parser_execute(parser, raw);
+        case ACTION_COLLECT_ESC:
+                return parser_collect_esc(parser, raw);
+        case ACTION_COLLECT_CSI:
+                return parser_collect_csi(parser, raw);
+        case ACTION_COLLECT_PARAMETER:
+                return parser_collect_parameter(parser, raw);
+        case ACTION_PARAM:
+                /* Inlined parser_param(), since this is by far the most
+                 * frequent action inside of sequences.
+                 */
+                if (G_LIKELY(parser->seq.n_args < BTE_PARSER_ARG_MAX)) {
+                        bte_seq_arg_push(&parser->seq.args[parser->seq.n_args], raw);
+                        return BTE_SEQ_NONE;
                 }
+                return parser_param(parser, raw);
+        case ACTION_FINISH_PARAM:
+                return parser_finish_param(parser, raw);
+        case ACTION_FINISH_SUBPARAM:
+                return parser_finish_subparam(parser, raw);
+        case ACTION_ESC_DISPATCH:
+                return parser_esc(parser, raw);
+        case ACTION_CSI_DISPATCH:
+                return parser_csi(parser, raw);
+        case ACTION_DCS_START:
+                return parser_dcs_start(parser, raw);
+        case ACTION_DCS_CONSUME:
+                return parser_dcs_consume(parser, raw);
+        case ACTION_DCS_COLLECT:
+                return parser_dcs_collect(parser, raw);
+        case ACTION_DCS_DISPATCH:
+                return parser_dcs(parser, raw);
+        case ACTION_OSC_START:
+                return parser_osc_start(parser, raw);
+        case ACTION_OSC_COLLECT:
+                return parser_osc_collect(parser, raw);
+        case ACTION_OSC_DISPATCH:
+                return parser_osc(parser, raw);
+        case ACTION_SCI_DISPATCH:
+                return parser_sci(parser, raw);
+        case ACTION_ESC_DEFERRED:
+                /* The ESC after a DCS or OSC string wasn't the start of
+                 * a C0 ST, so do its deferred clear, and handle @raw
+                 * in STATE_ESC which we're now in.
+                 */
+                parser_clear_int(parser, 0x1b /* ESC */);
+                return parser_feed_class(parser, raw, byte_class);
+        }
 
-                return parser_transition(parser, raw, STATE_GROUND,
-                                         ACTION_IGNORE);
-        case STATE_CSI_ENTRY:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_EXECUTE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_transition(parser, raw, STATE_CSI_INT,
-                                                 ACTION_COLLECT_CSI);
-                case 0x30 ... 0x39:        /* ['0' - '9'] */
-                        return parser_transition(parser, raw, STATE_CSI_PARAM,
-                                                 ACTION_PARAM);
-                case 0x3a:                 /* ':' */
-                        return parser_transition(parser, raw, STATE_CSI_PARAM,
-                                                 ACTION_FINISH_SUBPARAM);
-                case 0x3b:                 /* ';' */
-                        return parser_transition(parser, raw, STATE_CSI_PARAM,
-                                                 ACTION_FINISH_PARAM);
-                case 0x3c ... 0x3f:        /* ['<' - '?'] */
-                        return parser_transition(parser, raw, STATE_CSI_PARAM,
-                                                 ACTION_COLLECT_PARAMETER);
-                case 0x40 ... 0x7e:        /* ['@' - '~'] */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_CSI_DISPATCH);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
+        g_assert_not_reached();
+        return BTE_SEQ_NONE;
+}
 
-                return parser_transition_no_action(parser, raw, STATE_CSI_IGNORE);
-        case STATE_CSI_PARAM:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_EXECUTE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_transition(parser, raw, STATE_CSI_INT,
-                                                 ACTION_COLLECT_CSI);
-                case 0x30 ... 0x39:        /* ['0' - '9'] */
-                        return parser_action(parser, raw,
-                                             ACTION_PARAM);
-                case 0x3a:                 /* ':' */
-                        return parser_action(parser, raw,
-                                             ACTION_FINISH_SUBPARAM);
-                case 0x3b:                 /* ';' */
-                        return parser_action(parser, raw,
-                                             ACTION_FINISH_PARAM);
-                case 0x3c ... 0x3f:        /* ['<' - '?'] */
-                        return parser_transition_no_action(parser, raw, STATE_CSI_IGNORE);
-                case 0x40 ... 0x7e:        /* ['@' - '~'] */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_CSI_DISPATCH);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
+int
+bte_parser_feed(bte_parser_t* parser,
+                uint32_t raw)
+{
+        /* Text is by far the most common input, and in runs, so
+         * handle printable characters in the ground state first.
+         */
+        if (G_LIKELY(parser->state == STATE_GROUND &&
+                     ((raw >= 0x20 && raw < 0x7f) || raw >= 0xa0)))
+                return parser_print(parser, raw);
 
-                return parser_transition_no_action(parser, raw, STATE_CSI_IGNORE);
-        case STATE_CSI_INT:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_EXECUTE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_action(parser, raw,
-                                             ACTION_COLLECT_CSI);
-                case 0x30 ... 0x3f:        /* ['0' - '?'] */
-                        return parser_transition_no_action(parser, raw, STATE_CSI_IGNORE);
-                case 0x40 ... 0x7e:        /* ['@' - '~'] */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_CSI_DISPATCH);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
+        return parser_feed_class(parser, raw,
+                                 raw < k_parser_class_table.size() ? k_parser_class_table[raw]
+                                                                   : CLASS_GRAPHIC);
+}
 
-                return parser_transition_no_action(parser, raw, STATE_CSI_IGNORE);
-        case STATE_CSI_IGNORE:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_EXECUTE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x3f:        /* [' ' - '?'] */
-                        return parser_nop(parser, raw);
-                case 0x40 ... 0x7e:        /* ['@' - '~'] */
-                        return parser_transition_no_action(parser, raw, STATE_GROUND);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
+/* Returns the length of the run of printable ASCII, i.e. [' ' - '~'],
+ * at the start of @data.
+ */
+static size_t
+parser_printable_run(uint8_t const* data,
+                     size_t len)
+{
+        auto p = data;
+        auto const end = data + len;
 
-                return parser_nop(parser, raw);
-        case STATE_DCS_ENTRY:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ ESC */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_IGNORE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_transition(parser, raw, STATE_DCS_INT,
-                                                 ACTION_COLLECT_DCS);
-                case 0x30 ... 0x39:        /* ['0' - '9'] */
-                        return parser_transition(parser, raw, STATE_DCS_PARAM,
-                                                 ACTION_PARAM);
-                case 0x3a:                 /* ':' */
-                        return parser_transition(parser, raw, STATE_DCS_PARAM,
-                                                 ACTION_FINISH_SUBPARAM);
-                case 0x3b:                 /* ';' */
-                        return parser_transition(parser, raw, STATE_DCS_PARAM,
-                                                 ACTION_FINISH_PARAM);
-                case 0x3c ... 0x3f:        /* ['<' - '?'] */
-                        return parser_transition(parser, raw, STATE_DCS_PARAM,
-                                                 ACTION_COLLECT_PARAMETER);
-                case 0x40 ... 0x7e:        /* ['@' - '~'] */
-                        return parser_transition(parser, raw, STATE_DCS_PASS,
-                                                 ACTION_DCS_CONSUME);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
+        /* Check 8 bytes at a time: the high bit of a byte is set in the
+         * first term iff it's < ' ', and in the second one iff it's > '~'.
+         */
+        constexpr auto const ones = uint64_t{0x0101010101010101};
+        constexpr auto const highs = uint64_t{0x8080808080808080};
+        while (end - p >= 8) {
+                uint64_t v;
+                memcpy(&v, p, sizeof(v));
+                if ((((v - ones * 0x20) & ~v) | (v + ones) | v) & highs)
+                        break;
+                p += 8;
+        }
 
-                return parser_transition(parser, raw,
-                                         STATE_DCS_PASS, ACTION_DCS_CONSUME);
-        case STATE_DCS_PARAM:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_IGNORE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_transition(parser, raw, STATE_DCS_INT,
-                                                 ACTION_COLLECT_DCS);
-                case 0x30 ... 0x39:        /* ['0' - '9'] */
-                        return parser_action(parser, raw,
-                                                 ACTION_PARAM);
-                case 0x3a:                 /* ':' */
-                        return parser_action(parser, raw,
-                                             ACTION_FINISH_SUBPARAM);
-                case 0x3b:                 /* ';' */
-                        return parser_action(parser, raw,
-                                             ACTION_FINISH_PARAM);
-                case 0x3c ... 0x3f:        /* ['<' - '?'] */
-                        return parser_transition_no_action(parser, raw, STATE_DCS_IGNORE);
-                case 0x40 ... 0x7e:        /* ['@' - '~'] */
-                        return parser_transition(parser, raw, STATE_DCS_PASS,
-                                                 ACTION_DCS_CONSUME);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
+        while (p < end && *p >= 0x20 && *p < 0x7f)
+                ++p;
 
-                return parser_transition(parser, raw,
-                                         STATE_DCS_PASS, ACTION_DCS_CONSUME);
-        case STATE_DCS_INT:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* C0 \ { ESC } */
-                case 0x1c ... 0x1f:
-                        return parser_action(parser, raw,
-                                             ACTION_IGNORE);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x20 ... 0x2f:        /* [' ' - '\'] */
-                        return parser_action(parser, raw,
-                                             ACTION_COLLECT_DCS);
-                case 0x30 ... 0x3f:        /* ['0' - '?'] */
-                        return parser_transition_no_action(parser, raw, STATE_DCS_IGNORE);
-                case 0x40 ... 0x7e:        /* ['@' - '~'] */
-                        return parser_transition(parser, raw, STATE_DCS_PASS,
-                                                 ACTION_DCS_CONSUME);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_IGNORE);
-                }
+        return p - data;
+}
 
-                return parser_transition(parser, raw,
-                                         STATE_DCS_PASS, ACTION_DCS_CONSUME);
+/*
+ * bte_parser_feed_string() - Feeds the raw input following an OSC or DCS string
+ * @parser: the struct bte_parser
+ * @data: the input
+ * @len: the length of @data
+ *
+ * While an OSC or DCS string is in progress, consumes the run of printable
+ * ASCII at the start of @data, appending it to the string in bulk, or
+ * skipping it if the string is being ignored. This is the same as feeding
+ * its characters one by one, but without decoding and dispatching them.
+ *
+ * The run is cut short where the string reaches its maximum length; the
+ * next character then goes through the state machine, which ignores the
+ * string. Until then, the caller may take out what was collected with
+ * bte_parser_get_osc_string() and bte_parser_truncate_string().
+ *
+ * The caller must only call this when there is no partial UTF-8 sequence.
+ *
+ * Returns: the number of bytes consumed from @data
+ */
+size_t
+bte_parser_feed_string(bte_parser_t* parser,
+                       uint8_t const* data,
+                       size_t len)
+{
+        switch (parser->state) {
+        case STATE_OSC_STRING:
         case STATE_DCS_PASS:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* ASCII \ { ESC } */
-                case 0x1c ... 0x7f:
-                        return parser_action(parser, raw,
-                                             ACTION_DCS_COLLECT);
-                case 0x1b:                /* ESC */
-                        return parser_transition_no_action(parser, raw, STATE_DCS_PASS_ESC);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_DCS_DISPATCH);
-                }
-
-                return parser_action(parser, raw,
-                                     ACTION_DCS_COLLECT);
+                break;
         case STATE_DCS_IGNORE:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* ASCII \ { ESC } */
-                case 0x1c ... 0x7f:
-                        return parser_nop(parser, raw);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x9c:                /* ST */
-                        return parser_transition_no_action(parser, raw, STATE_GROUND);
-                }
-
-                return parser_nop(parser, raw);
-        case STATE_OSC_STRING:
-                switch (raw) {
-                case 0x00 ... 0x06:        /* C0 \ { BEL, ESC } */
-                case 0x08 ... 0x1a:
-                case 0x1c ... 0x1f:
-                        return parser_nop(parser, raw);
-                case 0x1b:                /* ESC */
-                        return parser_transition_no_action(parser, raw, STATE_OSC_STRING_ESC);
-                case 0x20 ... 0x7f:        /* [' ' - DEL] */
-                        return parser_action(parser, raw,
-                                             ACTION_OSC_COLLECT);
-                case 0x07:                /* BEL */
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_OSC_DISPATCH);
-                }
-
-                return parser_action(parser, raw,
-                                     ACTION_OSC_COLLECT);
         case STATE_ST_IGNORE:
-                switch (raw) {
-                case 0x00 ... 0x1a:        /* ASCII \ { ESC } */
-                case 0x1c ... 0x7f:
-                        return parser_nop(parser, raw);
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw, STATE_ESC,
-                                                 ACTION_CLEAR_INT);
-                case 0x9c:                /* ST */
-                        return parser_transition(parser, raw,
-                                                 STATE_GROUND, ACTION_IGNORE);
-                }
-
-                return parser_nop(parser, raw);
-        case STATE_SCI:
-                switch (raw) {
-                case 0x1b:                /* ESC */
-                        return parser_transition(parser, raw,
-                                                 STATE_ESC, ACTION_CLEAR_INT);
-                case 0x08 ... 0x0d:        /* BS, HT, LF, VT, FF, CR */
-                case 0x20 ... 0x7e:        /* [' ' - '~'] */
-                        return parser_transition(parser, raw, STATE_GROUND,
-                                                 ACTION_SCI_DISPATCH);
-                }
-
-                return parser_transition(parser, raw, STATE_GROUND,
-                                         ACTION_IGNORE);
+                return parser_printable_run(data, len);
+        default:
+                return 0;
         }
 
-        g_assert_not_reached();
-        return BTE_SEQ_NONE;
+        return bte_seq_string_append_ascii(&parser->seq.arg_str,
+                                           data,
+                                           parser_printable_run(data, len));
 }
 
-int
-bte_parser_feed(bte_parser_t* parser,
-                uint32_t raw)
+/*
+ * bte_parser_get_osc_string() - Gets the OSC string in progress
+ * @parser: the struct bte_parser
+ * @len: location to store the length of the string
+ *
+ * Returns: the string collected so far, or %nullptr if there is no OSC
+ *   string in progress
+ */
+uint32_t const*
+bte_parser_get_osc_string(bte_parser_t const* parser,
+                          size_t* len)
 {
-        /*
-         * Notes:
-         *  * DEC treats GR codes as GL. We don't do that as we require UTF-8
-         *    as charset and, thus, it doesn't make sense to treat GR special.
-         *  * During control sequences, unexpected C1 codes cancel the sequence
-         *    and immediately start a new one. C0 codes, however, may or may not
-         *    be ignored/executed depending on the sequence.
-         */
+        if (parser->state != STATE_OSC_STRING)
+                return nullptr;
 
-        switch (raw) {
-        case 0x18:                /* CAN */
-                return parser_transition(parser, raw,
-                                         STATE_GROUND, ACTION_IGNORE);
-        case 0x1a:                /* SUB */
-                return parser_transition(parser, raw,
-                                         STATE_GROUND, ACTION_EXECUTE);
-        case 0x7f:                 /* DEL */
-                return parser_nop(parser, raw);
-        case 0x80 ... 0x8f:        /* C1 \ {DCS, SOS, SCI, CSI, ST, OSC, PM, APC} */
-        case 0x91 ... 0x97:
-        case 0x99:
-                return parser_transition(parser, raw,
-                                         STATE_GROUND, ACTION_EXECUTE);
-        case 0x98:                /* SOS */
-        case 0x9e:                /* PM */
-        case 0x9f:                /* APC */
-                return parser_transition_no_action(parser, raw, STATE_ST_IGNORE);
-                // FIXMEchpe shouldn't this use ACTION_CLEAR?
-        case 0x90:                /* DCS */
-                return parser_transition(parser, raw,
-                                         STATE_DCS_ENTRY, ACTION_DCS_START);
-        case 0x9a:                /* SCI */
-                return parser_transition(parser, raw,
-                                         STATE_SCI, ACTION_CLEAR);
-        case 0x9d:                /* OSC */
-                return parser_transition(parser, raw,
-                                         STATE_OSC_STRING, ACTION_OSC_START);
-        case 0x9b:                /* CSI */
-                return parser_transition(parser, raw,
-                                         STATE_CSI_ENTRY, ACTION_CLEAR_INT_AND_PARAMS);
-        default:
-                return parser_feed_to_state(parser, raw);
-        }
+        return bte_seq_string_get(&parser->seq.arg_str, len);
+}
+
+/*
+ * bte_parser_truncate_string() - Truncates the OSC or DCS string in progress
+ * @parser: the struct bte_parser
+ * @len: the new length
+ *
+ * Drops the end of the string collected so far, so that it can be
+ * handled piecewise before the sequence is complete.
+ */
+void
+bte_parser_truncate_string(bte_parser_t* parser,
+                           size_t len)
+{
+        if (len < parser->seq.arg_str.len)
+                parser->seq.arg_str.len = len;
 }
 
 void
 bte_parser_reset(bte_parser_t* parser)
 {
-        parser_transition(parser, 0, STATE_GROUND, ACTION_IGNORE);
+        parser->state = STATE_GROUND;
+        parser_ignore(parser, 0);
 }
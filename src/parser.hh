@@ -195,6 +195,30 @@ struct bte_seq_t {
         bte_seq_arg_t args[BTE_PARSER_ARG_MAX];
         bte_seq_string_t arg_str;
         uint32_t introducer;
+        unsigned int string_id; /* changes with every OSC string */
+};
+
+/* The states of the parser, see parser.cc */
+enum parser_state_t {
+        STATE_GROUND,           /* initial state and ground */
+        STATE_DCS_PASS_ESC,     /* ESC after DCS which may be ESC \ aka C0 ST */
+        STATE_OSC_STRING_ESC,   /* ESC after OSC which may be ESC \ aka C0 ST */
+        STATE_ESC,              /* ESC sequence was started */
+        STATE_ESC_INT,          /* intermediate escape characters */
+        STATE_CSI_ENTRY,        /* starting CSI sequence */
+        STATE_CSI_PARAM,        /* CSI parameters */
+        STATE_CSI_INT,          /* intermediate CSI characters */
+        STATE_CSI_IGNORE,       /* CSI error; ignore this CSI sequence */
+        STATE_DCS_ENTRY,        /* starting DCS sequence */
+        STATE_DCS_PARAM,        /* DCS parameters */
+        STATE_DCS_INT,          /* intermediate DCS characters */
+        STATE_DCS_PASS,         /* DCS data passthrough */
+        STATE_DCS_IGNORE,       /* DCS error; ignore this DCS sequence */
+        STATE_OSC_STRING,       /* parsing OSC sequence */
+        STATE_ST_IGNORE,        /* unimplemented seq; ignore until ST */
+        STATE_SCI,              /* single character introducer sequence was started */
+
+        STATE_N,
 };
 
 struct bte_parser_t {
@@ -202,8 +226,38 @@ struct bte_parser_t {
         unsigned int state;
 };
 
+/* Returns whether an OSC or DCS string is in progress, collected or ignored,
+ * so that bte_parser_feed_string() might take some input. */
+static inline bool
+bte_parser_in_string(bte_parser_t const* parser)
+{
+        switch (parser->state) {
+        case STATE_OSC_STRING:
+        case STATE_DCS_PASS:
+        case STATE_DCS_IGNORE:
+        case STATE_ST_IGNORE:
+                return true;
+        default:
+                return false;
+        }
+}
+
+/* Returns whether an OSC string is in progress */
+static inline bool
+bte_parser_in_osc_string(bte_parser_t const* parser)
+{
+        return parser->state == STATE_OSC_STRING;
+}
+
 void bte_parser_init(bte_parser_t* parser);
 void bte_parser_deinit(bte_parser_t* parser);
 int bte_parser_feed(bte_parser_t* parser,
                     uint32_t raw);
+size_t bte_parser_feed_string(bte_parser_t* parser,
+                              uint8_t const* data,
+                              size_t len);
+uint32_t const* bte_parser_get_osc_string(bte_parser_t const* parser,
+                                          size_t* len);
+void bte_parser_truncate_string(bte_parser_t* parser,
+                                size_t len);
 void bte_parser_reset(bte_parser_t* parser);
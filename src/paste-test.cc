@@ -0,0 +1,227 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <string>
+
+#include <glib.h>
+
+#include "paste.hh"
+
+using namespace std::literals;
+using namespace bte::terminal;
+
+/* Pulls all of @paste in bits of @max_size bytes, checking that every pull
+ * makes progress. */
+static std::string
+pull_all(Paste& paste,
+         size_t max_size)
+{
+        auto converted = std::string{};
+        auto pulls = 0u;
+        while (!paste.pull(converted, max_size))
+                g_assert_cmpuint(++pulls, <, 1000000);
+        g_assert_true(paste.done());
+        return converted;
+}
+
+static void
+test_paste_convert(void)
+{
+        auto paste = Paste{"a\nb\r\tc\x01\x7f" "d\xc2\x85" "e\xc2\xa0" "f"s, false};
+        g_assert_cmpstr(pull_all(paste, 1000).c_str(), ==, "a\rb\r\tcd" "e\xc2\xa0" "f");
+}
+
+/* Pulling in small bits gives the same, without cutting characters in half */
+static void
+test_paste_window(void)
+{
+        auto text = std::string{};
+        for (auto i = 0; i < 1000; ++i)
+                text.append("x\xc3\xa9\xe4\xb8\x80\xf0\x9f\x98\x80\n\xc2\x9b");
+
+        auto expected = std::string{};
+        for (auto i = 0; i < 1000; ++i)
+                expected.append("x\xc3\xa9\xe4\xb8\x80\xf0\x9f\x98\x80\r");
+
+        for (auto max_size : {1u, 2u, 3u, 5u, 7u, 64u, 4096u}) {
+                auto paste = Paste{std::string{text}, false};
+                auto converted = std::string{};
+                while (!paste.pull(converted, max_size)) {
+                        g_assert_true(g_utf8_validate(converted.data(), converted.size(), nullptr));
+                }
+                g_assert_true(converted == expected);
+        }
+}
+
+/* A window of only continuation bytes must not stall the paste */
+static void
+test_paste_continuation_bytes(void)
+{
+        auto text = std::string(3 * BTE_PASTE_PULL_SIZE + 17, '\x80');
+        text.append("end");
+        auto paste = Paste{std::move(text), false};
+        auto const converted = pull_all(paste, BTE_PASTE_PULL_SIZE);
+        g_assert_cmpuint(converted.size(), ==, 3 * BTE_PASTE_PULL_SIZE + 17 + 3);
+}
+
+static void
+test_paste_bracketed(void)
+{
+        auto paste = Paste{"abc\ndef"s, true};
+        g_assert_cmpstr(pull_all(paste, 2).c_str(), ==, "abc\rdef\e[201~");
+
+        auto empty = Paste{""s, true};
+        g_assert_cmpstr(pull_all(empty, 2).c_str(), ==, "\e[201~");
+}
+
+/* Cancelling a paste half way through still closes the bracket */
+static void
+test_paste_cancel(void)
+{
+        auto paste = Paste{std::string(1000, 'a'), true};
+        auto converted = std::string{};
+        g_assert_false(paste.pull(converted, 100));
+        g_assert_cmpuint(converted.size(), ==, 100);
+        g_assert_true(paste.cancel() == "\e[201~"sv);
+        g_assert_true(paste.done());
+
+        auto unbracketed = Paste{std::string(1000, 'a'), false};
+        g_assert_false(unbracketed.pull(converted, 100));
+        g_assert_true(unbracketed.cancel().empty());
+        g_assert_true(unbracketed.done());
+}
+
+/* Pulls everything from @queue, as "T:" or "B:" followed by the data of
+ * each pull, one per line. */
+static std::string
+pull_queue(PasteQueue& queue,
+           size_t max_size)
+{
+        auto result = std::string{};
+        auto pulls = 0u;
+        while (!queue.empty()) {
+                g_assert_cmpuint(++pulls, <, 1000000);
+                auto data = std::string{};
+                auto const output = queue.pull(data, max_size);
+                g_assert_true(output != PasteQueue::Output::eNone);
+                result.append(output == PasteQueue::Output::eBinary ? "B:" : "T:");
+                result.append(data);
+                result.push_back('|');
+        }
+        auto data = std::string{};
+        g_assert_true(queue.pull(data, max_size) == PasteQueue::Output::eNone);
+        g_assert_true(data.empty());
+        return result;
+}
+
+/* Input sent during a paste, and further pastes, come after it in order */
+static void
+test_paste_queue_order(void)
+{
+        auto queue = PasteQueue{};
+        g_assert_true(queue.empty());
+        queue.paste("ab\ncd"s, true);
+        queue.push(PasteQueue::Output::eText, "x"sv);
+        queue.push(PasteQueue::Output::eBinary, "\x01\n"sv);
+        queue.paste("e\nf"s, false);
+        g_assert_false(queue.empty());
+
+        g_assert_cmpstr(pull_queue(queue, 3).c_str(), ==,
+                        "T:\e[200~|T:ab\r|T:cd\e[201~|T:x|B:\x01\n|T:e\rf|");
+}
+
+/* Input sent during a large paste doesn't make all of it pulled at once */
+static void
+test_paste_queue_bounded(void)
+{
+        auto const size = size_t{64} * 1024 * 1024;
+        auto const max_size = size_t{4096};
+        auto queue = PasteQueue{};
+        queue.paste(std::string(size, 'a'), true);
+
+        auto data = std::string{};
+        g_assert_true(queue.pull(data, max_size) == PasteQueue::Output::eText);
+        g_assert_true(data == "\e[200~"sv);
+
+        auto pasted = size_t{0};
+        auto n_pushed = 0u;
+        while (pasted < size) {
+                /* A keystroke every now and then */
+                if (pasted % (1024 * 1024) == 0) {
+                        queue.push(PasteQueue::Output::eText, "k"sv);
+                        ++n_pushed;
+                }
+
+                data.clear();
+                g_assert_true(queue.pull(data, max_size) == PasteQueue::Output::eText);
+                g_assert_cmpuint(data.size(), <=, max_size + 6);
+                g_assert_cmpuint(data.size(), >, 0);
+                g_assert_cmpint(data[0], ==, 'a');
+                pasted += std::min(data.size(), max_size);
+        }
+        g_assert_cmpuint(pasted, ==, size);
+        g_assert_true(data.size() >= 6 && data.compare(data.size() - 6, 6, "\e[201~") == 0);
+
+        for (auto i = 0u; i < n_pushed; ++i) {
+                data.clear();
+                g_assert_true(queue.pull(data, max_size) == PasteQueue::Output::eText);
+                g_assert_true(data == "k"sv);
+        }
+        g_assert_true(queue.empty());
+}
+
+/* Cancelling drops the input behind the paste, and closes its bracket */
+static void
+test_paste_queue_cancel(void)
+{
+        auto queue = PasteQueue{};
+        queue.paste(std::string(1000, 'a'), true);
+        queue.push(PasteQueue::Output::eText, "x"sv);
+        auto data = std::string{};
+        queue.pull(data, 100);
+        queue.pull(data, 100);
+        g_assert_cmpuint(data.size(), ==, 6 + 100);
+        g_assert_true(queue.cancel() == "\e[201~"sv);
+        g_assert_true(queue.empty());
+
+        /* Nothing to close before the opening bracket went out */
+        queue.paste(std::string(1000, 'a'), true);
+        queue.push(PasteQueue::Output::eText, "x"sv);
+        g_assert_true(queue.cancel().empty());
+        g_assert_true(queue.empty());
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/paste/convert", test_paste_convert);
+        g_test_add_func("/bte/paste/window", test_paste_window);
+        g_test_add_func("/bte/paste/continuation-bytes", test_paste_continuation_bytes);
+        g_test_add_func("/bte/paste/bracketed", test_paste_bracketed);
+        g_test_add_func("/bte/paste/cancel", test_paste_cancel);
+        g_test_add_func("/bte/paste/queue/order", test_paste_queue_order);
+        g_test_add_func("/bte/paste/queue/bounded", test_paste_queue_bounded);
+        g_test_add_func("/bte/paste/queue/cancel", test_paste_queue_cancel);
+
+        return g_test_run();
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "btedefines.hh"
+
+namespace bte {
+
+namespace terminal {
+
+/* A paste in progress. Its text is converted and queued for output bit by
+ * bit, as the child consumes the data before it. The opening bracket of a
+ * bracketed paste is the caller's business (see PasteQueue), the closing
+ * one comes with the last bit of the text. */
+class Paste {
+public:
+        Paste(std::string&& text,
+              bool bracketed)
+                : m_text{std::move(text)},
+                  m_bracketed{bracketed}
+        {
+        }
+
+        /* Convert the next @max_size bytes or so of the text, appending them
+         * to @converted. Returns whether the paste is done.
+         *
+         * Convert newlines to carriage returns, which more software
+         * is able to cope with (cough, pico, cough).
+         * Filter out control chars except HT, CR (even stricter than xterm).
+         * Also filter out C1 controls: U+0080 (0xC2 0x80) - U+009F (0xC2 0x9F).
+         */
+        bool pull(std::string& converted,
+                  size_t max_size = BTE_PASTE_PULL_SIZE)
+        {
+                auto const data = m_text.data();
+                auto const size = m_text.size();
+
+                auto text = data + m_offset;
+                auto const window_end = data + std::min(size, m_offset + max_size);
+                auto end = window_end;
+                /* Don't cut a character in half. */
+                while (end > text && end < data + size && (*end & 0xc0) == 0x80)
+                        end--;
+                /* But make progress, with a character longer than the window,
+                 * or a window of nothing but stray continuation bytes. */
+                if (end == text && text < data + size) {
+                        if ((*text & 0xc0) == 0x80) {
+                                end = window_end;
+                        } else {
+                                end = text + 1;
+                                while (end < data + size && end < text + 4 && (*end & 0xc0) == 0x80)
+                                        end++;
+                        }
+                }
+
+                converted.reserve(converted.size() + (end - text));
+                while (text < end) {
+                        auto run = text;
+                        while (run < end) {
+                                auto const c = (unsigned char)*run;
+                                if ((c < 0x20 && c != '\t' && c != '\r') || c == 0x7f || c == 0xc2)
+                                        break;
+                                run++;
+                        }
+                        converted.append(text, run - text);
+                        text = run;
+                        if (text == end)
+                                break;
+
+                        switch (text[0]) {
+                        case '\x0A':
+                                converted.push_back('\x0D');
+                                text++;
+                                break;
+                        case '\xC2': {
+                                auto const c = text + 1 < end ? (unsigned char)text[1] : 0;
+                                if (c >= 0x80 && c <= 0x9F) {
+                                        /* Skip both bytes of a C1 */
+                                        text += 2;
+                                } else {
+                                        /* Move along, nothing to see here */
+                                        converted.push_back('\xC2');
+                                        text++;
+                                }
+                                break;
+                        }
+                        default:
+                                /* Swallow this byte */
+                                text++;
+                                break;
+                        }
+                }
+
+                m_offset = end - data;
+                if (!done())
+                        return false;
+
+                if (m_bracketed)
+                        converted.append(closing_bracket());
+                return true;
+        }
+
+        /* Drop the rest of the text. Returns what still needs to be sent to
+         * the child: the opening bracket might have reached it already, and
+         * it would otherwise wait for the end of the paste forever. */
+        std::string_view cancel() noexcept
+        {
+                m_offset = m_text.size();
+                return m_bracketed ? closing_bracket() : std::string_view{};
+        }
+
+        inline bool done() const noexcept { return m_offset == m_text.size(); }
+
+        static constexpr std::string_view opening_bracket() noexcept { return "\e[200~"; }
+
+private:
+        std::string m_text;
+        size_t m_offset{0};
+        bool m_bracketed{false};
+
+        // FIXMEchpe can we not hardcode C0 controls here?
+        static constexpr std::string_view closing_bracket() noexcept { return "\e[201~"; }
+};
+
+/* The output for the child from a paste in progress on: the paste, then
+ * whatever else is sent to the child meanwhile, including further pastes,
+ * in order. Only the paste in progress is converted bit by bit; the other
+ * input is already held by the caller anyway, and is queued as it is. */
+class PasteQueue {
+public:
+        enum class Output {
+                eNone,
+                eText,   /* UTF-8 text for the child */
+                eBinary, /* data to send as it is */
+        };
+
+        /* Whether there is nothing queued; then other input can go to the
+         * child directly. */
+        inline bool empty() const noexcept { return !m_paste && m_queue.empty(); }
+
+        /* Queue a paste of @text, preceded by the opening bracket if
+         * @bracketed. */
+        void paste(std::string&& text,
+                   bool bracketed)
+        {
+                m_queue.push_back(Item{Output::eText, std::move(text), true, bracketed});
+        }
+
+        /* Queue @data behind the pastes */
+        void push(Output output,
+                  std::string_view const& data)
+        {
+                m_queue.push_back(Item{output, std::string{data}, false, false});
+        }
+
+        /* Take the next bit of output, appending it to @data: up to
+         * @max_size bytes or so of the paste in progress (see
+         * Paste::pull()), or the next other input as a whole. Returns
+         * how to send @data, or Output::eNone if there is nothing left. */
+        Output pull(std::string& data,
+                    size_t max_size = BTE_PASTE_PULL_SIZE)
+        {
+                if (!m_paste) {
+                        if (m_queue.empty())
+                                return Output::eNone;
+
+                        auto item = std::move(m_queue.front());
+                        m_queue.pop_front();
+                        if (!item.paste) {
+                                data.append(item.data);
+                                return item.output;
+                        }
+
+                        /* Opening the bracket starts the paste, so that
+                         * cancel() closes it. */
+                        m_paste.emplace(std::move(item.data), item.bracketed);
+                        if (item.bracketed) {
+                                data.append(Paste::opening_bracket());
+                                return Output::eText;
+                        }
+                }
+
+                if (m_paste->pull(data, max_size))
+                        m_paste.reset();
+                return Output::eText;
+        }
+
+        /* Drop everything. Returns what still needs to be sent to the child,
+         * see Paste::cancel(). */
+        std::string_view cancel() noexcept
+        {
+                m_queue.clear();
+                if (!m_paste)
+                        return {};
+
+                auto const rest = m_paste->cancel();
+                m_paste.reset();
+                return rest;
+        }
+
+private:
+        struct Item {
+                Output output;
+                std::string data;
+                bool paste;     /* whether @data is to be pasted */
+                bool bracketed;
+        };
+
+        std::optional<Paste> m_paste;
+        std::deque<Item> m_queue;
+};
+
+} // namespace terminal
+
+} // namespace bte
@@ -21,6 +21,16 @@
 #include "debug.h"
 #include "reaper.hh"
 
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <glib-unix.h>
+
 struct _BteReaper {
         GObject parent_instance;
 };
@@ -54,6 +64,141 @@ bte_reaper_child_watch_cb(GPid pid,
         g_spawn_close_pid (pid);
 }
 
+#if defined(__linux__) && defined(SYS_pidfd_open)
+
+/* P_PIDFD is only in newer libc headers */
+#define BTE_P_PIDFD (idtype_t(3))
+
+#ifndef W_EXITCODE
+#define W_EXITCODE(ret, sig) ((ret) << 8 | (sig))
+#endif
+
+struct BtePidfdWatch {
+        GPid pid;
+        int pidfd;
+        BteReaper* reaper;
+};
+
+static void
+bte_reaper_pidfd_watch_free(gpointer data)
+{
+        auto watch = reinterpret_cast<BtePidfdWatch*>(data);
+        close(watch->pidfd);
+        g_object_unref(watch->reaper);
+        g_free(watch);
+}
+
+/* Converts the waitid() result into a waitpid() status */
+static int
+status_from_siginfo(siginfo_t const* info)
+{
+        switch (info->si_code) {
+        case CLD_EXITED:
+                return (info->si_status & 0xff) << 8;
+        case CLD_KILLED:
+                return info->si_status & 0x7f;
+        case CLD_DUMPED:
+                return (info->si_status & 0x7f) | 0x80;
+        default:
+                return 0;
+        }
+}
+
+static gboolean
+bte_reaper_pidfd_watch_cb(int fd,
+                          GIOCondition condition,
+                          gpointer data)
+{
+        auto watch = reinterpret_cast<BtePidfdWatch*>(data);
+
+        siginfo_t info;
+        info.si_pid = 0;
+        auto r = int{};
+        do {
+                r = waitid(BTE_P_PIDFD, id_t(fd), &info, WEXITED | WNOHANG);
+        } while (r == -1 && errno == EINTR);
+
+        auto status = int{0};
+        if (r == 0) {
+                /* Spurious wakeup; the process has not exited yet */
+                if (info.si_pid == 0)
+                        return G_SOURCE_CONTINUE;
+
+                status = status_from_siginfo(&info);
+        } else {
+                _bte_debug_print(BTE_DEBUG_SIGNALS,
+                                 "waitid(P_PIDFD) for %d failed: %s\n",
+                                 int(watch->pid), g_strerror(errno));
+
+                /* Try the PID itself. If that fails too, somebody else
+                 * reaped the child; like glib, report that as a failure
+                 * rather than as a successful exit. */
+                do {
+                        r = waitpid(watch->pid, &status, WNOHANG);
+                } while (r == -1 && errno == EINTR);
+                if (r != watch->pid)
+                        status = W_EXITCODE(255, 0);
+        }
+
+        bte_reaper_child_watch_cb(watch->pid, status, watch->reaper);
+        return G_SOURCE_REMOVE;
+}
+
+/* Watches @pid using a pidfd, which avoids glib's SIGCHLD handling and
+ * its waitpid() polling of all the watched children. Returns false if
+ * the running kernel does not support pidfds (Linux 5.4).
+ */
+static bool
+bte_reaper_add_child_pidfd(GPid pid)
+{
+        static bool pidfd_unsupported = false;
+        if (pidfd_unsupported)
+                return false;
+
+        auto const pidfd = int(syscall(SYS_pidfd_open, pid, 0));
+        if (pidfd == -1) {
+                auto const errsv = errno;
+                _bte_debug_print(BTE_DEBUG_SIGNALS,
+                                 "pidfd_open(%d) failed: %s\n",
+                                 int(pid), g_strerror(errsv));
+                if (errsv == ENOSYS)
+                        pidfd_unsupported = true;
+                return false;
+        }
+
+        /* Check that waitid(P_PIDFD), which came one release after
+         * pidfd_open(), works too.
+         */
+        siginfo_t info;
+        info.si_pid = 0;
+        if (waitid(BTE_P_PIDFD, id_t(pidfd), &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
+                auto const errsv = errno;
+                _bte_debug_print(BTE_DEBUG_SIGNALS,
+                                 "waitid(P_PIDFD) failed: %s\n",
+                                 g_strerror(errsv));
+                if (errsv == EINVAL)
+                        pidfd_unsupported = true;
+                close(pidfd);
+                return false;
+        }
+
+        /* pidfds are always O_CLOEXEC */
+        auto watch = g_new(BtePidfdWatch, 1);
+        watch->pid = pid;
+        watch->pidfd = pidfd;
+        watch->reaper = bte_reaper_ref();
+
+        g_unix_fd_add_full(G_PRIORITY_LOW,
+                           pidfd,
+                           G_IO_IN,
+                           bte_reaper_pidfd_watch_cb,
+                           watch,
+                           bte_reaper_pidfd_watch_free);
+        return true;
+}
+
+#endif /* __linux__ && SYS_pidfd_open */
+
 /*
  * bte_reaper_add_child:
  * @pid: the ID of a child process which will be monitored
@@ -63,6 +208,11 @@ bte_reaper_child_watch_cb(GPid pid,
 void
 bte_reaper_add_child(GPid pid)
 {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+        if (bte_reaper_add_child_pidfd(pid))
+                return;
+#endif
+
         g_child_watch_add_full(G_PRIORITY_LOW,
                                pid,
                                bte_reaper_child_watch_cb,
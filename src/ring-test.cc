@@ -0,0 +1,694 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "ring.hh"
+
+using namespace bte::base;
+
+/* A small deterministic generator, so that all rings get the same contents */
+class Lcg {
+public:
+        explicit Lcg(uint32_t seed) : m_state{seed} { }
+
+        uint32_t next(uint32_t n)
+        {
+                m_state = m_state * 1103515245u + 12345u;
+                return (m_state >> 8) % n;
+        }
+
+private:
+        uint32_t m_state;
+};
+
+/* Appends a paragraph of @len characters, of ASCII only if @kind is 0,
+ * otherwise of ASCII, non-ASCII and wide ones, with some attribute changes,
+ * soft wrapped at @columns. */
+static void
+append_paragraph(Ring& ring,
+                 Lcg& lcg,
+                 unsigned len,
+                 unsigned kind,
+                 Ring::column_t columns)
+{
+        auto row = ring.append(0);
+        auto col = Ring::column_t{0};
+        auto cell = basic_cell;
+        for (auto i = 0u; i < len; ++i) {
+                auto width = 1;
+                if (kind == 0 || lcg.next(8) != 0) {
+                        cell.c = 'a' + lcg.next(26);
+                } else if (lcg.next(2)) {
+                        cell.c = 0xe0 + lcg.next(0x20);
+                } else {
+                        cell.c = 0x4e00 + lcg.next(0x100);
+                        width = 2;
+                }
+                if (lcg.next(40) == 0)
+                        cell.attr.set_bold(!cell.attr.bold());
+
+                if (col + width > columns) {
+                        row->attr.soft_wrapped = 1;
+                        row = ring.append(0);
+                        col = 0;
+                }
+                cell.attr.set_columns(width);
+                for (auto j = 0; j < width; ++j) {
+                        cell.attr.set_fragment(j != 0);
+                        _bte_row_data_append(row, &cell);
+                }
+                col += width;
+        }
+}
+
+/* Appends @n_paragraphs paragraphs of up to 3 rows, soft wrapped at @columns. */
+static void
+fill_ring(Ring& ring,
+          unsigned n_paragraphs,
+          Ring::column_t columns,
+          uint32_t seed = 1)
+{
+        auto lcg = Lcg{seed};
+        for (auto p = 0u; p < n_paragraphs; ++p) {
+                auto const len = lcg.next(4) == 0 ? 0 : lcg.next(3 * columns);
+                append_paragraph(ring, lcg, len, lcg.next(4), columns);
+        }
+}
+
+/* Returns the text of @row, with a '+' for a soft wrap and a '*' for every
+ * bold character. */
+static std::string
+row_text(Ring& ring,
+         Ring::row_t position)
+{
+        auto const row = ring.index(position);
+        auto text = std::string{};
+        for (auto i = 0; i < row->len; ++i) {
+                auto const& cell = row->cells[i];
+                if (cell.attr.fragment())
+                        continue;
+                char buf[8];
+                text.append(buf, g_unichar_to_utf8(cell.c, buf));
+                if (cell.attr.bold())
+                        text.push_back('*');
+        }
+        text.push_back(row->attr.soft_wrapped ? '+' : '\n');
+        return text;
+}
+
+static void
+assert_rings_equal(Ring& a,
+                   Ring& b)
+{
+        g_assert_cmpuint(a.delta(), ==, b.delta());
+        g_assert_cmpuint(a.next(), ==, b.next());
+        for (auto row = a.delta(); row < a.next(); ++row)
+                g_assert_cmpstr(row_text(a, row).c_str(), ==, row_text(b, row).c_str());
+}
+
+/* Markers spread over the ring, as 0-terminated array for rewrap() */
+class Markers {
+public:
+        Markers(Ring& ring,
+                Ring::column_t columns)
+        {
+                auto lcg = Lcg{42};
+                for (auto& position : m_positions) {
+                        position.row = ring.delta() + lcg.next(ring.length());
+                        position.col = lcg.next(columns);
+                }
+                for (auto i = 0u; i < G_N_ELEMENTS(m_positions); ++i)
+                        m_markers[i] = &m_positions[i];
+                m_markers[G_N_ELEMENTS(m_positions)] = nullptr;
+        }
+
+        auto get() noexcept { return m_markers; }
+        auto const& operator[](size_t i) const noexcept { return m_positions[i]; }
+        static constexpr size_t size() noexcept { return 8; }
+
+private:
+        BteVisualPosition m_positions[8];
+        BteVisualPosition* m_markers[9];
+};
+
+static void
+test_ring_rewrap_lazy_params(Ring::column_t old_columns,
+                             Ring::column_t new_columns,
+                             double from)
+{
+        auto full = Ring{100000, true};
+        auto lazy = Ring{100000, true};
+        fill_ring(full, 2000, old_columns);
+        fill_ring(lazy, 2000, old_columns);
+        assert_rings_equal(full, lazy);
+
+        auto full_markers = Markers{full, old_columns};
+        auto lazy_markers = Markers{lazy, old_columns};
+
+        full.rewrap(new_columns, full_markers.get());
+
+        lazy.rewrap_from(new_columns, lazy.delta() + Ring::row_t(lazy.length() * from), lazy_markers.get());
+        g_assert_true(lazy.rewrap_pending());
+        while (lazy.rewrap_step(100))
+                ;
+        lazy.rewrap_commit(lazy_markers.get());
+        g_assert_false(lazy.rewrap_pending());
+
+        assert_rings_equal(full, lazy);
+        for (auto i = 0u; i < Markers::size(); ++i) {
+                g_assert_cmpint(full_markers[i].row, ==, lazy_markers[i].row);
+                g_assert_cmpint(full_markers[i].col, ==, lazy_markers[i].col);
+        }
+}
+
+static void
+test_ring_rewrap_lazy(void)
+{
+        test_ring_rewrap_lazy_params(80, 50, 0.9);
+        test_ring_rewrap_lazy_params(80, 50, 0.3);
+        test_ring_rewrap_lazy_params(50, 80, 0.9);
+        test_ring_rewrap_lazy_params(80, 133, 0.5);
+}
+
+/* Committing before the background rewrap is done finishes it */
+static void
+test_ring_rewrap_lazy_commit_early(void)
+{
+        auto full = Ring{100000, true};
+        auto lazy = Ring{100000, true};
+        fill_ring(full, 2000, 80);
+        fill_ring(lazy, 2000, 80);
+
+        auto full_markers = Markers{full, 80};
+        auto lazy_markers = Markers{lazy, 80};
+
+        full.rewrap(37, full_markers.get());
+        lazy.rewrap_from(37, lazy.next() - 50, lazy_markers.get());
+        lazy.rewrap_step(10);
+        lazy.rewrap_commit(lazy_markers.get());
+
+        assert_rings_equal(full, lazy);
+        for (auto i = 0u; i < Markers::size(); ++i) {
+                g_assert_cmpint(full_markers[i].row, ==, lazy_markers[i].row);
+                g_assert_cmpint(full_markers[i].col, ==, lazy_markers[i].col);
+        }
+}
+
+/* Paragraphs larger than a rewrap chunk, one of ASCII only, get split
+ * over several chunks */
+static void
+fill_ring_long_paragraphs(Ring& ring,
+                          Ring::column_t columns)
+{
+        auto lcg = Lcg{7};
+        append_paragraph(ring, lcg, 100, 1, columns);
+        append_paragraph(ring, lcg, 5 * BTE_REWRAP_CHUNK_SIZE / 2, 1, columns);
+        append_paragraph(ring, lcg, 3 * BTE_REWRAP_CHUNK_SIZE, 0, columns);
+        append_paragraph(ring, lcg, 10, 1, columns);
+}
+
+static void
+test_ring_rewrap_long_paragraph(void)
+{
+        auto expected = Ring{200000, true};
+        fill_ring_long_paragraphs(expected, 61);
+
+        auto full = Ring{200000, true};
+        fill_ring_long_paragraphs(full, 80);
+        auto full_markers = Markers{full, 80};
+        full.rewrap(61, full_markers.get());
+        assert_rings_equal(expected, full);
+
+        auto lazy = Ring{200000, true};
+        fill_ring_long_paragraphs(lazy, 80);
+        auto lazy_markers = Markers{lazy, 80};
+        lazy.rewrap_from(61, lazy.delta() + lazy.length() / 2, lazy_markers.get());
+        while (lazy.rewrap_step(1000))
+                ;
+        lazy.rewrap_commit(lazy_markers.get());
+        assert_rings_equal(expected, lazy);
+
+        for (auto i = 0u; i < Markers::size(); ++i) {
+                g_assert_cmpint(full_markers[i].row, ==, lazy_markers[i].row);
+                g_assert_cmpint(full_markers[i].col, ==, lazy_markers[i].col);
+        }
+}
+
+/* Returns the text from @position to the end of @ring, without the soft wraps */
+static std::string
+ring_text(Ring& ring,
+          Ring::row_t position)
+{
+        auto text = std::string{};
+        for (auto row = position; row < ring.next(); ++row)
+                text += row_text(ring, row);
+        text.erase(std::remove(text.begin(), text.end(), '+'), text.end());
+        return text;
+}
+
+static void
+test_ring_evict_params(Ring& reference,
+                       std::vector<size_t> const& released,
+                       Ring::row_t position)
+{
+        auto const n_rows = position - reference.delta();
+        auto const expected_text = ring_text(reference, position);
+
+        /* Exactly the bytes in front of @position, and the ones that are
+         * just over the previous row's or just short of its own.
+         */
+        size_t const sizes[] = {released[n_rows], released[n_rows - 1] + 1, released[n_rows] - 1};
+        for (auto bytes : sizes) {
+                auto ring = Ring{100000, true};
+                fill_ring(ring, 2000, 80);
+
+                g_assert_cmpuint(ring.evict(bytes), ==, released[n_rows]);
+                g_assert_cmpuint(ring.delta(), ==, position);
+                g_assert_cmpuint(ring.next(), ==, reference.next());
+                for (auto row = position; row < ring.next(); ++row)
+                        g_assert_cmpstr(row_text(ring, row).c_str(), ==, row_text(reference, row).c_str());
+
+                /* A paragraph cut by the eviction starts at the new first
+                 * row, and nothing evicted comes back with it.
+                 */
+                auto markers = Markers{ring, 80};
+                ring.rewrap(50, markers.get());
+                g_assert_cmpstr(ring_text(ring, ring.delta()).c_str(), ==, expected_text.c_str());
+        }
+}
+
+static void
+test_ring_evict(void)
+{
+        auto reference = Ring{100000, true};
+        fill_ring(reference, 2000, 80);
+        auto const start = reference.delta();
+        auto const end = start + reference.length() / 2;
+
+        /* The bytes released by evicting the first n rows, one at a time */
+        auto released = std::vector<size_t>{0};
+        {
+                auto ring = Ring{100000, true};
+                fill_ring(ring, 2000, 80);
+                for (auto row = start; row < end; ++row) {
+                        auto const bytes = ring.evict(1);
+                        g_assert_cmpuint(bytes, >, 0);
+                        g_assert_cmpuint(ring.delta(), ==, row + 1);
+                        released.push_back(released.back() + bytes);
+                }
+        }
+
+        /* The first row of a paragraph, its last row, and one in its middle */
+        auto at = Ring::row_t{0}, before = Ring::row_t{0}, inside = Ring::row_t{0};
+        for (auto row = start + 10; row < end; ++row) {
+                auto const continued = reference.is_soft_wrapped(row - 1);
+                auto const continues = reference.is_soft_wrapped(row);
+                if (!at && !continued && continues)
+                        at = row;
+                else if (!before && continued && !continues)
+                        before = row;
+                else if (!inside && continued && continues)
+                        inside = row;
+        }
+        g_assert_cmpuint(at, !=, 0);
+        g_assert_cmpuint(before, !=, 0);
+        g_assert_cmpuint(inside, !=, 0);
+
+        test_ring_evict_params(reference, released, at);
+        test_ring_evict_params(reference, released, before);
+        test_ring_evict_params(reference, released, inside);
+
+        /* More than there is drops all the frozen rows, but no others */
+        auto ring = Ring{100000, true};
+        fill_ring(ring, 2000, 80);
+        g_assert_cmpuint(ring.evict(G_MAXSIZE), >=, released.back());
+        g_assert_cmpuint(ring.delta(), >, end);
+        g_assert_cmpuint(ring.delta(), <, ring.next());
+        g_assert_cmpuint(ring.evict(G_MAXSIZE), ==, 0);
+        for (auto row = ring.delta(); row < ring.next(); ++row)
+                g_assert_cmpstr(row_text(ring, row).c_str(), ==, row_text(reference, row).c_str());
+}
+
+/* Appends @len random cells to @row. Most rows are uniform, of ASCII, of
+ * characters at the UTF-8 length boundaries, or of any BMP characters;
+ * the others have one wide, combining or non-BMP character, or one cell in
+ * a different attr, somewhere.
+ */
+static void
+random_row(BteRowData* row,
+           Lcg& lcg)
+{
+        auto const len = lcg.next(120);
+        auto const kind = lcg.next(8);
+        auto const odd = len ? lcg.next(len) : 0;
+
+        auto cell = basic_cell;
+        if (lcg.next(4) == 0)
+                cell.attr.set_fore(lcg.next(256));
+        if (lcg.next(4) == 0)
+                cell.attr.set_bold(true);
+
+        static gunichar const boundaries[] = {0, 0x1f, 0x20, 0x7e, 0x7f, 0x80, 0x7ff, 0x800, 0xfffd, 0xffff};
+        for (auto i = 0u; i < len; ++i) {
+                auto odd_cell = cell;
+                if (kind <= 2)
+                        odd_cell.c = 32 + lcg.next(95);
+                else if (kind == 3)
+                        odd_cell.c = boundaries[lcg.next(G_N_ELEMENTS(boundaries))];
+                else
+                        odd_cell.c = lcg.next(0x10000);
+
+                if (i == odd && kind == 4) {
+                        odd_cell.c = 0x10000 + lcg.next(0x100000);
+                } else if (i == odd && kind == 5) {
+                        odd_cell.c = _bte_unistr_append_unichar('e', 0x301);
+                } else if (i == odd && kind == 6) {
+                        odd_cell.attr.set_bold(!cell.attr.bold());
+                } else if (i == odd && kind == 7) {
+                        odd_cell.c = 0x4e00 + lcg.next(0x100);
+                        odd_cell.attr.set_columns(2);
+                        _bte_row_data_append(row, &odd_cell);
+                        odd_cell.attr.set_fragment(true);
+                }
+                _bte_row_data_append(row, &odd_cell);
+        }
+}
+
+/* The fast path of freeze_row() has to agree with the per-cell one,
+ * which uses _bte_unistr_append_to_string().
+ */
+static void
+test_ring_freeze_fast_path(void)
+{
+        auto const n_rows = 200000u;
+        auto lcg = Lcg{3};
+        auto row = BteRowData{};
+        _bte_row_data_init(&row);
+        auto expected = g_string_new(nullptr);
+        auto text = g_string_new(nullptr);
+        auto n_uniform = 0u;
+
+        for (auto i = 0u; i < n_rows; ++i) {
+                _bte_row_data_clear(&row);
+                random_row(&row, lcg);
+                if (row.len == 0)
+                        continue;
+
+                auto uniform = !row.cells[0].attr.fragment();
+                auto ascii = true;
+                g_string_truncate(expected, 0);
+                for (auto j = 0; j < row.len; ++j) {
+                        auto const& cell = row.cells[j];
+                        uniform &= memcmp(&cell.attr, &row.cells[0].attr, sizeof(cell.attr)) == 0 &&
+                                cell.c < 0x10000;
+                        ascii &= cell.c >= 32 && cell.c <= 126;
+                        _bte_unistr_append_to_string(cell.c, expected);
+                }
+
+                auto is_ascii = false;
+                g_assert_cmpint(_bte_row_data_is_uniform(&row, &is_ascii), ==, uniform);
+                if (!uniform)
+                        continue;
+
+                ++n_uniform;
+                g_assert_cmpint(is_ascii, ==, ascii);
+                g_string_assign(text, "x");
+                _bte_row_data_append_utf8(&row, is_ascii, text);
+                g_assert_cmpuint(text->len, ==, expected->len + 1);
+                g_assert_true(memcmp(text->str + 1, expected->str, expected->len) == 0);
+        }
+        g_assert_cmpuint(n_uniform, >, n_rows / 3);
+        g_assert_cmpuint(n_uniform, <, n_rows);
+
+        /* Both paths through the ring and back */
+        auto ring = Ring{n_rows, true};
+        lcg = Lcg{3};
+        for (auto i = 0u; i < n_rows; ++i) {
+                _bte_row_data_clear(&row);
+                random_row(&row, lcg);
+                _bte_row_data_copy(&row, ring.append(0));
+        }
+
+        lcg = Lcg{3};
+        for (auto i = 0u; i < n_rows; ++i) {
+                _bte_row_data_clear(&row);
+                random_row(&row, lcg);
+                auto const thawed = ring.index(ring.delta() + i);
+                g_assert_cmpuint(thawed->len, ==, row.len);
+                for (auto j = 0; j < row.len; ++j) {
+                        /* Frozen fragments are thawed with a single column */
+                        auto cell = row.cells[j], thawed_cell = thawed->cells[j];
+                        if (cell.attr.fragment()) {
+                                cell.attr.set_columns(1);
+                                thawed_cell.attr.set_columns(1);
+                        }
+                        g_assert_cmphex(thawed_cell.c, ==, cell.c);
+                        g_assert_true(memcmp(&thawed_cell.attr, &cell.attr, BTE_CELL_ATTR_COMMON_BYTES) == 0);
+                }
+        }
+
+        g_string_free(text, true);
+        g_string_free(expected, true);
+        _bte_row_data_fini(&row);
+}
+
+/* Removes the files in the session directory @dir, and @dir itself */
+static void
+remove_session_dir(char const* dir)
+{
+        auto const gdir = g_dir_open(dir, 0, nullptr);
+        g_assert_nonnull(gdir);
+        char const* name;
+        while ((name = g_dir_read_name(gdir)) != nullptr) {
+                auto const path = g_build_filename(dir, name, nullptr);
+                g_unlink(path);
+                g_free(path);
+        }
+        g_dir_close(gdir);
+        g_assert_cmpint(g_rmdir(dir), ==, 0);
+}
+
+/* A saved session is restored by the next ring attaching to the directory */
+static void
+test_ring_session_round_trip(void)
+{
+        auto const dir = g_dir_make_tmp("bte-ring-test-XXXXXX", nullptr);
+        g_assert_nonnull(dir);
+        auto expected = Ring{100000, true};
+        fill_ring(expected, 500, 80);
+
+        auto error = (GError*)nullptr;
+        auto columns = Ring::column_t{-1};
+        {
+                auto ring = Ring{100000, true};
+                g_assert_true(ring.attach_session(dir, &columns, &error));
+                g_assert_no_error(error);
+                g_assert_cmpint(columns, ==, 0);
+                fill_ring(ring, 500, 80);
+                assert_rings_equal(expected, ring);
+                g_assert_true(ring.save_session(ring.next(), 80));
+        }
+
+        auto ring = Ring{100000, true};
+        g_assert_true(ring.attach_session(dir, &columns, &error));
+        g_assert_no_error(error);
+        g_assert_cmpint(columns, ==, 80);
+        assert_rings_equal(expected, ring);
+
+        /* The header is consumed, a later ring starts afresh */
+        g_assert_true(ring.save_session(ring.next(), 80));
+        g_assert_true(ring.attach_session(dir, &columns, &error));
+        g_assert_no_error(error);
+        g_assert_cmpint(columns, ==, 80);
+        assert_rings_equal(expected, ring);
+
+        remove_session_dir(dir);
+        g_free(dir);
+}
+
+/* Another ring can't attach to the directory while one uses it */
+static void
+test_ring_session_busy(void)
+{
+        auto const dir = g_dir_make_tmp("bte-ring-test-XXXXXX", nullptr);
+        g_assert_nonnull(dir);
+
+        auto error = (GError*)nullptr;
+        auto columns = Ring::column_t{0};
+        auto expected = Ring{100000, true};
+        fill_ring(expected, 500, 80);
+        {
+                auto ring = Ring{100000, true};
+                g_assert_true(ring.attach_session(dir, &columns, &error));
+                g_assert_no_error(error);
+                fill_ring(ring, 500, 80);
+
+                auto other = Ring{100000, true};
+                g_assert_false(other.attach_session(dir, &columns, &error));
+                g_assert_error(error, G_IO_ERROR, G_IO_ERROR_BUSY);
+                g_clear_error(&error);
+                g_assert_cmpint(columns, ==, 0);
+
+                /* The streams in use are still there */
+                assert_rings_equal(expected, ring);
+        }
+
+        /* The lock goes with the ring */
+        auto ring = Ring{100000, true};
+        g_assert_true(ring.attach_session(dir, &columns, &error));
+        g_assert_no_error(error);
+
+        remove_session_dir(dir);
+        g_free(dir);
+}
+
+/* The directory and the header have the keys, only the user may access them */
+static void
+test_ring_session_permissions(void)
+{
+        auto const dir = g_dir_make_tmp("bte-ring-test-XXXXXX", nullptr);
+        g_assert_nonnull(dir);
+
+        auto error = (GError*)nullptr;
+        auto columns = Ring::column_t{0};
+        g_assert_cmpint(chmod(dir, 0755), ==, 0);
+        {
+                auto ring = Ring{100000, true};
+                g_assert_false(ring.attach_session(dir, &columns, &error));
+                g_assert_error(error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED);
+                g_clear_error(&error);
+        }
+        g_assert_cmpint(chmod(dir, 0700), ==, 0);
+
+        {
+                auto ring = Ring{100000, true};
+                g_assert_true(ring.attach_session(dir, &columns, &error));
+                g_assert_no_error(error);
+                fill_ring(ring, 500, 80);
+                g_assert_true(ring.save_session(ring.next(), 80));
+        }
+        auto const header = g_build_filename(dir, "session", nullptr);
+        g_assert_cmpint(chmod(header, 0644), ==, 0);
+        g_free(header);
+
+        auto ring = Ring{100000, true};
+        g_assert_false(ring.attach_session(dir, &columns, &error));
+        g_assert_error(error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED);
+        g_clear_error(&error);
+        g_assert_cmpint(columns, ==, 0);
+        g_assert_cmpuint(ring.length(), ==, 0);
+        /* Unlike the directory, a bad header doesn't keep the ring out */
+        g_assert_cmpstr(ring.session_dir().c_str(), ==, dir);
+
+        remove_session_dir(dir);
+        g_free(dir);
+}
+
+/* A ring that is refused another directory keeps its session */
+static void
+test_ring_session_refused(void)
+{
+        auto const dir = g_dir_make_tmp("bte-ring-test-XXXXXX", nullptr);
+        auto const busy_dir = g_dir_make_tmp("bte-ring-test-XXXXXX", nullptr);
+        auto const public_dir = g_dir_make_tmp("bte-ring-test-XXXXXX", nullptr);
+        g_assert_nonnull(dir);
+        g_assert_nonnull(busy_dir);
+        g_assert_nonnull(public_dir);
+        g_assert_cmpint(chmod(public_dir, 0755), ==, 0);
+
+        auto error = (GError*)nullptr;
+        auto columns = Ring::column_t{0};
+        auto expected = Ring{100000, true};
+        fill_ring(expected, 500, 80);
+        {
+                auto ring = Ring{100000, true};
+                g_assert_true(ring.attach_session(dir, &columns, &error));
+                g_assert_no_error(error);
+                fill_ring(ring, 500, 80);
+
+                auto other = Ring{100000, true};
+                g_assert_true(other.attach_session(busy_dir, &columns, &error));
+                g_assert_no_error(error);
+
+                columns = 1;
+                g_assert_false(ring.attach_session(busy_dir, &columns, &error));
+                g_assert_error(error, G_IO_ERROR, G_IO_ERROR_BUSY);
+                g_clear_error(&error);
+                g_assert_cmpint(columns, ==, 0);
+                g_assert_cmpstr(ring.session_dir().c_str(), ==, dir);
+                assert_rings_equal(expected, ring);
+
+                g_assert_false(ring.attach_session(public_dir, &columns, &error));
+                g_assert_error(error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED);
+                g_clear_error(&error);
+                g_assert_cmpstr(ring.session_dir().c_str(), ==, dir);
+                assert_rings_equal(expected, ring);
+
+                /* Still locked, and saved to the directory it has */
+                auto third = Ring{100000, true};
+                g_assert_false(third.attach_session(dir, &columns, &error));
+                g_assert_error(error, G_IO_ERROR, G_IO_ERROR_BUSY);
+                g_clear_error(&error);
+                g_assert_true(third.session_dir().empty());
+
+                g_assert_true(ring.save_session(ring.next(), 80));
+        }
+
+        auto ring = Ring{100000, true};
+        g_assert_true(ring.attach_session(dir, &columns, &error));
+        g_assert_no_error(error);
+        g_assert_cmpint(columns, ==, 80);
+        assert_rings_equal(expected, ring);
+
+        g_assert_cmpint(chmod(public_dir, 0700), ==, 0);
+        remove_session_dir(public_dir);
+        remove_session_dir(busy_dir);
+        remove_session_dir(dir);
+        g_free(public_dir);
+        g_free(busy_dir);
+        g_free(dir);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/ring/rewrap/lazy", test_ring_rewrap_lazy);
+        g_test_add_func("/bte/ring/rewrap/lazy/commit-early", test_ring_rewrap_lazy_commit_early);
+        g_test_add_func("/bte/ring/rewrap/long-paragraph", test_ring_rewrap_long_paragraph);
+        g_test_add_func("/bte/ring/evict", test_ring_evict);
+        g_test_add_func("/bte/ring/freeze/fast-path", test_ring_freeze_fast_path);
+        g_test_add_func("/bte/ring/session/round-trip", test_ring_session_round_trip);
+        g_test_add_func("/bte/ring/session/busy", test_ring_session_busy);
+        g_test_add_func("/bte/ring/session/permissions", test_ring_session_permissions);
+        g_test_add_func("/bte/ring/session/refused", test_ring_session_refused);
+
+        return g_test_run();
+}
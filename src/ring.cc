@@ -23,8 +23,20 @@
 #include "debug.h"
 #include "ring.hh"
 #include "bterowdata.hh"
+#include "bteutils.h"
+#include "trace.hh"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib/gi18n-lib.h>
+
+#include <utility>
+#include <vector>
 
 /*
  * Copy the common attributes from BteCellAttr to BteStreamCellAttr or vice versa.
@@ -60,6 +72,15 @@ Ring::validate() const
 #define validate(...) do { } while(0)
 #endif
 
+BteStream*
+Ring::new_stream()
+{
+        auto stream = m_session_dir.empty() ? _bte_file_stream_new()
+                : _bte_file_stream_new_in_dir(m_session_dir.c_str());
+        _bte_file_stream_set_statistics(stream, &m_stream_statistics);
+        return stream;
+}
+
 Ring::Ring(row_t max_rows,
            bool has_streams)
         : m_max{MAX(max_rows, 3)},
@@ -71,9 +92,9 @@ Ring::Ring(row_t max_rows,
 	m_array = (BteRowData* ) g_malloc0 (sizeof (m_array[0]) * (m_mask + 1));
 
 	if (has_streams) {
-		m_attr_stream = _bte_file_stream_new ();
-		m_text_stream = _bte_file_stream_new ();
-		m_row_stream = _bte_file_stream_new ();
+		m_attr_stream = new_stream();
+		m_text_stream = new_stream();
+		m_row_stream = new_stream();
 	} else {
 		m_attr_stream = m_text_stream = m_row_stream = nullptr;
 	}
@@ -102,6 +123,8 @@ Ring::~Ring()
 		g_object_unref (m_row_stream);
 	}
 
+	rewrap_cancel();
+
 	g_string_free (m_utf8_buffer, TRUE);
 
         for (size_t i = 0; i < m_hyperlinks->len; i++)
@@ -284,17 +307,46 @@ Ring::get_hyperlink_idx(char const* hyperlink)
         return m_hyperlink_current_idx;
 }
 
+/* Appends the change away from m_last_attr at @text_offset to the attr
+ * stream, and returns the number of bytes appended.
+ */
+gsize
+Ring::append_attr_change(gsize text_offset,
+                         gboolean& froze_hyperlink)
+{
+        CellAttrChange attr_change;
+        guint16 hyperlink_length;
+
+        m_last_attr_text_start_offset = text_offset;
+        memset(&attr_change, 0, sizeof (attr_change));
+        attr_change.text_end_offset = m_last_attr_text_start_offset;
+        _attrcpy(&attr_change.attr, &m_last_attr);
+        auto const hyperlink = hyperlink_get(m_last_attr.hyperlink_idx);
+        attr_change.attr.hyperlink_length = hyperlink->len;
+        _bte_stream_append (m_attr_stream, (char const* ) &attr_change, sizeof (attr_change));
+        if (G_UNLIKELY (hyperlink->len != 0)) {
+                _bte_stream_append (m_attr_stream, hyperlink->str, hyperlink->len);
+                froze_hyperlink = TRUE;
+        }
+        hyperlink_length = attr_change.attr.hyperlink_length;
+        _bte_stream_append (m_attr_stream, (char const* ) &hyperlink_length, 2);
+
+        return sizeof (attr_change) + hyperlink_length + 2;
+}
+
 void
 Ring::freeze_row(row_t position,
                  BteRowData const* row)
 {
 	BteCell *cell;
 	GString *buffer = m_utf8_buffer;
-        GString *hyperlink;
 	int i;
         gboolean froze_hyperlink = FALSE;
 
 	_bte_debug_print (BTE_DEBUG_RING, "Freezing row %lu.\n", position);
+        _BTE_TRACE_SCOPE(ring_freeze_row, position, row->len);
+
+        ++m_n_freezes;
 
         g_assert(m_has_streams);
 
@@ -305,7 +357,22 @@ Ring::freeze_row(row_t position,
 	record.is_ascii = 1;
 
 	g_string_set_size (buffer, 0);
-	for (i = 0, cell = row->cells; i < row->len; i++, cell++) {
+
+        /* Fast path for the common case of a row in one attr and without
+         * combining or wide characters: one attr change at most, and the
+         * text in one go.
+         */
+        bool is_ascii;
+        if (row->len > 0 && _bte_row_data_is_uniform(row, &is_ascii)) {
+                if (memcmp(&m_last_attr, &row->cells[0].attr, sizeof (BteCellAttr)) != 0) {
+                        /* This row doesn't use last_attr, adjust */
+                        record.attr_start_offset += append_attr_change(record.text_start_offset, froze_hyperlink);
+                        m_last_attr = row->cells[0].attr;
+                }
+
+                record.is_ascii = is_ascii;
+                _bte_row_data_append_utf8(row, is_ascii, buffer);
+        } else for (i = 0, cell = row->cells; i < row->len; i++, cell++) {
 		BteCellAttr attr;
 		int num_chars;
 
@@ -322,26 +389,12 @@ Ring::freeze_row(row_t position,
 		 */
 		attr = cell->attr;
 		if (G_LIKELY (!attr.fragment())) {
-			CellAttrChange attr_change;
-                        guint16 hyperlink_length;
-
 			if (memcmp(&m_last_attr, &attr, sizeof (BteCellAttr)) != 0) {
-				m_last_attr_text_start_offset = record.text_start_offset + buffer->len;
-				memset(&attr_change, 0, sizeof (attr_change));
-				attr_change.text_end_offset = m_last_attr_text_start_offset;
-                                _attrcpy(&attr_change.attr, &m_last_attr);
-                                hyperlink = hyperlink_get(m_last_attr.hyperlink_idx);
-                                attr_change.attr.hyperlink_length = hyperlink->len;
-				_bte_stream_append (m_attr_stream, (char const* ) &attr_change, sizeof (attr_change));
-                                if (G_UNLIKELY (hyperlink->len != 0)) {
-                                        _bte_stream_append (m_attr_stream, hyperlink->str, hyperlink->len);
-                                        froze_hyperlink = TRUE;
-                                }
-                                hyperlink_length = attr_change.attr.hyperlink_length;
-                                _bte_stream_append (m_attr_stream, (char const* ) &hyperlink_length, 2);
+                                auto const len = append_attr_change(record.text_start_offset + buffer->len,
+                                                                    froze_hyperlink);
 				if (!buffer->len)
 					/* This row doesn't use last_attr, adjust */
-                                        record.attr_start_offset += sizeof (attr_change) + hyperlink_length + 2;
+                                        record.attr_start_offset += len;
 				m_last_attr = attr;
 			}
 
@@ -349,20 +402,9 @@ Ring::freeze_row(row_t position,
 			if (num_chars > 1) {
                                 /* Combining chars */
 				attr.set_columns(0);
-				m_last_attr_text_start_offset = record.text_start_offset + buffer->len
-								  + g_unichar_to_utf8 (_bte_unistr_get_base (cell->c), nullptr);
-				memset(&attr_change, 0, sizeof (attr_change));
-				attr_change.text_end_offset = m_last_attr_text_start_offset;
-                                _attrcpy(&attr_change.attr, &m_last_attr);
-                                hyperlink = hyperlink_get(m_last_attr.hyperlink_idx);
-                                attr_change.attr.hyperlink_length = hyperlink->len;
-				_bte_stream_append (m_attr_stream, (char const* ) &attr_change, sizeof (attr_change));
-                                if (G_UNLIKELY (hyperlink->len != 0)) {
-                                        _bte_stream_append (m_attr_stream, hyperlink->str, hyperlink->len);
-                                        froze_hyperlink = TRUE;
-                                }
-                                hyperlink_length = attr_change.attr.hyperlink_length;
-                                _bte_stream_append (m_attr_stream, (char const* ) &hyperlink_length, 2);
+                                append_attr_change(record.text_start_offset + buffer->len
+                                                   + g_unichar_to_utf8 (_bte_unistr_get_base (cell->c), nullptr),
+                                                   froze_hyperlink);
 				m_last_attr = attr;
 			}
 
@@ -411,9 +453,12 @@ Ring::thaw_row(row_t position,
         }
 
 	_bte_debug_print (BTE_DEBUG_RING, "Thawing row %lu.\n", position);
+        _BTE_TRACE_SCOPE(ring_thaw_row, position);
 
         g_assert(m_has_streams);
 
+        ++m_n_thaws;
+
 	_bte_row_data_clear (row);
 
 	attr_change.text_end_offset = 0;
@@ -481,6 +526,35 @@ Ring::thaw_row(row_t position,
                                 cell.attr.attr ^= BTE_ATTR_REVERSE;
                         }
                 }
+
+                /* Fast path: each ASCII byte up to the next attr change is a
+                 * cell of its own in this attr. Rows known to be ASCII don't
+                 * even need to be looked at.
+                 */
+                if (G_LIKELY (cell.attr.columns() == 1 && (guchar) *p < 0x80)) {
+                        char const* run_end = end;
+                        if (record.text_start_offset < m_last_attr_text_start_offset) {
+                                auto const attr_end = MIN (attr_change.text_end_offset, m_last_attr_text_start_offset);
+                                if (attr_end > record.text_start_offset)
+                                        run_end = MIN (run_end, p + (attr_end - record.text_start_offset));
+                                else
+                                        run_end = p + 1;
+                        }
+                        if (records[0].is_ascii)
+                                q = run_end;
+                        else
+                                for (q = p + 1; q < run_end && (guchar) *q < 0x80; q++) ;
+
+                        if (G_UNLIKELY (hyperlink != nullptr &&
+                                        hyperlink_column >= row->len && hyperlink_column < row->len + (q - p)))
+                                *hyperlink = strcpy(m_hyperlink_buf, hyperlink_readbuf);
+                        _bte_row_data_append_ascii (row, p, q - p, &cell.attr);
+
+                        record.text_start_offset += q - p;
+                        p = q;
+                        continue;
+                }
+
 		cell.c = g_utf8_get_char (p);
 
 		q = g_utf8_next_char (p);
@@ -580,6 +654,9 @@ Ring::reset_streams(row_t position)
 
 	m_last_attr_text_start_offset = 0;
 	m_last_attr = basic_cell.attr;
+
+	/* There are no old-wrapped rows left to rewrap */
+	rewrap_cancel();
 }
 
 Ring::row_t
@@ -724,6 +801,14 @@ Ring::thaw_one_row()
 	if (m_writable == m_cached_row_num)
 		m_cached_row_num = (row_t)-1; /* Invalidate cached row */
 
+	if (G_UNLIKELY (m_writable < m_rewrap_pending_end)) {
+		/* The row's text is about to be truncated from the stream,
+		 * so it can no longer be rewrapped in the background. */
+		m_rewrap_pending_end = m_writable;
+		if (m_rewrap_row > m_rewrap_pending_end)
+			rewrap_restart();
+	}
+
 	row = get_writable_index(m_writable);
         thaw_row(m_writable, row, true, -1, nullptr);
 }
@@ -968,6 +1053,469 @@ Ring::drop_scrollback(row_t position)
         reset_streams(position);
 }
 
+/**
+ * Ring::evict:
+ * @bytes: the number of bytes of stream storage to release
+ *
+ * Drops the oldest scrollback rows, so that at least @bytes of stream storage
+ * are released; or all of the frozen rows if they don't take up that much.
+ * The writable rows, which include the onscreen ones, are never dropped.
+ * The bytes are counted as the rows were written to the streams, like
+ * stream_bytes() does, not as they were compressed on disk.
+ *
+ * Returns: the number of bytes released
+ */
+size_t
+Ring::evict(size_t bytes)
+{
+        if (!m_has_streams || m_start >= m_writable || bytes == 0)
+                return 0;
+
+        validate();
+
+        auto const total = _bte_stream_head(m_row_stream) - _bte_stream_tail(m_row_stream) +
+                _bte_stream_head(m_text_stream) - _bte_stream_tail(m_text_stream) +
+                _bte_stream_head(m_attr_stream) - _bte_stream_tail(m_attr_stream);
+
+        /* The stream storage in front of a row grows with the row, so
+         * binary search for the first row that has at least @bytes in
+         * front of it. A read error ends up dropping all frozen rows.
+         */
+        RowRecord start_record, record;
+        auto const released = [&](row_t position,
+                                  RowRecord const& r) -> size_t {
+                return (position - m_start) * sizeof(r) +
+                        (r.text_start_offset - start_record.text_start_offset) +
+                        (r.attr_start_offset - start_record.attr_start_offset);
+        };
+
+        auto position = m_writable;
+        if (total > bytes && read_row_record(&start_record, m_start)) {
+                auto low = m_start;
+                while (position - low > 1) {
+                        auto const mid = low + (position - low) / 2;
+                        if (!read_row_record(&record, mid) ||
+                            released(mid, record) >= bytes)
+                                position = mid;
+                        else
+                                low = mid;
+                }
+        }
+
+        if (position == m_writable || !read_row_record(&record, position)) {
+                _bte_debug_print(BTE_DEBUG_RING, "Evicting all %lu frozen rows.\n", m_writable - m_start);
+
+                m_start = m_writable;
+                reset_streams(m_writable);
+                m_cached_row_num = (row_t)-1;
+                validate();
+                return total;
+        }
+
+        _bte_debug_print(BTE_DEBUG_RING, "Evicting %lu frozen rows.\n", position - m_start);
+
+        auto const rv = released(position, record);
+        m_start = position;
+        _bte_stream_advance_tail(m_row_stream, m_start * sizeof(record));
+        _bte_stream_advance_tail(m_text_stream, record.text_start_offset);
+        _bte_stream_advance_tail(m_attr_stream, record.attr_start_offset);
+        m_cached_row_num = (row_t)-1;
+
+        validate();
+        return rv;
+}
+
+/**
+ * Ring::trim:
+ *
+ * Releases the memory that an idle terminal doesn't need: freezes the
+ * writable rows beyond the visible ones, shrinks the writable array and the
+ * cell arrays of the remaining rows to what is in use, and frees the cached
+ * row. All of it is reallocated on demand.
+ */
+void
+Ring::trim()
+{
+        _bte_debug_print(BTE_DEBUG_RING, "Trimming.\n");
+
+        validate();
+
+        /* See the comment about m_visible_rows + 1 at ensure_writable_room() */
+        if (m_has_streams) {
+                while (m_end - m_writable > m_visible_rows + 1)
+                        freeze_one_row();
+        }
+
+        for (auto i = m_writable; i < m_end; i++)
+                _bte_row_data_compact(get_writable_index(i));
+        for (auto i = m_end; i <= m_writable + m_mask; i++)
+                _bte_row_data_fini(get_writable_index(i));
+
+        auto new_mask = row_t{31};
+        while (new_mask < m_visible_rows + 1 || m_writable + new_mask + 1 <= m_end)
+                new_mask = (new_mask << 1) + 1;
+
+        if (new_mask < m_mask) {
+                _bte_debug_print(BTE_DEBUG_RING, "Shrinking writable array from %lu to %lu\n", m_mask, new_mask);
+
+                auto const new_array = (BteRowData*) g_malloc0(sizeof (m_array[0]) * (new_mask + 1));
+                for (auto i = m_writable; i < m_end; i++)
+                        new_array[i & new_mask] = *get_writable_index(i);
+
+                g_free(m_array);
+                m_array = new_array;
+                m_mask = new_mask;
+        }
+
+        _bte_row_data_fini(&m_cached_row);
+        m_cached_row_num = (row_t)-1;
+
+        if (m_utf8_buffer->allocated_len > 128) {
+                g_string_free(m_utf8_buffer, TRUE);
+                m_utf8_buffer = g_string_sized_new(128);
+        }
+
+        validate();
+}
+
+/* Returns the size of the scrollback in the streams, before compression */
+size_t
+Ring::stream_bytes() const
+{
+        if (!m_has_streams)
+                return 0;
+
+        auto bytes = _bte_stream_head(m_row_stream) - _bte_stream_tail(m_row_stream) +
+                _bte_stream_head(m_text_stream) - _bte_stream_tail(m_text_stream) +
+                _bte_stream_head(m_attr_stream) - _bte_stream_tail(m_attr_stream);
+        if (m_rewrap_stream)
+                bytes += _bte_stream_head(m_rewrap_stream) - _bte_stream_tail(m_rewrap_stream);
+
+        return bytes;
+}
+
+/* Returns the size of the writable rows, and of the other buffers in memory */
+size_t
+Ring::memory_bytes() const
+{
+        auto bytes = sizeof(*this) +
+                (m_mask + 1) * sizeof(m_array[0]) +
+                m_utf8_buffer->allocated_len +
+                _bte_row_data_alloc_size(&m_cached_row);
+        for (row_t i = 0; i <= m_mask; i++)
+                bytes += _bte_row_data_alloc_size(&m_array[i]);
+
+        return bytes;
+}
+
+/*
+ * Scrollback sessions
+ *
+ * With attach_session(), the streams are kept in a directory rather than in
+ * anonymous files. save_session() freezes all rows and writes the state of
+ * the ring and of its streams to a header next to them, so that a ring later
+ * attaching to the same directory picks the streams up as they are, without
+ * reading any rows.
+ *
+ * Attaching consumes the header: the streams are written to again from then
+ * on, and restoring the same header twice would reuse their encryption IVs.
+ * Stream files without a header, e.g. after a crash, are deleted when
+ * attaching, so a ring holds an exclusive lock on the directory for as long
+ * as it uses it. The header contains the streams' keys, so the directory and
+ * the header have to be the user's own, and inaccessible to anybody else.
+ */
+
+#define BTE_SESSION_HEADER_NAME "session"
+#define BTE_SESSION_LOCK_NAME "lock"
+#define BTE_SESSION_MAGIC "BTESESS"
+#define BTE_SESSION_VERSION 1
+
+#ifndef HAVE_EXPLICIT_BZERO
+#define explicit_bzero(s, n) memset((s), 0, (n))
+#endif
+
+/* Returns whether @fd is of @type, owned by the user and inaccessible to others */
+static bool
+session_fd_is_private(int fd,
+                      mode_t type)
+{
+        struct stat st;
+        return fstat(fd, &st) == 0 &&
+                (st.st_mode & S_IFMT) == type &&
+                st.st_uid == geteuid() &&
+                (st.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+/* Returns whether @fd and @other_fd are the same file */
+static bool
+session_fd_is_same(int fd,
+                   int other_fd)
+{
+        struct stat st, other_st;
+        return other_fd != -1 &&
+                fstat(fd, &st) == 0 &&
+                fstat(other_fd, &other_st) == 0 &&
+                st.st_dev == other_st.st_dev &&
+                st.st_ino == other_st.st_ino;
+}
+
+/**
+ * Ring::attach_session:
+ * @dir: the session directory, which must exist
+ * @columns: (out): the number of columns when the session was saved, or 0
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Discards the contents of the ring, and keeps the streams in @dir from now
+ * on. If @dir holds a saved session, it's restored: the ring ends where it
+ * ended then, with all rows frozen.
+ *
+ * Returns: %false with @error set if @dir isn't private to the user, or if
+ *   another ring uses it, in which case nothing changes; or if there was a
+ *   session that couldn't be restored, in which case the ring uses @dir
+ *   nevertheless.
+ */
+bool
+Ring::attach_session(char const* dir,
+                     column_t* columns,
+                     GError** error)
+{
+        g_assert(m_has_streams);
+
+        _bte_debug_print(BTE_DEBUG_RING, "Attaching to session %s.\n", dir);
+
+        *columns = 0;
+
+        auto const dir_fd = bte::libc::FD{open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (dir_fd == -1) {
+                auto const errsv = errno;
+                g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                            _("Cannot open the scrollback session directory %s: %s"),
+                            dir, g_strerror(errsv));
+                return false;
+        }
+        if (!session_fd_is_private(dir_fd.get(), S_IFDIR)) {
+                g_set_error(error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
+                            _("The scrollback session directory %s must be owned by the user and only accessible to them"),
+                            dir);
+                return false;
+        }
+
+        /* Attaching deletes the streams that aren't in the header, which
+         * mustn't happen to the ones that another ring is using. Keep the
+         * lock if this ring has it already.
+         */
+        auto lock = bte::libc::FD{openat(dir_fd.get(), BTE_SESSION_LOCK_NAME,
+                                         O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600)};
+        if (lock != -1 && session_fd_is_same(lock.get(), m_session_lock.get()))
+                lock = std::move(m_session_lock);
+        else if (lock != -1 && flock(lock.get(), LOCK_EX | LOCK_NB) != 0)
+                lock.reset();
+        if (lock == -1) {
+                auto const errsv = errno;
+                if (errsv == EWOULDBLOCK)
+                        g_set_error(error, G_IO_ERROR, G_IO_ERROR_BUSY,
+                                    _("The scrollback session in %s is in use"), dir);
+                else
+                        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                                    _("Cannot lock the scrollback session in %s: %s"),
+                                    dir, g_strerror(errsv));
+                return false;
+        }
+
+        rewrap_cancel();
+        m_session_dir = dir;
+        m_session_lock = std::move(lock);
+
+        SessionHeader header;
+        BteStream* streams[3]{nullptr, nullptr, nullptr};
+        auto restored = false, found = false, is_private = true;
+
+        auto const fd = bte::libc::FD{openat(dir_fd.get(), BTE_SESSION_HEADER_NAME,
+                                             O_RDONLY | O_NOFOLLOW | O_CLOEXEC)};
+        if (fd != -1 || errno != ENOENT) {
+                found = true;
+                unlinkat(dir_fd.get(), BTE_SESSION_HEADER_NAME, 0);
+
+                /* Read one byte more, to tell a header that's too long */
+                char contents[sizeof(header) + 1];
+                auto contents_length = ssize_t{0};
+                is_private = fd != -1 && session_fd_is_private(fd.get(), S_IFREG);
+                if (is_private) {
+                        auto r = ssize_t{0};
+                        do {
+                                r = read(fd.get(), contents + contents_length, sizeof(contents) - contents_length);
+                                if (r > 0)
+                                        contents_length += r;
+                        } while ((r > 0 && contents_length < ssize_t(sizeof(contents))) ||
+                                 (r == -1 && errno == EINTR));
+                }
+
+                if (contents_length == sizeof(header)) {
+                        memcpy(&header, contents, sizeof(header));
+                        restored = memcmp(header.magic, BTE_SESSION_MAGIC, sizeof(header.magic)) == 0 &&
+                                header.version == BTE_SESSION_VERSION &&
+                                header.row_record_size == sizeof(RowRecord) &&
+                                header.attr_change_size == sizeof(CellAttrChange) &&
+                                header.start <= header.end &&
+                                header.streams[0].head == header.end * sizeof(RowRecord);
+                        for (auto i = 0; restored && i < 3; i++) {
+                                streams[i] = _bte_file_stream_new_from_session(dir, &header.streams[i]);
+                                restored = streams[i] != nullptr;
+                        }
+                }
+
+                explicit_bzero(contents, sizeof(contents));
+        }
+
+        if (!restored) {
+                for (auto stream : streams)
+                        if (stream != nullptr)
+                                g_object_unref(stream);
+                streams[0] = streams[1] = streams[2] = nullptr;
+        }
+
+        /* Delete the streams not in the header */
+        if (auto gdir = g_dir_open(dir, 0, nullptr)) {
+                char const* name;
+                while ((name = g_dir_read_name(gdir)) != nullptr) {
+                        if (!g_str_has_prefix(name, "stream"))
+                                continue;
+                        if (restored &&
+                            (strcmp(name, header.streams[0].name) == 0 ||
+                             strcmp(name, header.streams[1].name) == 0 ||
+                             strcmp(name, header.streams[2].name) == 0))
+                                continue;
+
+                        auto const stream_path = g_build_filename(dir, name, nullptr);
+                        unlink(stream_path);
+                        g_free(stream_path);
+                }
+                g_dir_close(gdir);
+        }
+
+        g_object_unref(m_row_stream);
+        g_object_unref(m_text_stream);
+        g_object_unref(m_attr_stream);
+        if (restored) {
+                m_row_stream = streams[0];
+                m_text_stream = streams[1];
+                m_attr_stream = streams[2];
+                for (auto stream : streams)
+                        _bte_file_stream_set_statistics(stream, &m_stream_statistics);
+
+                m_start = header.start;
+                m_end = m_writable = header.end;
+                m_last_attr_text_start_offset = header.last_attr_text_start_offset;
+                m_last_attr = basic_cell.attr;
+                *columns = header.columns;
+        } else {
+                m_row_stream = new_stream();
+                m_text_stream = new_stream();
+                m_attr_stream = new_stream();
+
+                reset_streams(m_end);
+                m_start = m_writable = m_end;
+        }
+        m_cached_row_num = (row_t)-1;
+        explicit_bzero(&header, sizeof(header));
+
+        if (length() > m_max)
+                resize(m_max);
+
+        validate();
+
+        if (found && !is_private) {
+                g_set_error(error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
+                            _("The scrollback session in %s was accessible to other users and has been discarded"),
+                            dir);
+                return false;
+        }
+        if (found && !restored) {
+                g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                            _("Cannot restore the scrollback session in %s"), dir);
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * Ring::save_session:
+ * @end: the row after the last one to save
+ * @columns: the number of columns the rows are wrapped at
+ *
+ * Freezes the rows up to @end, dropping the ones after it, and saves the
+ * session so that attach_session() can restore it. The ring mustn't be
+ * changed afterwards, only destroyed.
+ *
+ * Returns: whether the session was saved
+ */
+bool
+Ring::save_session(row_t end,
+                   column_t columns)
+{
+        if (m_session_dir.empty())
+                return false;
+
+        _bte_debug_print(BTE_DEBUG_RING, "Saving session to %s.\n", m_session_dir.c_str());
+
+        /* Rows not rewrapped yet keep their old wrapping */
+        rewrap_cancel();
+
+        end = CLAMP(end, m_writable, m_end);
+        while (m_writable < end)
+                freeze_one_row();
+        m_end = m_writable;
+
+        /* Write out the last attr, so that the header needn't contain it,
+         * nor its hyperlink.
+         */
+        if (memcmp(&m_last_attr, &basic_cell.attr, sizeof(BteCellAttr)) != 0) {
+                gboolean froze_hyperlink = FALSE;
+                append_attr_change(_bte_stream_head(m_text_stream), froze_hyperlink);
+                m_last_attr = basic_cell.attr;
+        }
+
+        SessionHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BTE_SESSION_MAGIC, sizeof(header.magic));
+        header.version = BTE_SESSION_VERSION;
+        header.row_record_size = sizeof(RowRecord);
+        header.attr_change_size = sizeof(CellAttrChange);
+        header.columns = columns;
+        header.start = m_start;
+        header.end = m_end;
+        header.last_attr_text_start_offset = m_last_attr_text_start_offset;
+
+        auto saved = _bte_file_stream_save_session(m_row_stream, &header.streams[0]) &&
+                _bte_file_stream_save_session(m_text_stream, &header.streams[1]) &&
+                _bte_file_stream_save_session(m_attr_stream, &header.streams[2]);
+
+        /* Write the header to a temporary file first, so that it's either
+         * complete or missing.
+         */
+        if (saved) {
+                auto const path = g_build_filename(m_session_dir.c_str(), BTE_SESSION_HEADER_NAME, nullptr);
+                auto const tmp_path = g_strconcat(path, ".tmp", nullptr);
+
+                auto const fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+                saved = fd != -1 &&
+                        write(fd, &header, sizeof(header)) == sizeof(header) &&
+                        fsync(fd) == 0;
+                if (fd != -1)
+                        close(fd);
+                saved = saved && rename(tmp_path, path) == 0;
+                if (!saved)
+                        unlink(tmp_path);
+
+                g_free(tmp_path);
+                g_free(path);
+        }
+        explicit_bzero(&header, sizeof(header));
+
+        return saved;
+}
+
 /**
  * Ring::set_visible_rows:
  * @rows: the number of visible rows
@@ -1140,99 +1688,168 @@ Ring::frozen_row_text_offset_to_column(row_t position,
 }
 
 
-/**
- * Ring::rewrap:
- * @columns: new number of columns
- * @markers: 0-terminated array of #BteVisualPosition
- *
- * Reflow the @ring to match the new number of @columns.
- * For all @markers, find the cell at that position and update them to
- * reflect the cell's new position.
- */
-/* See ../doc/rewrap.txt for design and implementation details. */
+/* Returns the last row in [first, end) of @row_stream that starts at or before
+ * @text_offset, or @first if there's no such row. */
+Ring::row_t
+Ring::find_row_by_text_offset(BteStream* row_stream,
+                              row_t first,
+                              row_t end,
+                              size_t text_offset)
+{
+	RowRecord record;
+
+	while (end - first > 1) {
+		row_t mid = first + (end - first) / 2;
+		if (!_bte_stream_read(row_stream, mid * sizeof (record), (char *) &record, sizeof (record)))
+			break;
+		if (record.text_start_offset <= text_offset)
+			first = mid;
+		else
+			end = mid;
+	}
+	return first;
+}
+
+/* A range of frozen rows, along with their text and attributes copied out of
+ * the streams, so that it can be rewrapped on a worker thread.
+ * A chunk normally holds whole paragraphs. Only a paragraph too long to fit is
+ * split over several chunks, which then have to be rewrapped one after the
+ * other, handing over the paragraph's unfinished new row. */
+struct Ring::RewrapChunk {
+        struct Carry {
+                bool pending{false};
+                RowRecord record;            /* the unfinished new row */
+                column_t col;                /* its width so far */
+        };
+
+        std::vector<RowRecord> records;      /* the old records of the rows */
+        size_t text_start_offset;
+        std::vector<char> text;              /* text_stream from text_start_offset on */
+        size_t attr_start_offset;
+        std::vector<char> attr;              /* attr_stream from attr_start_offset on */
+        bool continues;                      /* the last paragraph goes on in the next chunk */
+
+        Carry carry_in;                      /* from the previous chunk, if it continues */
+        Carry carry_out;                     /* for the next chunk, if this one continues */
+        std::vector<RowRecord> new_records;
+        std::vector<std::pair<int, row_t>> markers;  /* marker index, new row relative to the chunk */
+};
+
+/* Copy the paragraphs starting at *@row, but not beyond @end_row, into @chunk,
+ * trying to stay around BTE_REWRAP_CHUNK_SIZE bytes of text and within
+ * @max_rows rows. A paragraph is only cut once it exceeds
+ * BTE_REWRAP_CHUNK_SIZE on its own, so that a huge one is never loaded whole.
+ * Updates *@row to the first row not taken. */
+bool
+Ring::load_rewrap_chunk(RewrapChunk* chunk,
+                        row_t* row,
+                        row_t end_row,
+                        row_t max_rows)
+{
+	RowRecord record;
+	row_t r = *row;
+	gsize text_end_offset, attr_end_offset;
+
+	chunk->records.clear();
+	chunk->new_records.clear();
+	chunk->markers.clear();
+	chunk->carry_out.pending = false;
+
+	do {
+		if (!read_row_record(&record, r))
+			return false;
+		chunk->records.push_back(record);
+		r++;
+	} while (r < end_row &&
+		 (record.soft_wrapped || r - *row < max_rows) &&
+		 record.text_start_offset - chunk->records[0].text_start_offset < BTE_REWRAP_CHUNK_SIZE);
+	chunk->continues = r < end_row && record.soft_wrapped;
+
+	/* The attr record in effect at the start of the next row might still cover
+	   the end of this chunk, so take that one too. */
+	if (r * sizeof (record) < _bte_stream_head(m_row_stream)) {
+		if (!read_row_record(&record, r))
+			return false;
+		text_end_offset = record.text_start_offset;
+		attr_end_offset = MIN(record.attr_start_offset + sizeof (CellAttrChange),
+				      _bte_stream_head(m_attr_stream));
+	} else {
+		text_end_offset = _bte_stream_head(m_text_stream);
+		attr_end_offset = _bte_stream_head(m_attr_stream);
+	}
+
+	chunk->text_start_offset = chunk->records[0].text_start_offset;
+	chunk->text.resize(text_end_offset - chunk->text_start_offset);
+	if (!_bte_stream_read(m_text_stream, chunk->text_start_offset,
+			      chunk->text.data(), chunk->text.size()))
+		return false;
+
+	chunk->attr_start_offset = chunk->records[0].attr_start_offset;
+	chunk->attr.resize(MAX(attr_end_offset, chunk->attr_start_offset) - chunk->attr_start_offset);
+	if (!_bte_stream_read(m_attr_stream, chunk->attr_start_offset,
+			      chunk->attr.data(), chunk->attr.size()))
+		return false;
+
+	*row = r;
+	return true;
+}
+
+/* Rewrap the rows of @chunk to @columns. This runs on worker threads, so it
+ * must only access the chunk.
+ * @tail_attr_change is what's in effect beyond the end of the attr stream. */
 void
-Ring::rewrap(column_t columns,
-             BteVisualPosition** markers)
+Ring::rewrap_chunk(RewrapChunk* chunk,
+                   column_t columns,
+                   CellAttrChange const* tail_attr_change,
+                   CellTextOffset const* marker_text_offsets,
+                   int num_markers)
 {
-	row_t old_row_index, new_row_index;
+	row_t old_row_index, new_row_index = 0;
+	row_t num_rows = chunk->records.size();
 	int i;
-	int num_markers = 0;
-	CellTextOffset *marker_text_offsets;
-	BteVisualPosition *new_markers;
 	RowRecord old_record;
 	CellAttrChange attr_change;
-	BteStream *new_row_stream;
 	gsize paragraph_start_text_offset;
 	gsize paragraph_end_text_offset;
 	gsize paragraph_len;  /* excluding trailing '\n' */
 	gsize attr_offset;
-	gsize old_ring_end;
+	gsize end_text_offset = chunk->text_start_offset + chunk->text.size();
 
-	if (G_UNLIKELY(length() == 0))
-		return;
-	_bte_debug_print(BTE_DEBUG_RING, "Ring before rewrapping:\n");
-        validate();
-	new_row_stream = _bte_file_stream_new();
-
-	/* Freeze everything, because rewrapping is really complicated and we don't want to
-	   duplicate the code for frozen and thawed rows. */
-	while (m_writable < m_end)
-		freeze_one_row();
-
-	/* For markers given as (row,col) pairs find their offsets in the text stream.
-	   This code requires that the rows are already frozen. */
-	while (markers[num_markers] != nullptr)
-		num_markers++;
-	marker_text_offsets = (CellTextOffset *) g_malloc(num_markers * sizeof (marker_text_offsets[0]));
-	new_markers = (BteVisualPosition *) g_malloc(num_markers * sizeof (new_markers[0]));
-	for (i = 0; i < num_markers; i++) {
-		/* Convert visual column into byte offset */
-		if (!frozen_row_column_to_text_offset(markers[i]->row, markers[i]->col, &marker_text_offsets[i]))
-			goto err;
-		new_markers[i].row = new_markers[i].col = -1;
-		_bte_debug_print(BTE_DEBUG_RING,
-				"Marker #%d old coords:  row %ld  col %ld  ->  text_offset %" G_GSIZE_FORMAT " fragment_cells %d  eol_cells %d\n",
-				i, markers[i]->row, markers[i]->col, marker_text_offsets[i].text_offset,
-				marker_text_offsets[i].fragment_cells, marker_text_offsets[i].eol_cells);
-	}
+	auto read_attr_change = [&](gsize offset) {
+		if (offset + sizeof (attr_change) <= chunk->attr_start_offset + chunk->attr.size())
+			memcpy(&attr_change, chunk->attr.data() + offset - chunk->attr_start_offset, sizeof (attr_change));
+		else
+			attr_change = *tail_attr_change;
+	};
 
 	/* Prepare for rewrapping */
-	if (!read_row_record(&old_record, m_start))
-		goto err;
+	old_record = chunk->records[0];
 	paragraph_start_text_offset = old_record.text_start_offset;
-	paragraph_end_text_offset = _bte_stream_head(m_text_stream);  /* initialized to silence gcc */
-	new_row_index = 0;
+	paragraph_end_text_offset = end_text_offset;  /* initialized to silence gcc */
 
 	attr_offset = old_record.attr_start_offset;
-	if (!_bte_stream_read(m_attr_stream, attr_offset, (char *) &attr_change, sizeof (attr_change))) {
-                _attrcpy(&attr_change.attr, &m_last_attr);
-                attr_change.attr.hyperlink_length = hyperlink_get(m_last_attr.hyperlink_idx)->len;
-		attr_change.text_end_offset = _bte_stream_head(m_text_stream);
-	}
+	read_attr_change(attr_offset);
 
-	old_row_index = m_start + 1;
-	while (paragraph_start_text_offset < _bte_stream_head(m_text_stream)) {
+	old_row_index = 1;
+	while (paragraph_start_text_offset < end_text_offset) {
 		/* Find the boundaries of the next paragraph */
 		gboolean prev_record_was_soft_wrapped = FALSE;
 		gboolean paragraph_is_ascii = TRUE;
                 guint8 paragraph_bidi_flags = old_record.bidi_flags;
+		gboolean paragraph_is_carried = paragraph_start_text_offset == chunk->text_start_offset &&
+						chunk->carry_in.pending;
 		gsize text_offset = paragraph_start_text_offset;
 		RowRecord new_record;
 		column_t col = 0;
 
-		_bte_debug_print(BTE_DEBUG_RING,
-				"  Old paragraph:  row %lu  (text_offset %" G_GSIZE_FORMAT ")  up to (exclusive)  ",  /* no '\n' */
-                                 old_row_index - 1,
-                                 paragraph_start_text_offset);
-		while (old_row_index <= m_end) {
+		while (old_row_index <= num_rows) {
 			prev_record_was_soft_wrapped = old_record.soft_wrapped;
 			paragraph_is_ascii = paragraph_is_ascii && old_record.is_ascii;
-			if (G_LIKELY (old_row_index < m_end)) {
-				if (!read_row_record(&old_record, old_row_index))
-					goto err;
+			if (G_LIKELY (old_row_index < num_rows)) {
+				old_record = chunk->records[old_row_index];
 				paragraph_end_text_offset = old_record.text_start_offset;
 			} else {
-				paragraph_end_text_offset = _bte_stream_head (m_text_stream);
+				paragraph_end_text_offset = end_text_offset;
 			}
 			old_row_index++;
 			if (!prev_record_was_soft_wrapped)
@@ -1242,28 +1859,25 @@ Ring::rewrap(column_t columns,
 		paragraph_len = paragraph_end_text_offset - paragraph_start_text_offset;
 		if (!prev_record_was_soft_wrapped)  /* The last paragraph can be soft wrapped! */
 			paragraph_len--;  /* Strip trailing '\n' */
-		_bte_debug_print(BTE_DEBUG_RING,
-				"row %lu  (text_offset %" G_GSIZE_FORMAT ")%s  len %" G_GSIZE_FORMAT "  is_ascii %d\n",
-                                 old_row_index - 1,
-                                 paragraph_end_text_offset,
-				prev_record_was_soft_wrapped ? "  soft_wrapped" : "",
-				paragraph_len, paragraph_is_ascii);
 
 		/* Wrap the paragraph */
 		if (attr_change.text_end_offset <= text_offset) {
 			/* Attr change at paragraph boundary, advance to next attr. */
                         attr_offset += sizeof (attr_change) + attr_change.attr.hyperlink_length + 2;
-			if (!_bte_stream_read(m_attr_stream, attr_offset, (char *) &attr_change, sizeof (attr_change))) {
-                                _attrcpy(&attr_change.attr, &m_last_attr);
-                                attr_change.attr.hyperlink_length = hyperlink_get(m_last_attr.hyperlink_idx)->len;
-				attr_change.text_end_offset = _bte_stream_head(m_text_stream);
-			}
+			read_attr_change(attr_offset);
+		}
+		if (paragraph_is_carried) {
+			/* Go on filling the previous chunk's last row */
+			new_record = chunk->carry_in.record;
+			new_record.is_ascii = new_record.is_ascii && paragraph_is_ascii;
+			col = chunk->carry_in.col;
+		} else {
+			memset(&new_record, 0, sizeof (new_record));
+			new_record.text_start_offset = text_offset;
+			new_record.attr_start_offset = attr_offset;
+			new_record.is_ascii = paragraph_is_ascii;
+			new_record.bidi_flags = paragraph_bidi_flags;
 		}
-		memset(&new_record, 0, sizeof (new_record));
-		new_record.text_start_offset = text_offset;
-		new_record.attr_start_offset = attr_offset;
-		new_record.is_ascii = paragraph_is_ascii;
-                new_record.bidi_flags = paragraph_bidi_flags;
 
 		while (paragraph_len > 0) {
 			/* Wrap one continuous run of identical attributes within the paragraph. */
@@ -1271,11 +1885,7 @@ Ring::rewrap(column_t columns,
 			if (attr_change.text_end_offset <= text_offset) {
 				/* Attr change at line boundary, advance to next attr. */
                                 attr_offset += sizeof (attr_change) + attr_change.attr.hyperlink_length + 2;
-				if (!_bte_stream_read(m_attr_stream, attr_offset, (char *) &attr_change, sizeof (attr_change))) {
-                                        _attrcpy(&attr_change.attr, &m_last_attr);
-                                        attr_change.attr.hyperlink_length = hyperlink_get(m_last_attr.hyperlink_idx)->len;
-					attr_change.text_end_offset = _bte_stream_head(m_text_stream);
-				}
+				read_attr_change(attr_offset);
 			}
 			runlength = MIN(paragraph_len, attr_change.text_end_offset - text_offset);
 
@@ -1288,27 +1898,21 @@ Ring::rewrap(column_t columns,
 					if (col >= columns - attr_change.attr.columns() + 1) {
 						/* Wrap now, write the soft wrapped row's record */
 						new_record.soft_wrapped = 1;
-						_bte_stream_append(new_row_stream, (char const* ) &new_record, sizeof (new_record));
-						_bte_debug_print(BTE_DEBUG_RING,
-								"    New row %ld  text_offset %" G_GSIZE_FORMAT "  attr_offset %" G_GSIZE_FORMAT "  soft_wrapped\n",
-								new_row_index,
-								new_record.text_start_offset, new_record.attr_start_offset);
+						chunk->new_records.push_back(new_record);
 						for (i = 0; i < num_markers; i++) {
 							if (G_UNLIKELY (marker_text_offsets[i].text_offset >= new_record.text_start_offset &&
-									marker_text_offsets[i].text_offset < text_offset)) {
-								new_markers[i].row = new_row_index;
-								_bte_debug_print(BTE_DEBUG_RING,
-										"      Marker #%d will be here in row %lu\n", i, new_row_index);
-							}
+									marker_text_offsets[i].text_offset < text_offset))
+								chunk->markers.emplace_back(i, new_row_index);
 						}
 						new_row_index++;
 						new_record.text_start_offset = text_offset;
 						new_record.attr_start_offset = attr_offset;
+						new_record.is_ascii = paragraph_is_ascii;
 						col = 0;
 					}
 					if (paragraph_is_ascii) {
 						/* Shortcut for quickly wrapping ASCII (excluding TAB) text.
-						   Don't read text_stream, and advance by a whole row of characters. */
+						   Don't look at the text, and advance by a whole row of characters. */
 						int len = MIN(runlength, (gsize) (columns - col));
 						col += len;
 						text_offset += len;
@@ -1316,14 +1920,13 @@ Ring::rewrap(column_t columns,
 						runlength -= len;
 					} else {
 						/* Process one character only. */
-						char textbuf[6];  /* fits at least one UTF-8 character */
+						char const* textbuf;
 						int textbuf_len;
 						col += attr_change.attr.columns();
 						/* Find beginning of next UTF-8 character */
 						text_offset++; paragraph_len--; runlength--;
-						textbuf_len = MIN(runlength, sizeof (textbuf));
-						if (!_bte_stream_read(m_text_stream, text_offset, textbuf, textbuf_len))
-							goto err;
+						textbuf = chunk->text.data() + text_offset - chunk->text_start_offset;
+						textbuf_len = MIN(runlength, 6);  /* fits at least one UTF-8 character */
 						for (i = 0; i < textbuf_len && (textbuf[i] & 0xC0) == 0x80; i++) {
 							text_offset++; paragraph_len--; runlength--;
 						}
@@ -1332,25 +1935,179 @@ Ring::rewrap(column_t columns,
 			}
 		}
 
+		if (paragraph_end_text_offset == end_text_offset && chunk->continues) {
+			/* The paragraph goes on in the next chunk, and so does its last row. */
+			chunk->carry_out.pending = true;
+			chunk->carry_out.record = new_record;
+			chunk->carry_out.col = col;
+			break;
+		}
+
 		/* Write the record of the paragraph's last row. */
 		/* Hard wrapped, except maybe at the end of the very last paragraph */
 		new_record.soft_wrapped = prev_record_was_soft_wrapped;
-		_bte_stream_append(new_row_stream, (char const* ) &new_record, sizeof (new_record));
-		_bte_debug_print(BTE_DEBUG_RING,
-				"    New row %ld  text_offset %" G_GSIZE_FORMAT "  attr_offset %" G_GSIZE_FORMAT "\n",
-				new_row_index,
-				new_record.text_start_offset, new_record.attr_start_offset);
+		chunk->new_records.push_back(new_record);
 		for (i = 0; i < num_markers; i++) {
 			if (G_UNLIKELY (marker_text_offsets[i].text_offset >= new_record.text_start_offset &&
-					marker_text_offsets[i].text_offset < paragraph_end_text_offset)) {
-				new_markers[i].row = new_row_index;
-				_bte_debug_print(BTE_DEBUG_RING,
-						"      Marker #%d will be here in row %lu\n", i, new_row_index);
-			}
+					marker_text_offsets[i].text_offset < paragraph_end_text_offset))
+				chunk->markers.emplace_back(i, new_row_index);
 		}
 		new_row_index++;
 		paragraph_start_text_offset = paragraph_end_text_offset;
 	}
+}
+
+/* Rewrap the frozen rows starting at *@row, which is treated as the start of a
+ * paragraph, up to @end_row (exclusive) to @columns. The new row records are
+ * appended to @new_row_stream, numbered from *@new_row_index on.
+ * Stops at the first paragraph boundary at least @max_rows rows after *@row.
+ * On return, *@row is the old row where processing stopped, and
+ * *@new_row_index is the number of the next new row.
+ * Markers whose text offset is within the rewrapped text get their new row
+ * assigned in @new_markers.
+ *
+ * Paragraphs can be rewrapped independently of each other, so the rows are
+ * split into paragraph aligned chunks which are rewrapped concurrently on the
+ * shared worker threads. Only the wrapping itself is done on the worker
+ * threads, reading the streams must happen here. A chunk holding the start of
+ * an overlong paragraph ends its batch, the rest of the paragraph is
+ * rewrapped in the next one, so a paragraph straddling @max_rows is finished
+ * before returning. */
+bool
+Ring::rewrap_paragraphs(column_t columns,
+                        row_t* row,
+                        row_t end_row,
+                        row_t max_rows,
+                        BteStream* new_row_stream,
+                        row_t* new_row_index,
+                        CellTextOffset const* marker_text_offsets,
+                        BteVisualPosition* new_markers,
+                        int num_markers)
+{
+	row_t start_row = *row;
+	CellAttrChange tail_attr_change;
+	auto chunks = std::vector<RewrapChunk>(CLAMP(g_get_num_processors(), 1, BTE_REWRAP_THREADS_MAX));
+	auto carry = RewrapChunk::Carry{};
+	unsigned int i, num_chunks;
+
+	struct {
+		std::vector<RewrapChunk>* chunks;
+		column_t columns;
+		CellAttrChange const* tail_attr_change;
+		CellTextOffset const* marker_text_offsets;
+		int num_markers;
+	} batch{&chunks, columns, &tail_attr_change, marker_text_offsets, num_markers};
+
+	_attrcpy(&tail_attr_change.attr, &m_last_attr);
+	tail_attr_change.attr.hyperlink_length = hyperlink_get(m_last_attr.hyperlink_idx)->len;
+	tail_attr_change.text_end_offset = _bte_stream_head(m_text_stream);
+
+	while (*row < end_row && (*row - start_row < max_rows || carry.pending)) {
+		/* Copy the next chunks out of the streams... */
+		for (num_chunks = 0; num_chunks < chunks.size() && *row < end_row; num_chunks++) {
+			if (num_chunks > 0 &&
+			    (chunks[num_chunks - 1].continues || *row - start_row >= max_rows))
+				break;
+			if (!load_rewrap_chunk(&chunks[num_chunks], row, end_row,
+					       *row - start_row < max_rows ? max_rows - (*row - start_row) : 0))
+				return false;
+			chunks[num_chunks].carry_in = num_chunks == 0 ? carry : RewrapChunk::Carry{};
+		}
+
+		_bte_debug_print(BTE_DEBUG_RING,
+				"  Rewrapping old rows %lu..%lu in %u chunks\n",
+				start_row, *row, num_chunks);
+
+		/* ... rewrap them in parallel... */
+		_bte_run_parallel(num_chunks,
+				  [](gpointer data, unsigned int task) {
+					  auto b = reinterpret_cast<decltype(batch)*>(data);
+					  rewrap_chunk(&(*b->chunks)[task], b->columns, b->tail_attr_change,
+						       b->marker_text_offsets, b->num_markers);
+				  },
+				  &batch);
+		carry = chunks[num_chunks - 1].carry_out;
+
+		/* ... and concatenate the results. */
+		for (i = 0; i < num_chunks; i++) {
+			auto const& chunk = chunks[i];
+			for (auto const& marker : chunk.markers) {
+				new_markers[marker.first].row = *new_row_index + marker.second;
+				_bte_debug_print(BTE_DEBUG_RING,
+						"      Marker #%d will be here in row %lu\n",
+						marker.first, *new_row_index + marker.second);
+			}
+			_bte_stream_append(new_row_stream,
+					   (char const* ) chunk.new_records.data(),
+					   chunk.new_records.size() * sizeof (RowRecord));
+			*new_row_index += chunk.new_records.size();
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Ring::rewrap:
+ * @columns: new number of columns
+ * @markers: 0-terminated array of #BteVisualPosition
+ *
+ * Reflow the @ring to match the new number of @columns.
+ * For all @markers, find the cell at that position and update them to
+ * reflect the cell's new position.
+ */
+/* See ../doc/rewrap.txt for design and implementation details. */
+void
+Ring::rewrap(column_t columns,
+             BteVisualPosition** markers)
+{
+	row_t old_row_index, new_row_index;
+	int i;
+	int num_markers = 0;
+	CellTextOffset *marker_text_offsets;
+	BteVisualPosition *new_markers;
+	BteStream *new_row_stream;
+	gsize old_ring_end;
+
+	/* Rewrapping everything supersedes a lazy rewrap in progress. */
+	rewrap_cancel();
+
+	if (G_UNLIKELY(length() == 0))
+		return;
+        _BTE_TRACE_SCOPE(ring_rewrap, columns, length());
+	_bte_debug_print(BTE_DEBUG_RING, "Ring before rewrapping:\n");
+        validate();
+	new_row_stream = new_stream();
+
+	/* Freeze everything, because rewrapping is really complicated and we don't want to
+	   duplicate the code for frozen and thawed rows. */
+	while (m_writable < m_end)
+		freeze_one_row();
+
+	/* For markers given as (row,col) pairs find their offsets in the text stream.
+	   This code requires that the rows are already frozen. */
+	while (markers[num_markers] != nullptr)
+		num_markers++;
+	marker_text_offsets = (CellTextOffset *) g_malloc(num_markers * sizeof (marker_text_offsets[0]));
+	new_markers = (BteVisualPosition *) g_malloc(num_markers * sizeof (new_markers[0]));
+	for (i = 0; i < num_markers; i++) {
+		/* Convert visual column into byte offset */
+		if (!frozen_row_column_to_text_offset(markers[i]->row, markers[i]->col, &marker_text_offsets[i]))
+			goto err;
+		new_markers[i].row = new_markers[i].col = -1;
+		_bte_debug_print(BTE_DEBUG_RING,
+				"Marker #%d old coords:  row %ld  col %ld  ->  text_offset %" G_GSIZE_FORMAT " fragment_cells %d  eol_cells %d\n",
+				i, markers[i]->row, markers[i]->col, marker_text_offsets[i].text_offset,
+				marker_text_offsets[i].fragment_cells, marker_text_offsets[i].eol_cells);
+	}
+
+	/* Rewrap all the paragraphs */
+	old_row_index = m_start;
+	new_row_index = 0;
+	if (!rewrap_paragraphs(columns, &old_row_index, m_end, (row_t) -1,
+	                       new_row_stream, &new_row_index,
+	                       marker_text_offsets, new_markers, num_markers))
+		goto err;
 
 	/* Update the ring. */
 	old_ring_end = m_end;
@@ -1390,11 +2147,303 @@ err:
 			"Error while rewrapping\n");
 	g_assert_not_reached();
 #endif
+	if (new_row_stream != m_row_stream)
+		g_object_unref(new_row_stream);
+	g_free(marker_text_offsets);
+	g_free(new_markers);
+}
+
+/**
+ * Ring::rewrap_from:
+ * @columns: new number of columns
+ * @position: the first row that needs to be rewrapped right away
+ * @markers: 0-terminated array of #BteVisualPosition
+ *
+ * Like rewrap(), but only reflows the paragraphs from the one containing
+ * @position on, e.g. the top of the viewport. The rows above keep their old
+ * wrapping and their row numbers, so that they can still be displayed; they
+ * are rewrapped bit by bit by rewrap_step(), and the result is swapped in by
+ * rewrap_commit().
+ *
+ * @markers above the reflowed paragraphs are not changed.
+ */
+void
+Ring::rewrap_from(column_t columns,
+                  row_t position,
+                  BteVisualPosition** markers)
+{
+	row_t old_row_index, new_row_index, old_ring_end;
+	int i;
+	int num_markers = 0;
+	CellTextOffset *marker_text_offsets;
+	BteVisualPosition *new_markers;
+	BteStream *new_row_stream;
+	RowRecord record;
+
+	if (G_UNLIKELY(length() == 0))
+		return;
+        _BTE_TRACE_SCOPE(ring_rewrap_from, columns, position);
+
+	while (m_writable < m_end)
+		freeze_one_row();
+
+	/* Only rewrap whole paragraphs: find the start of the one containing position. */
+	position = CLAMP(position, m_start, m_end - 1);
+	while (position > m_start &&
+	       read_row_record(&record, position - 1) &&
+	       record.soft_wrapped)
+		position--;
+
+	if (position == m_start) {
+		rewrap(columns, markers);
+		return;
+	}
+
+	_bte_debug_print(BTE_DEBUG_RING, "Ring before rewrapping from row %lu:\n", position);
+        validate();
+	new_row_stream = new_stream();
+	/* Number the new records just like the rows they are going to replace */
+	_bte_stream_reset(new_row_stream, position * sizeof (record));
+
+	while (markers[num_markers] != nullptr)
+		num_markers++;
+	marker_text_offsets = g_new0(CellTextOffset, num_markers);
+	new_markers = (BteVisualPosition *) g_malloc(num_markers * sizeof (new_markers[0]));
+	for (i = 0; i < num_markers; i++) {
+		new_markers[i].row = new_markers[i].col = -1;
+		if (markers[i]->row < (long) position) {
+			/* Not rewrapped now; an offset beyond all text matches no row */
+			marker_text_offsets[i].text_offset = G_MAXSIZE;
+			continue;
+		}
+		if (!frozen_row_column_to_text_offset(markers[i]->row, markers[i]->col, &marker_text_offsets[i]))
+			goto err;
+	}
+
+	old_row_index = position;
+	new_row_index = position;
+	if (!rewrap_paragraphs(columns, &old_row_index, m_end, (row_t) -1,
+	                       new_row_stream, &new_row_index,
+	                       marker_text_offsets, new_markers, num_markers))
+		goto err;
+
+	/* Replace the records of the reflowed rows */
+	_bte_stream_truncate(m_row_stream, position * sizeof (record));
+	for (old_row_index = position; old_row_index < new_row_index; old_row_index++) {
+		if (!_bte_stream_read(new_row_stream, old_row_index * sizeof (record), (char *) &record, sizeof (record)))
+			goto err;
+		append_row_record(&record, old_row_index);
+	}
 	g_object_unref(new_row_stream);
+	new_row_stream = nullptr;
+
+	old_ring_end = m_end;
+	m_writable = m_end = new_row_index;
+	if (m_end - m_start > m_max)
+		m_start = m_end - m_max;
+	m_cached_row_num = (row_t) -1;
+
+	for (i = 0; i < num_markers; i++) {
+		if (markers[i]->row < (long) position)
+			continue;
+		if (new_markers[i].row == -1)
+			new_markers[i].row = markers[i]->row - old_ring_end + m_end;
+		if (!frozen_row_text_offset_to_column(new_markers[i].row, &marker_text_offsets[i], &new_markers[i].col))
+			goto err;
+		markers[i]->row = new_markers[i].row;
+		markers[i]->col = new_markers[i].col;
+	}
+	g_free(marker_text_offsets);
+	g_free(new_markers);
+
+	/* Leave the rows above to the background */
+	m_rewrap_columns = columns;
+	m_rewrap_pending_end = position;
+	rewrap_restart();
+	if (m_start >= m_rewrap_pending_end)
+		rewrap_cancel();
+
+	_bte_debug_print(BTE_DEBUG_RING, "Ring after rewrapping from row %lu:\n", position);
+        validate();
+	return;
+
+err:
+#ifdef BTE_DEBUG
+	_bte_debug_print(BTE_DEBUG_RING,
+			"Error while rewrapping\n");
+	g_assert_not_reached();
+#endif
+	if (new_row_stream != nullptr)
+		g_object_unref(new_row_stream);
 	g_free(marker_text_offsets);
 	g_free(new_markers);
 }
 
+void
+Ring::rewrap_restart()
+{
+	if (m_rewrap_stream == nullptr)
+		m_rewrap_stream = new_stream();
+	_bte_stream_reset(m_rewrap_stream, 0);
+	m_rewrap_row = m_start;
+	m_rewrap_new_rows = 0;
+}
+
+void
+Ring::rewrap_cancel()
+{
+	if (m_rewrap_stream != nullptr) {
+		g_object_unref(m_rewrap_stream);
+		m_rewrap_stream = nullptr;
+	}
+	m_rewrap_pending_end = 0;
+}
+
+/**
+ * Ring::rewrap_step:
+ * @max_rows: the number of old rows to rewrap, rounded up to whole paragraphs
+ *
+ * Continues rewrapping the rows left behind by rewrap_from().
+ *
+ * Returns: %true if there's more to do, %false if rewrap_commit() can be
+ *   called without further rewrapping.
+ */
+bool
+Ring::rewrap_step(row_t max_rows)
+{
+	if (!rewrap_pending())
+		return false;
+        _BTE_TRACE_SCOPE(ring_rewrap_step, m_rewrap_row, max_rows);
+
+	if (m_start >= m_rewrap_pending_end) {
+		/* The old-wrapped rows have all scrolled out meanwhile */
+		rewrap_cancel();
+		return false;
+	}
+
+	if (m_rewrap_row < m_start) {
+		/* So did all the rows rewrapped so far */
+		rewrap_restart();
+	}
+
+	if (m_rewrap_row < m_rewrap_pending_end &&
+	    !rewrap_paragraphs(m_rewrap_columns, &m_rewrap_row, m_rewrap_pending_end, max_rows,
+	                       m_rewrap_stream, &m_rewrap_new_rows,
+	                       nullptr, nullptr, 0)) {
+		_bte_debug_print(BTE_DEBUG_RING,
+				"Error while rewrapping, keeping the old wrapping\n");
+		rewrap_cancel();
+		return false;
+	}
+
+	return m_rewrap_row < m_rewrap_pending_end;
+}
+
+/**
+ * Ring::rewrap_commit:
+ * @markers: 0-terminated array of #BteVisualPosition
+ *
+ * Finishes the rewrapping started by rewrap_from(), and replaces the rows
+ * that still have their old wrapping by the rewrapped ones. This renumbers
+ * all the rows, so just as with rewrap(), all @markers are updated to
+ * reflect the cell's new position.
+ */
+void
+Ring::rewrap_commit(BteVisualPosition** markers)
+{
+	row_t first, row, pending_end, num_new_rows, old_ring_end;
+	int i;
+	int num_markers = 0;
+	CellTextOffset *marker_text_offsets;
+	BteStream *new_row_stream;
+	RowRecord start_record, record;
+
+	rewrap_step((row_t) -1);
+	if (!rewrap_pending())
+		return;
+
+	_bte_debug_print(BTE_DEBUG_RING, "Ring before committing the rewrap of rows up to %lu:\n",
+			 m_rewrap_pending_end);
+        validate();
+
+	while (m_writable < m_end)
+		freeze_one_row();
+
+	pending_end = m_rewrap_pending_end;
+	new_row_stream = new_stream();
+
+	while (markers[num_markers] != nullptr)
+		num_markers++;
+	marker_text_offsets = g_new0(CellTextOffset, num_markers);
+	for (i = 0; i < num_markers; i++) {
+		if (markers[i]->row >= (long) pending_end)
+			continue;
+		if (!frozen_row_column_to_text_offset(markers[i]->row, markers[i]->col, &marker_text_offsets[i]))
+			goto err;
+	}
+
+	/* m_start may have advanced since the background rewrap started, skip
+	   the new rows before it. The one it falls into, if any, is cut there. */
+	if (!read_row_record(&start_record, m_start))
+		goto err;
+	first = find_row_by_text_offset(m_rewrap_stream, 0, m_rewrap_new_rows,
+					start_record.text_start_offset);
+	for (row = first; row < m_rewrap_new_rows; row++) {
+		if (!_bte_stream_read(m_rewrap_stream, row * sizeof (record), (char *) &record, sizeof (record)))
+			goto err;
+		if (G_UNLIKELY (record.text_start_offset < start_record.text_start_offset)) {
+			record.text_start_offset = start_record.text_start_offset;
+			record.attr_start_offset = start_record.attr_start_offset;
+		}
+		_bte_stream_append(new_row_stream, (char const* ) &record, sizeof (record));
+	}
+	num_new_rows = m_rewrap_new_rows - first;
+
+	/* The rows below were rewrapped already, only their numbers change */
+	for (row = pending_end; row < m_end; row++) {
+		if (!read_row_record(&record, row))
+			goto err;
+		_bte_stream_append(new_row_stream, (char const* ) &record, sizeof (record));
+	}
+
+	/* Update the ring. */
+	old_ring_end = m_end;
+	g_object_unref(m_row_stream);
+	m_row_stream = new_row_stream;
+	m_writable = m_end = num_new_rows + old_ring_end - pending_end;
+	m_start = 0;
+	if (m_end > m_max)
+		m_start = m_end - m_max;
+	m_cached_row_num = (row_t) -1;
+	rewrap_cancel();
+
+	for (i = 0; i < num_markers; i++) {
+		if (markers[i]->row >= (long) pending_end) {
+			markers[i]->row = markers[i]->row - pending_end + num_new_rows;
+			continue;
+		}
+		markers[i]->row = find_row_by_text_offset(m_row_stream, 0, num_new_rows,
+							  marker_text_offsets[i].text_offset);
+		if (!frozen_row_text_offset_to_column(markers[i]->row, &marker_text_offsets[i], &markers[i]->col))
+			goto err;
+	}
+	g_free(marker_text_offsets);
+
+	_bte_debug_print(BTE_DEBUG_RING, "Ring after committing the rewrap:\n");
+        validate();
+	return;
+
+err:
+#ifdef BTE_DEBUG
+	_bte_debug_print(BTE_DEBUG_RING,
+			"Error while rewrapping\n");
+	g_assert_not_reached();
+#endif
+	if (new_row_stream != m_row_stream)
+		g_object_unref(new_row_stream);
+	g_free(marker_text_offsets);
+	rewrap_cancel();
+}
 
 bool
 Ring::write_row(GOutputStream* stream,
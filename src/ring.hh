@@ -27,7 +27,9 @@
 
 #include "bterowdata.hh"
 #include "btestream.h"
+#include "libc-glue.hh"
 
+#include <string>
 #include <type_traits>
 
 typedef struct _BteVisualPosition {
@@ -90,14 +92,38 @@ public:
         BteRowData* append(guint8 bidi_flags);
         void remove(row_t position);
         void drop_scrollback(row_t position);
+        size_t evict(size_t bytes);
+        void trim();
         void set_visible_rows(row_t rows);
         void rewrap(column_t columns,
                     BteVisualPosition** markers);
+        void rewrap_from(column_t columns,
+                         row_t position,
+                         BteVisualPosition** markers);
+        bool rewrap_step(row_t max_rows);
+        void rewrap_commit(BteVisualPosition** markers);
+        inline bool rewrap_pending() const { return m_rewrap_stream != nullptr; }
+        inline row_t rewrap_pending_end() const { return m_rewrap_pending_end; }
         bool write_contents(GOutputStream* stream,
                             BteWriteFlags flags,
                             GCancellable* cancellable,
                             GError** error);
 
+        size_t stream_bytes() const;
+        size_t memory_bytes() const;
+
+        bool attach_session(char const* dir,
+                            column_t* columns,
+                            GError** error);
+        bool save_session(row_t end,
+                          column_t columns);
+        /* The directory of the attached session, empty if none */
+        inline auto const& session_dir() const noexcept { return m_session_dir; }
+
+        inline auto n_freezes() const noexcept { return m_n_freezes; }
+        inline auto n_thaws() const noexcept { return m_n_thaws; }
+        inline auto const& stream_statistics() const noexcept { return m_stream_statistics; }
+
 private:
 
         #ifdef BTE_DEBUG
@@ -108,6 +134,8 @@ private:
 
         inline BteRowData* get_writable_index(row_t position) const { return &m_array[position & m_mask]; }
 
+        BteStream* new_stream();
+
         void hyperlink_gc();
         hyperlink_idx_t get_hyperlink_idx_no_update_current(char const* hyperlink);
 
@@ -126,6 +154,18 @@ private:
 
         static_assert(std::is_pod<RowRecord>::value, "Ring::RowRecord is not POD");
 
+        /* The header of a saved session, see attach_session() */
+        typedef struct _SessionHeader {
+                char magic[8];
+                guint32 version;
+                guint32 row_record_size;
+                guint32 attr_change_size;
+                guint32 columns;
+                guint64 start, end;
+                guint64 last_attr_text_start_offset;
+                BteStreamSession streams[3];  /* row, text and attr stream */
+        } SessionHeader;
+
         /* Represents a cell position, see ../doc/rewrap.txt */
         typedef struct _CellTextOffset {
                 size_t text_offset;    /* byte offset in text_stream (or perhaps beyond) */
@@ -158,6 +198,32 @@ private:
         bool frozen_row_text_offset_to_column(row_t position,
                                               CellTextOffset const* offset,
                                               column_t* column);
+        row_t find_row_by_text_offset(BteStream* row_stream,
+                                      row_t first,
+                                      row_t end,
+                                      size_t text_offset);
+
+        struct RewrapChunk;
+        bool load_rewrap_chunk(RewrapChunk* chunk,
+                               row_t* row,
+                               row_t end_row,
+                               row_t max_rows);
+        static void rewrap_chunk(RewrapChunk* chunk,
+                                 column_t columns,
+                                 CellAttrChange const* tail_attr_change,
+                                 CellTextOffset const* marker_text_offsets,
+                                 int num_markers);
+        bool rewrap_paragraphs(column_t columns,
+                               row_t* row,
+                               row_t end_row,
+                               row_t max_rows,
+                               BteStream* new_row_stream,
+                               row_t* new_row_index,
+                               CellTextOffset const* marker_text_offsets,
+                               BteVisualPosition* new_markers,
+                               int num_markers);
+        void rewrap_restart();
+        void rewrap_cancel();
 
         bool write_row(GOutputStream* stream,
                        BteRowData* row,
@@ -174,6 +240,8 @@ private:
         void discard_one_row();
         void maybe_discard_one_row();
 
+        gsize append_attr_change(gsize text_offset,
+                                 gboolean& froze_hyperlink);
         void freeze_row(row_t position,
                         BteRowData const* row);
         void thaw_row(row_t position,
@@ -208,15 +276,32 @@ private:
          */
 	bool m_has_streams;
 	BteStream *m_attr_stream, *m_text_stream, *m_row_stream;
+        std::string m_session_dir{};  /* where the streams are, if not anonymous */
+        bte::libc::FD m_session_lock{};  /* the locked lock file in m_session_dir */
 	size_t m_last_attr_text_start_offset{0};
 	BteCellAttr m_last_attr;
 	GString *m_utf8_buffer;
 
+        /* Statistics; all streams of this ring add to m_stream_statistics */
+        uint64_t m_n_freezes{0};
+        uint64_t m_n_thaws{0};
+        BteStreamStatistics m_stream_statistics{};
+
 	BteRowData m_cached_row;
 	row_t m_cached_row_num{(row_t)-1};
 
         row_t m_visible_rows{0};  /* to keep at least a screenful of lines in memory, bug 646098 comment 12 */
 
+        /* Lazy rewrapping, see rewrap_from().
+         * Rows [m_start, m_rewrap_pending_end) still have their old wrapping; they are being
+         * rewrapped to m_rewrap_columns into m_rewrap_stream (holding m_rewrap_new_rows records),
+         * m_rewrap_row being the start of the next paragraph to process. */
+        BteStream *m_rewrap_stream{nullptr};
+        column_t m_rewrap_columns{0};
+        row_t m_rewrap_pending_end{0};
+        row_t m_rewrap_row{0};
+        row_t m_rewrap_new_rows{0};
+
         GPtrArray *m_hyperlinks;  /* The hyperlink pool. Contains GString* items.
                                    [0] points to an empty GString, [1] to [BTE_HYPERLINK_COUNT_MAX] contain the id;uri pairs. */
         char m_hyperlink_buf[BTE_HYPERLINK_TOTAL_LENGTH_MAX + 1];  /* One more hyperlink buffer to get the value if it's not placed in the pool. */
@@ -22,6 +22,7 @@
 #include "debug.h"
 #include "btedefines.hh"
 #include "bteinternal.hh"
+#include "trace.hh"
 
 using namespace bte::base;
 
@@ -67,6 +68,8 @@ RingView::pause()
         g_free (m_bidirows);
         m_bidirows_alloc_len = 0;
 
+        bidi_cache_clear();
+
         m_invalid = true;
         m_paused = true;
 }
@@ -121,6 +124,7 @@ RingView::set_width(bte::grid::column_t width)
 
         m_width = width;
         m_invalid = true;
+        bidi_cache_clear();
 }
 
 void
@@ -177,6 +181,7 @@ RingView::set_enable_bidi(bool enable_bidi)
 
         m_enable_bidi = enable_bidi;
         m_invalid = true;
+        bidi_cache_clear();
 }
 
 void
@@ -187,6 +192,66 @@ RingView::set_enable_shaping(bool enable_shaping)
 
         m_enable_shaping = enable_shaping;
         m_invalid = true;
+        bidi_cache_clear();
+}
+
+size_t
+RingView::BidiParagraphKeyHash::operator()(std::vector<uint32_t> const& key) const noexcept
+{
+        /* FNV-1a */
+        guint64 hash = 14695981039346656037ull;
+        for (auto word : key) {
+                hash ^= word;
+                hash *= 1099511628211ull;
+        }
+        return size_t(hash);
+}
+
+void
+RingView::bidi_cache_clear()
+{
+        m_bidi_cache.clear();
+        m_bidi_cache_key = {};
+}
+
+/* Run the BiDi algorithm on the paragraph between the given rows, or take
+ * its result from the cache if the same paragraph was seen recently. */
+void
+RingView::bidi_paragraph(bte::grid::row_t start, bte::grid::row_t end)
+{
+        m_bidi_cache_key.clear();
+        for (auto row = start; row < end; row++) {
+                BteRowData const* row_data = get_row(row);
+                m_bidi_cache_key.push_back(row_data->len);
+                m_bidi_cache_key.push_back(row_data->attr.bidi_flags);
+                for (int i = 0; i < row_data->len; i++) {
+                        BteCell const* cell = &row_data->cells[i];
+                        m_bidi_cache_key.push_back(cell->c);
+                        m_bidi_cache_key.push_back(cell->attr.fragment() ? 0 : cell->attr.columns());
+                }
+        }
+
+        auto it = m_bidi_cache.find(m_bidi_cache_key);
+        if (it == m_bidi_cache.end()) {
+                auto paragraph = BidiParagraph{};
+                paragraph.rows.reserve(end - start);
+                for (auto row = start; row < end; row++)
+                        paragraph.rows.push_back(std::make_unique<BidiRow>());
+                it = m_bidi_cache.emplace(m_bidi_cache_key, std::move(paragraph)).first;
+
+                m_bidi_cache_target = &it->second;
+                m_bidi_cache_target_top = start;
+                m_bidirunner->paragraph(start, end,
+                                        m_enable_bidi, m_enable_shaping);
+                m_bidi_cache_target = nullptr;
+        } else {
+                _bte_debug_print (BTE_DEBUG_RINGVIEW, "Ringview: BiDi cache hit for [%ld..%ld].\n",
+                                                      start, end - 1);
+        }
+        it->second.generation = m_bidi_cache_generation;
+
+        for (auto row = MAX(start, m_start); row < MIN(end, m_start + m_len); row++)
+                m_bidirows[row - m_start]->copy_from(*it->second.rows[row - start]);
 }
 
 void
@@ -197,6 +262,8 @@ RingView::update()
         if (m_paused)
                 resume();
 
+        _BTE_TRACE_SCOPE(ringview_update, m_start, m_len);
+
         /* Find the beginning of the topmost paragraph.
          *
          * Extract at most BTE_RINGVIEW_PARAGRAPH_LENGTH_MAX context rows.
@@ -273,6 +340,7 @@ RingView::update()
                                               m_top, m_top + m_rows_len - 1, m_rows_len);
 
         /* Loop through paragraphs of the extracted text, and do whatever we need to do on each paragraph. */
+        m_bidi_cache_generation++;
         auto top = m_top;
         row = top;
         while (row < m_top + m_rows_len) {
@@ -280,9 +348,18 @@ RingView::update()
                 if (!row_data->attr.soft_wrapped || row == m_top + m_rows_len - 1) {
                         /* Found a paragraph from @top to @row, inclusive. */
 
-                        /* Run the BiDi algorithm. */
-                        m_bidirunner->paragraph(top, row + 1,
-                                                m_enable_bidi, m_enable_shaping);
+                        /* Run the BiDi algorithm. Paragraphs that are trivially LTR (the vast
+                         * majority) are cheap to map, only cache the rest. Overlong ones are
+                         * mapped in explicit mode anyway, don't bother caching them either. */
+                        if (m_bidirunner->paragraph_is_ltr(top, row + 1,
+                                                           m_enable_bidi, m_enable_shaping)) {
+                                m_bidirunner->paragraph(top, row + 1, false, false);
+                        } else if (row + 1 - top > BTE_RINGVIEW_PARAGRAPH_LENGTH_MAX) {
+                                m_bidirunner->paragraph(top, row + 1,
+                                                        m_enable_bidi, m_enable_shaping);
+                        } else {
+                                bidi_paragraph(top, row + 1);
+                        }
 
                         /* Doing syntax highlighting etc. come here in the future. */
 
@@ -291,6 +368,17 @@ RingView::update()
                 row++;
         }
 
+        /* Forget the paragraphs that are no longer displayed, but only once there are
+         * plenty of them, so that scrolling back and forth can reuse them. */
+        if (G_UNLIKELY (m_bidi_cache.size() > BTE_RINGVIEW_BIDI_CACHE_SIZE_MAX)) {
+                for (auto it = m_bidi_cache.begin(); it != m_bidi_cache.end(); ) {
+                        if (it->second.generation != m_bidi_cache_generation)
+                                it = m_bidi_cache.erase(it);
+                        else
+                                ++it;
+                }
+        }
+
         m_invalid = false;
 }
 
@@ -305,9 +393,13 @@ BidiRow const* RingView::get_bidirow(bte::grid::row_t row) const
 }
 
 /* For internal use by BidiRunner. Get where the BiDi mapping for the given row
- * needs to be stored, of nullptr if it's a context row. */
+ * needs to be stored, of nullptr if it's a context row. When computing a paragraph
+ * for the cache, context rows are stored too. */
 BidiRow* RingView::get_bidirow_writable(bte::grid::row_t row) const
 {
+        if (m_bidi_cache_target != nullptr)
+                return m_bidi_cache_target->rows[row - m_bidi_cache_target_top].get();
+
         if (row < m_start || row >= m_start + m_len)
                 return nullptr;
 
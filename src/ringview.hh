@@ -20,6 +20,10 @@
 
 #include <glib.h>
 
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include "bidi.hh"
 #include "ring.hh"
 #include "bterowdata.hh"
@@ -46,7 +50,9 @@ class BidiRunner;
  * Ring) are also taken into account up to the next hard newline or a safety limit.
  *
  * Currently RingView is used for BiDi: to figure out which logical character is
- * mapped to which visual position.
+ * mapped to which visual position. The BiDi mapping of recently displayed paragraphs
+ * is cached, keyed by their contents, so that it's not recomputed on every update
+ * (e.g. when scrolling, or when the output only touches some other paragraphs).
  *
  * Future possible uses include "highlight all" for the search match, and
  * syntax highlighting. URL autodetection might also be ported to this
@@ -106,8 +112,30 @@ private:
         bool m_invalid{true};
         bool m_paused{true};
 
+        /* The BiDi cache. The key consists of each row's length and BiDi flags,
+         * followed by each cell's character and width. The cached mapping is
+         * only valid for the current width and BiDi / shaping settings. */
+        struct BidiParagraphKeyHash {
+                size_t operator()(std::vector<uint32_t> const& key) const noexcept;
+        };
+        struct BidiParagraph {
+                std::vector<std::unique_ptr<BidiRow>> rows;
+                unsigned generation{0};  /* the last update() that used this paragraph */
+        };
+        std::unordered_map<std::vector<uint32_t>, BidiParagraph, BidiParagraphKeyHash> m_bidi_cache;
+        std::vector<uint32_t> m_bidi_cache_key;
+        unsigned m_bidi_cache_generation{0};
+
+        /* While running BidiRunner on a paragraph that's to be cached, this is where
+         * the mapping of all its rows (including context rows) is stored. */
+        BidiParagraph *m_bidi_cache_target{nullptr};
+        bte::grid::row_t m_bidi_cache_target_top{0};
+
         void resume();
 
+        void bidi_cache_clear();
+        void bidi_paragraph(bte::grid::row_t start, bte::grid::row_t end);
+
         BidiRow* get_bidirow_writable(bte::grid::row_t row) const;
 };
 
@@ -0,0 +1,152 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <glib.h>
+
+#include "scrollback-budget.hh"
+
+using namespace bte::base;
+
+class TestClient : public ScrollbackBudget::Client {
+public:
+        TestClient(uint64_t disk,
+                   uint64_t memory)
+                : m_disk{disk},
+                  m_memory{memory}
+        {
+        }
+
+        void scrollback_usage(uint64_t& disk,
+                              uint64_t& memory) const noexcept override
+        {
+                disk = m_disk;
+                memory = m_memory;
+        }
+
+        /* Evicts in units of 100 bytes, like whole rows */
+        uint64_t evict_scrollback(uint64_t bytes) override
+        {
+                auto const released = std::min(m_disk, (bytes + 99) / 100 * 100);
+                m_disk -= released;
+                ++m_n_evictions;
+                return released;
+        }
+
+        uint64_t m_disk;
+        uint64_t m_memory;
+        unsigned m_n_evictions{0};
+};
+
+static void
+test_budget_usage(void)
+{
+        auto budget = ScrollbackBudget{};
+        auto a = TestClient{1000, 10};
+        auto b = TestClient{2000, 20};
+        budget.add(&a);
+        budget.add(&b);
+
+        uint64_t disk, memory;
+        budget.usage(disk, memory);
+        g_assert_cmpuint(disk, ==, 3000);
+        g_assert_cmpuint(memory, ==, 30);
+
+        budget.remove(&a);
+        budget.usage(disk, memory);
+        g_assert_cmpuint(disk, ==, 2000);
+        g_assert_cmpuint(memory, ==, 20);
+}
+
+static void
+test_budget_unlimited(void)
+{
+        auto budget = ScrollbackBudget{};
+        auto a = TestClient{1000000, 1000};
+        budget.add(&a);
+
+        budget.enforce();
+        budget.processed(ScrollbackBudget::kEnforceInterval);
+        g_assert_cmpuint(a.m_n_evictions, ==, 0);
+        g_assert_cmpuint(a.m_disk, ==, 1000000);
+}
+
+static void
+test_budget_lru(void)
+{
+        auto budget = ScrollbackBudget{};
+        auto a = TestClient{1000, 100};
+        auto b = TestClient{1000, 100};
+        auto c = TestClient{1000, 100};
+        budget.add(&a);
+        budget.add(&b);
+        budget.add(&c);
+
+        /* Now b is the least recently viewed one, then c */
+        budget.viewed(&a);
+
+        budget.set_limit(2650);
+        g_assert_cmpuint(b.m_disk, ==, 300);
+        g_assert_cmpuint(a.m_disk, ==, 1000);
+        g_assert_cmpuint(c.m_disk, ==, 1000);
+        g_assert_cmpuint(a.m_n_evictions, ==, 0);
+        g_assert_cmpuint(c.m_n_evictions, ==, 0);
+
+        /* b runs out, so c has to give up the rest */
+        budget.set_limit(1500);
+        g_assert_cmpuint(b.m_disk, ==, 0);
+        g_assert_cmpuint(c.m_disk, ==, 200);
+        g_assert_cmpuint(a.m_disk, ==, 1000);
+
+        uint64_t disk, memory;
+        budget.usage(disk, memory);
+        g_assert_cmpuint(disk + memory, <=, 1500);
+}
+
+static void
+test_budget_processed(void)
+{
+        auto budget = ScrollbackBudget{};
+        auto a = TestClient{1000, 0};
+        budget.add(&a);
+        budget.set_limit(2000);
+
+        /* Grow past the limit; it's only enforced after enough input */
+        a.m_disk = 3000;
+        budget.processed(ScrollbackBudget::kEnforceInterval - 1);
+        g_assert_cmpuint(a.m_disk, ==, 3000);
+
+        budget.processed(1);
+        g_assert_cmpuint(a.m_disk, ==, 2000);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/scrollback-budget/usage", test_budget_usage);
+        g_test_add_func("/bte/scrollback-budget/unlimited", test_budget_unlimited);
+        g_test_add_func("/bte/scrollback-budget/lru", test_budget_lru);
+        g_test_add_func("/bte/scrollback-budget/processed", test_budget_processed);
+
+        return g_test_run();
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "scrollback-budget.hh"
+
+#include <algorithm>
+
+namespace bte {
+
+namespace base {
+
+ScrollbackBudget&
+ScrollbackBudget::get() noexcept
+{
+        static ScrollbackBudget budget{};
+        return budget;
+}
+
+/* New clients count as just viewed */
+void
+ScrollbackBudget::add(Client* client)
+{
+        m_clients.push_back(client);
+}
+
+void
+ScrollbackBudget::remove(Client* client) noexcept
+{
+        auto const it = std::find(m_clients.begin(), m_clients.end(), client);
+        if (it != m_clients.end())
+                m_clients.erase(it);
+}
+
+/* Marks @client as the most recently viewed one */
+void
+ScrollbackBudget::viewed(Client* client) noexcept
+{
+        if (!m_clients.empty() && m_clients.back() == client)
+                return;
+
+        auto const it = std::find(m_clients.begin(), m_clients.end(), client);
+        if (it != m_clients.end())
+                std::rotate(it, it + 1, m_clients.end());
+}
+
+void
+ScrollbackBudget::set_limit(uint64_t limit)
+{
+        m_limit = limit;
+        enforce();
+}
+
+void
+ScrollbackBudget::usage(uint64_t& disk,
+                        uint64_t& memory) const noexcept
+{
+        disk = memory = 0;
+        for (auto const client : m_clients) {
+                uint64_t client_disk, client_memory;
+                client->scrollback_usage(client_disk, client_memory);
+                disk += client_disk;
+                memory += client_memory;
+        }
+}
+
+/* Enforces the limit every kEnforceInterval bytes of processed input,
+ * which bounds the growth of the scrollback in between.
+ */
+void
+ScrollbackBudget::processed(size_t bytes)
+{
+        m_processed += bytes;
+        if (m_processed < kEnforceInterval)
+                return;
+
+        m_processed = 0;
+        enforce();
+}
+
+void
+ScrollbackBudget::enforce()
+{
+        if (m_limit == 0)
+                return;
+
+        uint64_t disk, memory;
+        usage(disk, memory);
+        if (disk + memory <= m_limit)
+                return;
+
+        auto excess = disk + memory - m_limit;
+
+        /* Evicting doesn't add or remove clients */
+        for (auto const client : m_clients) {
+                excess -= std::min(excess, client->evict_scrollback(excess));
+                if (excess == 0)
+                        break;
+        }
+}
+
+} // namespace base
+
+} // namespace bte
@@ -0,0 +1,97 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bte {
+
+namespace base {
+
+/*
+ * A process-wide limit on the scrollback of all terminals together.
+ *
+ * The clients (i.e. the terminals) are kept in the order they were last
+ * viewed. When the total usage exceeds the limit, the oldest scrollback is
+ * evicted from the least recently viewed client first, and only when that
+ * one has nothing left to give up, from the next one.
+ *
+ * Only the scrollback on disk can be evicted; the rows in memory count
+ * towards the limit, but can't be given up. The size on disk is what was
+ * written to the scrollback streams, before compression and encryption:
+ * it is known without reading anything back, and it goes down by the
+ * same amount as rows are evicted. The files themselves are usually much
+ * smaller, so the limit is conservative.
+ */
+class ScrollbackBudget {
+public:
+        class Client {
+        public:
+                virtual ~Client() noexcept = default;
+
+                /* Returns the bytes of scrollback on disk, uncompressed,
+                 * and in memory */
+                virtual void scrollback_usage(uint64_t& disk,
+                                              uint64_t& memory) const noexcept = 0;
+
+                /* Drops the oldest scrollback so that at least @bytes on disk
+                 * (uncompressed) are released, and returns the number of
+                 * bytes released.
+                 */
+                virtual uint64_t evict_scrollback(uint64_t bytes) = 0;
+        }; // class Client
+
+        /* Once this many bytes were processed, the limit is enforced again */
+        static constexpr size_t kEnforceInterval = 256 * 1024;
+
+        ScrollbackBudget() = default;
+        ~ScrollbackBudget() noexcept = default;
+
+        ScrollbackBudget(ScrollbackBudget const&) = delete;
+        ScrollbackBudget(ScrollbackBudget&&) = delete;
+        ScrollbackBudget& operator= (ScrollbackBudget const&) = delete;
+        ScrollbackBudget& operator= (ScrollbackBudget&&) = delete;
+
+        static ScrollbackBudget& get() noexcept;
+
+        void add(Client* client);
+        void remove(Client* client) noexcept;
+        void viewed(Client* client) noexcept;
+
+        inline constexpr auto limit() const noexcept { return m_limit; }
+        void set_limit(uint64_t limit);
+
+        void usage(uint64_t& disk,
+                   uint64_t& memory) const noexcept;
+
+        void processed(size_t bytes);
+        void enforce();
+
+private:
+        uint64_t m_limit{0}; /* 0 means unlimited */
+        size_t m_processed{0};
+
+        /* Least recently viewed first */
+        std::vector<Client*> m_clients{};
+}; // class ScrollbackBudget
+
+} // namespace base
+
+} // namespace bte
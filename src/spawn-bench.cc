@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Measures how many "tabs" per second can be opened, i.e. how fast a new
+ * PTY can be created and a child spawned on it with bte_pty_spawn_async().
+ *
+ * Run with BTE_ZYGOTE=0 in the environment to compare against spawning
+ * without the zygote. Use --ballast to grow this process' address space
+ * first, to simulate a terminal with a lot of scrollback.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <string.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+#include <bte/bte.h>
+
+static int n_pending = 0;
+static int n_failed = 0;
+
+static void
+spawn_cb(GObject* source,
+         GAsyncResult* result,
+         gpointer user_data)
+{
+        auto error = (GError*)nullptr;
+        auto pid = GPid{-1};
+        if (bte_pty_spawn_finish(BTE_PTY(source), result, &pid, &error)) {
+                waitpid(pid, nullptr, 0);
+        } else {
+                g_printerr("Failed to spawn: %s\n", error->message);
+                g_error_free(error);
+                ++n_failed;
+        }
+
+        g_object_unref(source);
+        if (--n_pending == 0)
+                g_main_loop_quit((GMainLoop*)user_data);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        auto n_tabs = gint{1000};
+        auto n_parallel = gint{8};
+        auto ballast_mb = gint{0};
+        auto command = (char*)nullptr;
+        GOptionEntry const entries[] = {
+                { "tabs", 'n', 0, G_OPTION_ARG_INT, &n_tabs, "Number of tabs to open", "N" },
+                { "parallel", 'p', 0, G_OPTION_ARG_INT, &n_parallel, "Number of concurrent spawns", "N" },
+                { "ballast", 'b', 0, G_OPTION_ARG_INT, &ballast_mb, "Touch MB of memory before spawning", "MB" },
+                { "command", 'c', 0, G_OPTION_ARG_FILENAME, &command, "Command to spawn", "PATH" },
+                { nullptr }
+        };
+
+        auto error = (GError*)nullptr;
+        auto context = g_option_context_new(nullptr);
+        g_option_context_add_main_entries(context, entries, nullptr);
+        if (!g_option_context_parse(context, &argc, &argv, &error)) {
+                g_printerr("%s\n", error->message);
+                g_error_free(error);
+                return EXIT_FAILURE;
+        }
+        g_option_context_free(context);
+
+        auto ballast = (char*)nullptr;
+        if (ballast_mb > 0) {
+                ballast = (char*)g_malloc(size_t(ballast_mb) << 20);
+                memset(ballast, 1, size_t(ballast_mb) << 20);
+        }
+
+        char const* spawn_argv[] = {command ? command : "/bin/true", nullptr};
+
+        auto loop = g_main_loop_new(nullptr, false);
+        auto const start = g_get_monotonic_time();
+
+        for (auto n_done = 0; n_done < n_tabs; ) {
+                auto const n = std::min(n_parallel, n_tabs - n_done);
+                for (auto i = 0; i < n; ++i) {
+                        auto pty = bte_pty_new_sync(BTE_PTY_DEFAULT, nullptr, &error);
+                        if (!pty) {
+                                g_printerr("Failed to create PTY: %s\n", error->message);
+                                return EXIT_FAILURE;
+                        }
+
+                        ++n_pending;
+                        bte_pty_spawn_async(pty,
+                                            nullptr,
+                                            (char**)spawn_argv,
+                                            nullptr,
+                                            G_SPAWN_DEFAULT,
+                                            nullptr, nullptr, nullptr,
+                                            -1,
+                                            nullptr,
+                                            spawn_cb,
+                                            loop);
+                }
+
+                g_main_loop_run(loop);
+                n_done += n;
+        }
+
+        auto const elapsed = g_get_monotonic_time() - start;
+        g_print("%d tabs in %.3fs: %.1f tabs/s (zygote %s, %d failed)\n",
+                n_tabs,
+                double(elapsed) / G_USEC_PER_SEC,
+                double(n_tabs) * G_USEC_PER_SEC / double(elapsed),
+#ifdef WITH_ZYGOTE
+                g_strcmp0(g_getenv("BTE_ZYGOTE"), "0") != 0 ? "on" : "off",
+#else
+                "unavailable",
+#endif
+                n_failed);
+
+        g_main_loop_unref(loop);
+        g_free(ballast);
+        g_free(command);
+
+        return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
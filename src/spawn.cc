@@ -44,34 +44,16 @@
 #include "systemd.hh"
 #endif
 
+#ifdef WITH_ZYGOTE
+#include "zygote.hh"
+#endif
+
 #include "btedefines.hh"
 
 #include "missing.hh"
 
 namespace bte::base {
 
-static int
-set_cloexec_cb(void* data,
-               int fd)
-{
-        if (fd >= *reinterpret_cast<int*>(data)) {
-                auto r = bte::libc::fd_set_cloexec(fd);
-                /* Ignore EBADF because the libc or fallback implementation
-                 * of fdwalk may call this function on invalid file descriptors.
-                 */
-                if (r < 0 && errno == EBADF)
-                        r = 0;
-                return r;
-        }
-        return 0;
-}
-
-static int
-cloexec_from(int fd)
-{
-        return fdwalk(set_cloexec_cb, &fd);
-}
-
 static bool
 make_pipe(int flags,
           bte::libc::FD& read_fd,
@@ -350,7 +332,7 @@ SpawnContext::exec(bte::libc::FD& child_report_error_pipe_write,
          * child_error_report_pipe_write, which keeps the parent from blocking
          * forever on the other end of that pipe.
          */
-        if (cloexec_from(3) < 0)
+        if (fdwalk_set_cloexec(3) < 0)
                 return ExecError::FDWALK;
 
         /* Working directory */
@@ -556,6 +538,21 @@ SpawnOperation::prepare(bte::glib::Error& error)
          */
         context().add_map_fd(child_report_error_pipe_write.get(), -1);
 
+#ifdef WITH_ZYGOTE
+        /* Try the zygote first; it forks from a much smaller address space.
+         * On failure, fall back to forking ourself below.
+         */
+        if (auto zygote = Zygote::get()) {
+                auto const zygote_pid = zygote->spawn(context(),
+                                                      child_report_error_pipe_write.get());
+                if (zygote_pid != -1) {
+                        m_pid = zygote_pid;
+                        m_child_report_error_pipe_read = std::move(child_report_error_pipe_read);
+                        return true;
+                }
+        }
+#endif
+
         auto const pid = fork();
         if (pid < 0) {
                 auto errsv = bte::libc::ErrnoSaver{};
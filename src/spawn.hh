@@ -154,6 +154,9 @@ public:
         auto cwd()          const noexcept { return m_cwd.get();  }
         auto fallback_cwd() const noexcept { return m_fallback_cwd.get(); }
         auto environ()      const noexcept { return m_envv.get(); }
+        auto const& fd_map() const noexcept { return m_fd_map; }
+
+        auto has_child_setup() const noexcept { return m_child_setup != nullptr; }
 
         auto pty_wrapper() const noexcept { return m_pty.get();  }
         auto pty() const noexcept { return _bte_pty_get_impl(pty_wrapper()); }
@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "statistics.hh"
+
+using namespace bte::terminal;
+
+static void
+test_histogram_bucket(void)
+{
+        g_assert_cmpuint(Histogram::bucket(0), ==, 0);
+        g_assert_cmpuint(Histogram::bucket(1), ==, 1);
+        g_assert_cmpuint(Histogram::bucket(2), ==, 2);
+        g_assert_cmpuint(Histogram::bucket(3), ==, 2);
+        g_assert_cmpuint(Histogram::bucket(4), ==, 3);
+        g_assert_cmpuint(Histogram::bucket(1023), ==, 10);
+        g_assert_cmpuint(Histogram::bucket(1024), ==, 11);
+        g_assert_cmpuint(Histogram::bucket(uint64_t(1) << 30), ==, 31);
+        g_assert_cmpuint(Histogram::bucket(G_MAXUINT64), ==, Histogram::n_buckets - 1);
+}
+
+static void
+test_histogram_record(void)
+{
+        auto histogram = Histogram{};
+        histogram.record(0);
+        histogram.record(5);
+        histogram.record(6);
+        histogram.record(4096);
+
+        g_assert_cmpuint(histogram.count(), ==, 4);
+        g_assert_cmpuint(histogram.sum(), ==, 4107);
+        g_assert_cmpuint(histogram.buckets()[0], ==, 1);
+        g_assert_cmpuint(histogram.buckets()[3], ==, 2);
+        g_assert_cmpuint(histogram.buckets()[13], ==, 1);
+
+        auto variant = g_variant_ref_sink(histogram.to_variant());
+        g_assert_true(g_variant_is_of_type(variant, G_VARIANT_TYPE("(ttat)")));
+
+        guint64 count, sum;
+        GVariant* buckets;
+        g_variant_get(variant, "(tt@at)", &count, &sum, &buckets);
+        g_assert_cmpuint(count, ==, 4);
+        g_assert_cmpuint(sum, ==, 4107);
+
+        gsize n_buckets;
+        auto const data = reinterpret_cast<guint64 const*>(g_variant_get_fixed_array(buckets, &n_buckets, sizeof(guint64)));
+        g_assert_cmpuint(n_buckets, ==, Histogram::n_buckets);
+        g_assert_cmpuint(data[3], ==, 2);
+
+        g_variant_unref(buckets);
+        g_variant_unref(variant);
+}
+
+static void
+test_statistics_variant(void)
+{
+        auto statistics = Statistics{};
+        statistics.bytes_read = 42;
+        ++statistics.sequences[BTE_SEQ_CSI];
+        ++statistics.sequences[BTE_SEQ_CSI];
+        ++statistics.sequences[BTE_SEQ_NONE];
+        statistics.stream_bytes_uncompressed = 65536;
+        statistics.stream_bytes_compressed = 16384;
+
+        auto variant = g_variant_ref_sink(statistics.to_variant());
+        g_assert_true(g_variant_is_of_type(variant, G_VARIANT_TYPE_VARDICT));
+
+        guint64 value;
+        g_assert_true(g_variant_lookup(variant, "bytes-read", "t", &value));
+        g_assert_cmpuint(value, ==, 42);
+        g_assert_true(g_variant_lookup(variant, "font-cache-misses", "t", &value));
+        g_assert_cmpuint(value, ==, 0);
+
+        double ratio;
+        g_assert_true(g_variant_lookup(variant, "stream-compression-ratio", "d", &ratio));
+        g_assert_cmpfloat(ratio, ==, 4.);
+
+        auto sequences = g_variant_lookup_value(variant, "sequences", G_VARIANT_TYPE("a{st}"));
+        g_assert_nonnull(sequences);
+        g_assert_true(g_variant_lookup(sequences, "csi", "t", &value));
+        g_assert_cmpuint(value, ==, 2);
+        g_assert_true(g_variant_lookup(sequences, "osc", "t", &value));
+        g_assert_cmpuint(value, ==, 0);
+        /* BTE_SEQ_NONE is not a sequence */
+        g_assert_cmpuint(g_variant_n_children(sequences), ==, BTE_SEQ_N - 1);
+        g_variant_unref(sequences);
+
+        auto draw_time = g_variant_lookup_value(variant, "draw-time", G_VARIANT_TYPE("(ttat)"));
+        g_assert_nonnull(draw_time);
+        g_variant_unref(draw_time);
+
+        g_variant_unref(variant);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/statistics/histogram/bucket", test_histogram_bucket);
+        g_test_add_func("/bte/statistics/histogram/record", test_histogram_record);
+        g_test_add_func("/bte/statistics/variant", test_statistics_variant);
+
+        return g_test_run();
+}
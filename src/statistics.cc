@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "statistics.hh"
+
+namespace bte {
+
+namespace terminal {
+
+/* Returns: (transfer floating): a "(ttat)" variant of the number of recorded
+ * values, their sum, and the buckets
+ */
+GVariant*
+Histogram::to_variant() const
+{
+        static_assert(sizeof(guint64) == sizeof(uint64_t), "guint64 size mismatch");
+
+        return g_variant_new("(tt@at)",
+                             guint64(m_count),
+                             guint64(m_sum),
+                             g_variant_new_fixed_array(G_VARIANT_TYPE_UINT64,
+                                                       m_buckets.data(),
+                                                       m_buckets.size(),
+                                                       sizeof(m_buckets[0])));
+}
+
+/* Returns: (transfer floating): an "a{sv}" variant */
+GVariant*
+Statistics::to_variant() const
+{
+        static char const* const sequence_names[] = {
+                nullptr, /* BTE_SEQ_NONE */
+                "ignore",
+                "graphic",
+                "control",
+                "escape",
+                "csi",
+                "dcs",
+                "osc",
+                "sci",
+                "apc",
+                "pm",
+                "sos",
+        };
+        static_assert(G_N_ELEMENTS(sequence_names) == BTE_SEQ_N, "Sequence names out of sync");
+
+        GVariantBuilder sequences_builder;
+        g_variant_builder_init(&sequences_builder, G_VARIANT_TYPE("a{st}"));
+        for (auto i = 0u; i < G_N_ELEMENTS(sequence_names); ++i) {
+                if (sequence_names[i])
+                        g_variant_builder_add(&sequences_builder, "{st}",
+                                              sequence_names[i], guint64(sequences[i]));
+        }
+
+        auto const compression_ratio = stream_bytes_compressed
+                ? double(stream_bytes_uncompressed) / double(stream_bytes_compressed)
+                : 0.;
+
+        GVariantBuilder builder;
+        g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+        g_variant_builder_add(&builder, "{sv}", "bytes-read", g_variant_new_uint64(bytes_read));
+        g_variant_builder_add(&builder, "{sv}", "bytes-processed", bytes_processed.to_variant());
+        g_variant_builder_add(&builder, "{sv}", "process-time", process_time.to_variant());
+        g_variant_builder_add(&builder, "{sv}", "sequences", g_variant_builder_end(&sequences_builder));
+        g_variant_builder_add(&builder, "{sv}", "invalidated-rects", g_variant_new_uint64(invalidated_rects));
+        g_variant_builder_add(&builder, "{sv}", "draw-time", draw_time.to_variant());
+        g_variant_builder_add(&builder, "{sv}", "ring-freezes", g_variant_new_uint64(ring_freezes));
+        g_variant_builder_add(&builder, "{sv}", "ring-thaws", g_variant_new_uint64(ring_thaws));
+        g_variant_builder_add(&builder, "{sv}", "stream-block-reads", g_variant_new_uint64(stream_block_reads));
+        g_variant_builder_add(&builder, "{sv}", "stream-block-writes", g_variant_new_uint64(stream_block_writes));
+        g_variant_builder_add(&builder, "{sv}", "stream-bytes-uncompressed", g_variant_new_uint64(stream_bytes_uncompressed));
+        g_variant_builder_add(&builder, "{sv}", "stream-bytes-compressed", g_variant_new_uint64(stream_bytes_compressed));
+        g_variant_builder_add(&builder, "{sv}", "stream-compression-ratio", g_variant_new_double(compression_ratio));
+        g_variant_builder_add(&builder, "{sv}", "font-cache-hits", g_variant_new_uint64(font_cache_hits));
+        g_variant_builder_add(&builder, "{sv}", "font-cache-misses", g_variant_new_uint64(font_cache_misses));
+
+        return g_variant_builder_end(&builder);
+}
+
+} // namespace terminal
+
+} // namespace bte
@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include <glib.h>
+
+#include "parser.hh"
+
+namespace bte {
+
+namespace terminal {
+
+/* A histogram with power-of-two buckets: bucket 0 counts the value 0,
+ * and bucket i > 0 counts the values in [2^(i-1), 2^i), except that the
+ * last bucket also counts all larger values.
+ *
+ * Recording is a few instructions, so it can always be on.
+ */
+class Histogram {
+public:
+        static inline constexpr unsigned const n_buckets = 32;
+
+        static inline constexpr unsigned bucket(uint64_t value) noexcept
+        {
+                return value ? std::min(unsigned(64 - __builtin_clzll(value)), n_buckets - 1) : 0;
+        }
+
+        inline void record(uint64_t value) noexcept
+        {
+                ++m_buckets[bucket(value)];
+                ++m_count;
+                m_sum += value;
+        }
+
+        inline constexpr auto count() const noexcept { return m_count; }
+        inline constexpr auto sum() const noexcept { return m_sum; }
+        inline constexpr auto const& buckets() const noexcept { return m_buckets; }
+
+        GVariant* to_variant() const;
+
+private:
+        uint64_t m_count{0};
+        uint64_t m_sum{0};
+        std::array<uint64_t, n_buckets> m_buckets{};
+}; // class Histogram
+
+/* Counters collected by the terminal, see bte_terminal_get_statistics().
+ * The ones only filled in when queried are marked so.
+ */
+struct Statistics {
+        uint64_t bytes_read{0};
+        Histogram bytes_processed{};  /* per processing cycle */
+        Histogram process_time{};     /* in µs, per processing cycle */
+        std::array<uint64_t, BTE_SEQ_N> sequences{};
+        uint64_t invalidated_rects{0};
+        Histogram draw_time{};        /* in µs, per frame */
+
+        /* Queried */
+        uint64_t ring_freezes{0};
+        uint64_t ring_thaws{0};
+        uint64_t stream_block_reads{0};
+        uint64_t stream_block_writes{0};
+        uint64_t stream_bytes_uncompressed{0};
+        uint64_t stream_bytes_compressed{0};
+        uint64_t font_cache_hits{0};
+        uint64_t font_cache_misses{0};
+
+        GVariant* to_variant() const;
+}; // struct Statistics
+
+} // namespace terminal
+
+} // namespace bte
@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Measures the throughput of the file streams that keep the scrollback:
+ * appending, reading back in small requests one block at a time like when
+ * scrolling, and in large requests whose whole blocks are decrypted and
+ * uncompressed in batches like when rewrapping.
+ *
+ * Compare builds with -Dstream_encryption=true and false to see the cost of
+ * the encryption.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "btestream.h"
+
+static double
+mb_per_s(gsize bytes,
+         gint64 usec)
+{
+        return usec > 0 ? double(bytes) / usec : 0.;
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        auto n_megabytes = gint{256};
+        auto n_rounds = gint{3};
+        GOptionEntry const entries[] = {
+                { "megabytes", 'm', 0, G_OPTION_ARG_INT, &n_megabytes, "Size of the stream in MB", "N" },
+                { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds, "Number of times to read the stream", "N" },
+                { nullptr }
+        };
+
+        auto context = g_option_context_new(nullptr);
+        g_option_context_add_main_entries(context, entries, nullptr);
+        auto error = (GError*)nullptr;
+        if (!g_option_context_parse(context, &argc, &argv, &error)) {
+                g_printerr("%s\n", error->message);
+                g_clear_error(&error);
+                g_option_context_free(context);
+                return 1;
+        }
+        g_option_context_free(context);
+
+        auto const size = gsize(n_megabytes) * 1000000;
+        auto stream = _bte_file_stream_new();
+
+        /* Output like a build log, so that it compresses like real scrollback */
+        auto line = g_string_new(nullptr);
+        auto rand = g_rand_new_with_seed(42);
+        auto start = g_get_monotonic_time();
+        while (_bte_stream_head(stream) < size) {
+                g_string_printf(line, "[%4u/%u] CXX src/file-%08x.cc -o obj/file-%08x.o -O2 -g -Wall -fPIC\n",
+                                g_rand_int_range(rand, 0, 10000), 10000,
+                                g_rand_int(rand), g_rand_int(rand));
+                _bte_stream_append(stream, line->str, line->len);
+        }
+        auto const written = _bte_stream_head(stream);
+        g_print("Encryption %s; appended %.1f MB/s\n",
+#ifdef WITH_STREAM_ENCRYPTION
+                "on",
+#else
+                "off",
+#endif
+                mb_per_s(written, g_get_monotonic_time() - start));
+        g_string_free(line, true);
+        g_rand_free(rand);
+
+        gsize const read_sizes[] = { 4096, 1024 * 1024 };
+        auto buf = (char*)g_malloc(read_sizes[G_N_ELEMENTS(read_sizes) - 1]);
+        for (auto read_size : read_sizes) {
+                start = g_get_monotonic_time();
+                for (auto round = 0; round < n_rounds; ++round) {
+                        for (gsize offset = 0; offset < written; offset += read_size) {
+                                if (!_bte_stream_read(stream, offset, buf, MIN(read_size, written - offset))) {
+                                        g_printerr("Read failed at %" G_GSIZE_FORMAT "\n", offset);
+                                        return 1;
+                                }
+                        }
+                }
+                g_print("Read in %" G_GSIZE_FORMAT " byte requests: %.1f MB/s\n",
+                        read_size, mb_per_s(written * n_rounds, g_get_monotonic_time() - start));
+        }
+        g_free(buf);
+
+        g_object_unref(stream);
+        return 0;
+}
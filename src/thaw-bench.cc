@@ -0,0 +1,91 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Measures thawing the scrollback, by reading back the text of all of its
+ * rows, which thaws each of them once.
+ *
+ * Pass the kind of rows as the argument: ascii (plain text), colours (a
+ * few attr changes per row) or unicode (non-ASCII text).
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <ctk/ctk.h>
+#include <bte/bte.h>
+
+#include "bench-common.hh"
+
+int
+main(int argc,
+     char* argv[])
+{
+        auto n_lines = gint{1000000};
+        GOptionEntry const entries[] = {
+                { "lines", 'n', 0, G_OPTION_ARG_INT, &n_lines, "Number of lines of scrollback", "N" },
+                { nullptr }
+        };
+
+        if (!bench_init(&argc, &argv, "ascii|colours|unicode", entries))
+                return BENCH_EXIT_SKIP;
+
+        auto const mode = argc > 1 ? argv[1] : "ascii";
+
+        auto terminal = BTE_TERMINAL(g_object_ref_sink(bte_terminal_new()));
+        bte_terminal_set_size(terminal, 80, 24);
+        bte_terminal_set_scrollback_lines(terminal, n_lines);
+
+        auto line = g_string_new(nullptr);
+        for (auto i = 0; i < n_lines; ++i) {
+                if (strcmp(mode, "colours") == 0)
+                        g_string_printf(line, "\e[32m%08d\e[m \e[1mbuild\e[m src/file-%d.cc -o obj/file-%d.o\r\n", i, i, i);
+                else if (strcmp(mode, "unicode") == 0)
+                        g_string_printf(line, "%08d Größenänderung — «Zeile» %d ✓\r\n", i, i);
+                else
+                        g_string_printf(line, "%08d The quick brown fox jumps over the lazy dog %d\r\n", i, i);
+                bte_terminal_feed(terminal, line->str, line->len);
+
+                if ((i & 0x3ff) == 0) {
+                        while (g_main_context_pending(nullptr))
+                                g_main_context_iteration(nullptr, false);
+                }
+        }
+        g_string_free(line, true);
+        while (g_main_context_pending(nullptr))
+                g_main_context_iteration(nullptr, false);
+
+        glong rows, columns;
+        bte_terminal_get_cursor_position(terminal, &columns, &rows);
+
+        auto const start = g_get_monotonic_time();
+        auto text = bte_terminal_get_text_range(terminal,
+                                                rows - n_lines, 0,
+                                                rows, 80,
+                                                nullptr, nullptr,
+                                                nullptr);
+        auto const elapsed = g_get_monotonic_time() - start;
+
+        g_print("%s: thawed %d rows (%" G_GSIZE_FORMAT " bytes) in %.3fs, %.0f rows/s\n",
+                mode, n_lines, text ? strlen(text) : 0,
+                double(elapsed) / G_USEC_PER_SEC,
+                elapsed ? n_lines * double(G_USEC_PER_SEC) / elapsed : 0.);
+        g_free(text);
+
+        g_object_unref(terminal);
+        return 0;
+}
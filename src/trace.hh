@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Static tracepoints (USDT probes) in the provider "bte".
+ *
+ * A probe site is a single nop plus an ELF note, so they are compiled in by
+ * default; only the arguments, which should be cheap, are evaluated when no
+ * tracer is attached. List them with
+ *
+ *   readelf -n libbte-2.91.so | grep -A2 stapsdt
+ *
+ * and attach to a running instance with e.g.
+ *
+ *   bpftrace -p $PID -e 'usdt:*:bte:process_incoming_utf8__start { @s[tid] = nsecs; }
+ *                        usdt:*:bte:process_incoming_utf8__done  { @us = hist((nsecs - @s[tid]) / 1000); }'
+ *
+ * (process_incoming_pcterm__start/__done for the legacy charsets)
+ * or sysprof/perf (perf probe sdt_bte:\*). Timed sections have a
+ * NAME__start and a NAME__done probe.
+ */
+
+#ifdef WITH_TRACING
+
+#include <sys/sdt.h>
+
+#define _BTE_TRACE(name, ...) STAP_PROBEV(bte, name, ##__VA_ARGS__)
+
+#else
+
+#define _BTE_TRACE(name, ...) do { } while (0)
+
+#endif /* WITH_TRACING */
+
+#ifdef __cplusplus
+
+namespace bte::trace {
+
+template<typename F>
+class ScopeExit {
+public:
+        explicit constexpr ScopeExit(F f) noexcept : m_f{f} { }
+        ~ScopeExit() noexcept { m_f(); }
+
+        ScopeExit(ScopeExit const&) = delete;
+        ScopeExit(ScopeExit&&) = delete;
+        ScopeExit& operator= (ScopeExit const&) = delete;
+        ScopeExit& operator= (ScopeExit&&) = delete;
+
+private:
+        F m_f;
+}; // class ScopeExit
+
+} // namespace bte::trace
+
+/* Fires NAME__start with the given arguments now, and NAME__done when
+ * leaving the enclosing scope.
+ */
+#ifdef WITH_TRACING
+#define _BTE_TRACE_SCOPE(name, ...) \
+        _BTE_TRACE(name##__start, ##__VA_ARGS__); \
+        bte::trace::ScopeExit const _bte_trace_scope_##name{[]() noexcept { _BTE_TRACE(name##__done); }}
+#else
+#define _BTE_TRACE_SCOPE(name, ...) do { } while (0)
+#endif
+
+#endif /* __cplusplus */
@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Build-time generator for unicode-width-table.h.
+ *
+ * The width classes are taken from the Unicode data built into glib
+ * (the same data _bte_unichar_width() used to query at runtime), and
+ * compressed into a two-level table: the first level maps each block of
+ * 256 codepoints to a unique second-level block, which holds 4 width
+ * classes (2 bits each) per byte.
+ */
+
+#include <glib.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#define BLOCK_SHIFT (8)
+#define BLOCK_SIZE (1u << BLOCK_SHIFT)
+#define BLOCK_BYTES (BLOCK_SIZE / 4)
+#define N_CODEPOINTS (0x110000u)
+
+/* Keep in sync with unicode-width.hh */
+enum {
+        WIDTH_ZERO = 0,
+        WIDTH_NARROW = 1,
+        WIDTH_WIDE = 2,
+        WIDTH_AMBIGUOUS = 3,
+};
+
+static unsigned
+width_class(gunichar c)
+{
+        if (c < 0x80)
+                return WIDTH_NARROW;
+        if (g_unichar_iszerowidth(c))
+                return WIDTH_ZERO;
+        if (g_unichar_iswide(c))
+                return WIDTH_WIDE;
+        if (g_unichar_iswide_cjk(c))
+                return WIDTH_AMBIGUOUS;
+        return WIDTH_NARROW;
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        auto blocks = std::vector<std::vector<uint8_t>>{};
+        auto block_index = std::map<std::vector<uint8_t>, unsigned>{};
+        auto index = std::vector<unsigned>{};
+
+        for (auto base = 0u; base < N_CODEPOINTS; base += BLOCK_SIZE) {
+                auto block = std::vector<uint8_t>(BLOCK_BYTES, 0);
+                for (auto i = 0u; i < BLOCK_SIZE; ++i)
+                        block[i / 4] |= width_class(base + i) << ((i % 4) * 2);
+
+                auto const it = block_index.find(block);
+                if (it != block_index.end()) {
+                        index.push_back(it->second);
+                } else {
+                        auto const n = unsigned(blocks.size());
+                        block_index.emplace(block, n);
+                        blocks.push_back(std::move(block));
+                        index.push_back(n);
+                }
+        }
+
+        auto const index_type = blocks.size() <= 256 ? "uint8_t" : "uint16_t";
+
+        printf("/* Generated by unicode-width-generate from glib %u.%u.%u; do not edit! */\n\n",
+               glib_major_version, glib_minor_version, glib_micro_version);
+
+        printf("inline constexpr unsigned const kUnicodeWidthBlockShift = %u;\n\n", BLOCK_SHIFT);
+
+        printf("inline constexpr %s const kUnicodeWidthIndex[%zu] = {", index_type, index.size());
+        for (auto i = 0u; i < index.size(); ++i)
+                printf("%s%u,", (i % 16) ? " " : "\n\t", index[i]);
+        printf("\n};\n\n");
+
+        printf("inline constexpr uint8_t const kUnicodeWidthBlocks[%zu] = {", blocks.size() * BLOCK_BYTES);
+        for (auto const& block : blocks) {
+                for (auto i = 0u; i < BLOCK_BYTES; ++i)
+                        printf("%s0x%02x,", (i % 16) ? " " : "\n\t", block[i]);
+        }
+        printf("\n};\n");
+
+        return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "unicode-width.hh"
+
+#include <glib.h>
+
+using namespace bte::base;
+
+/* The width as determined by the former glib-based _bte_unichar_width() */
+static int
+glib_unichar_width(gunichar c,
+                   int ambiguous_width)
+{
+        if (c < 0x80)
+                return 1;
+        if (g_unichar_iszerowidth(c))
+                return 0;
+        if (g_unichar_iswide(c))
+                return 2;
+        if (ambiguous_width == 1)
+                return 1;
+        if (g_unichar_iswide_cjk(c))
+                return 2;
+        return 1;
+}
+
+static void
+test_unicode_width_glib(void)
+{
+        for (uint32_t cp = 0; cp < 0x110000u; ++cp) {
+                g_assert_cmpint(unicode_width(cp, 1), ==, glib_unichar_width(cp, 1));
+                g_assert_cmpint(unicode_width(cp, 2), ==, glib_unichar_width(cp, 2));
+        }
+}
+
+static void
+test_unicode_width_constexpr(void)
+{
+        static_assert(unicode_width(U'a', 2) == 1);
+        static_assert(unicode_width(U'\u0301', 1) == 0);
+        static_assert(unicode_width(U'\u4e00', 1) == 2);
+        static_assert(unicode_width_class(U'\u00a7') == UnicodeWidth::AMBIGUOUS);
+        static_assert(unicode_width(U'\u00a7', 1) == 1);
+        static_assert(unicode_width(U'\u00a7', 2) == 2);
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        g_test_init(&argc, &argv, nullptr);
+
+        g_test_add_func("/bte/unicode-width/glib", test_unicode_width_glib);
+        g_test_add_func("/bte/unicode-width/constexpr", test_unicode_width_constexpr);
+
+        return g_test_run();
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace bte {
+
+namespace base {
+
+#include "unicode-width-table.h"
+
+enum class UnicodeWidth : uint8_t {
+        ZERO = 0,
+        NARROW = 1,
+        WIDE = 2,
+        AMBIGUOUS = 3,
+};
+
+/*
+ * unicode_width_class:
+ * @c: a codepoint
+ *
+ * Returns: the width class of @c, using the precomputed table generated
+ *   from glib's Unicode data by unicode-width-generate.
+ */
+inline constexpr UnicodeWidth
+unicode_width_class(char32_t c) noexcept
+{
+        if (c < 0x80)
+                return UnicodeWidth::NARROW;
+        if (c >= 0x110000)
+                return UnicodeWidth::NARROW;
+
+        auto const block = unsigned{kUnicodeWidthIndex[c >> kUnicodeWidthBlockShift]};
+        auto const offset = c & ((1u << kUnicodeWidthBlockShift) - 1);
+        auto const byte = kUnicodeWidthBlocks[(block << (kUnicodeWidthBlockShift - 2)) + (offset >> 2)];
+        return UnicodeWidth((byte >> ((offset & 3) * 2)) & 3);
+}
+
+/*
+ * unicode_width:
+ * @c: a codepoint
+ * @ambiguous_width: the width (1 or 2) to use for East Asian ambiguous characters
+ *
+ * Returns: the number of columns @c occupies; equivalent to checking
+ *   g_unichar_iszerowidth(), g_unichar_iswide() and g_unichar_iswide_cjk().
+ */
+inline constexpr int
+unicode_width(char32_t c,
+              int ambiguous_width) noexcept
+{
+        auto const w = unicode_width_class(c);
+        if (w == UnicodeWidth::AMBIGUOUS)
+                return ambiguous_width;
+        return int(w);
+}
+
+} // namespace base
+
+} // namespace bte
@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Measures the throughput of the output of `yes | head -n 10000000`, i.e.
+ * of short lines scrolling through the writable area as fast as possible,
+ * where the cost is mostly in creating, freezing and discarding rows.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <ctk/ctk.h>
+#include <bte/bte.h>
+
+#include "bench-common.hh"
+
+int
+main(int argc,
+     char* argv[])
+{
+        auto n_lines = gint{10000000};
+        auto n_scrollback = gint{10000};
+        GOptionEntry const entries[] = {
+                { "lines", 'n', 0, G_OPTION_ARG_INT, &n_lines, "Number of lines of output", "N" },
+                { "scrollback", 's', 0, G_OPTION_ARG_INT, &n_scrollback, "Number of lines of scrollback", "N" },
+                { nullptr }
+        };
+
+        if (!bench_init(&argc, &argv, nullptr, entries))
+                return BENCH_EXIT_SKIP;
+
+        auto window = ctk_window_new(CTK_WINDOW_TOPLEVEL);
+        auto terminal = bte_terminal_new();
+        bte_terminal_set_size(BTE_TERMINAL(terminal), 80, 24);
+        bte_terminal_set_scrollback_lines(BTE_TERMINAL(terminal), n_scrollback);
+        ctk_container_add(CTK_CONTAINER(window), terminal);
+        ctk_widget_show_all(window);
+
+        /* Feed it in blocks, like reads from the PTY */
+        char block[64 * 1024 / 3 * 3];
+        for (auto i = size_t{0}; i < sizeof(block); i += 3)
+                memcpy(block + i, "y\r\n", 3);
+        auto const lines_per_block = gint(sizeof(block) / 3);
+
+        auto const start = g_get_monotonic_time();
+        for (auto i = 0; i < n_lines; i += lines_per_block) {
+                auto const n = MIN(lines_per_block, n_lines - i);
+                bte_terminal_feed(BTE_TERMINAL(terminal), block, n * 3);
+
+                while (g_main_context_pending(nullptr))
+                        g_main_context_iteration(nullptr, false);
+        }
+        auto const elapsed = g_get_monotonic_time() - start;
+
+        g_print("%d lines in %.3fs (%.0f lines/s), peak RSS %ld kB\n",
+                n_lines,
+                double(elapsed) / G_USEC_PER_SEC,
+                elapsed ? n_lines * double(G_USEC_PER_SEC) / elapsed : 0.,
+                bench_peak_rss_kb());
+
+        ctk_widget_destroy(window);
+        return 0;
+}
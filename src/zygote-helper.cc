@@ -0,0 +1,338 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* bte-zygote: forks and execs the children requested by libbte over
+ * the socket on BTE_ZYGOTE_SOCKET_FD. See zygote.hh for the protocol.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "btespawn.hh"
+#include "libc-glue.hh"
+#include "zygote.hh"
+
+#include "missing.hh"
+
+using namespace bte::base;
+
+struct SpawnRequest {
+        uint32_t flags{0};
+        char const* arg0{nullptr};
+        char const* cwd{nullptr};
+        char const* fallback_cwd{nullptr};
+        char const* search_path{nullptr};
+        std::vector<char*> argv{};
+        std::vector<char*> envv{};
+
+        /* The first two FDs are the error report pipe and the PTY */
+        std::vector<bte::libc::FD> fds{};
+        std::vector<int> targets{};
+};
+
+/* This function is called between clone and execve/_exit and so must be
+ * async-signal-safe; see man:signal-safety(7).
+ */
+static int
+open_peer(int pty_fd,
+          bool no_ctty) noexcept
+{
+        auto const fd_flags = int{O_RDWR | O_CLOEXEC | (no_ctty ? O_NOCTTY : 0)};
+
+        auto peer_fd = ioctl(pty_fd, TIOCGPTPEER, fd_flags);
+        if (peer_fd != -1 || (errno != EINVAL && errno != ENOTTY))
+                return peer_fd;
+
+        char name[64];
+        if (ptsname_r(pty_fd, name, sizeof(name)) != 0)
+                return -1;
+
+        return open(name, fd_flags);
+}
+
+/* This function is called between clone and execve/_exit and so must be
+ * async-signal-safe; see man:signal-safety(7).
+ *
+ * This mirrors SpawnContext::exec(), except that the signal state is
+ * already reset in this process, and that all received FDs are O_CLOEXEC.
+ */
+static ZygoteExecError
+exec_child(SpawnRequest& request,
+           int& child_report_error_pipe_write,
+           void* workbuf,
+           size_t workbufsize) noexcept
+{
+        if (request.cwd && chdir(request.cwd) < 0) {
+                auto errsv = bte::libc::ErrnoSaver{};
+                if (request.fallback_cwd && chdir(request.fallback_cwd) < 0)
+                        return ZygoteExecError::CHDIR;
+
+                errsv.reset();
+        }
+
+        if (!(request.flags & ZYGOTE_FLAG_NO_SESSION) && setsid() == -1)
+                return ZygoteExecError::SETSID;
+
+        auto const peer_fd = open_peer(request.fds[1].get(),
+                                       request.flags & ZYGOTE_FLAG_NO_CTTY);
+        if (peer_fd == -1)
+                return ZygoteExecError::GETPTPEER;
+
+        if (!(request.flags & ZYGOTE_FLAG_NO_CTTY) &&
+            ioctl(peer_fd, TIOCSCTTY, peer_fd) != 0)
+                return ZygoteExecError::SCTTY;
+
+        /* Move all source FDs above the highest target FD first, so that
+         * the dup2() calls below cannot overwrite a source FD.
+         */
+        auto max_target = 2;
+        for (auto target : request.targets)
+                max_target = std::max(max_target, target);
+
+        auto const relocate = [&](int fd) -> int {
+                return fd > max_target ? fd : bte::libc::fd_dup_cloexec(fd, max_target + 1);
+        };
+
+        child_report_error_pipe_write = relocate(child_report_error_pipe_write);
+        if (child_report_error_pipe_write == -1)
+                return ZygoteExecError::DUP;
+
+        auto const new_peer_fd = relocate(peer_fd);
+        if (new_peer_fd == -1)
+                return ZygoteExecError::DUP;
+
+        auto const n_targets = request.targets.size();
+        for (auto i = size_t{0}; i < n_targets; ++i) {
+                auto const fd = relocate(request.fds[i + 2].get());
+                if (fd == -1)
+                        return ZygoteExecError::DUP;
+
+                /* Don't use FD::operator= here, it would close() the old FD */
+                request.fds[i + 2].release();
+                request.fds[i + 2] = fd;
+        }
+
+        for (auto target = 0; target < 3; ++target) {
+                if (bte::libc::fd_dup2(new_peer_fd, target) == -1)
+                        return ZygoteExecError::DUP2;
+        }
+
+        for (auto i = size_t{0}; i < n_targets; ++i) {
+                if (bte::libc::fd_dup2(request.fds[i + 2].get(), request.targets[i]) == -1)
+                        return ZygoteExecError::DUP2;
+        }
+
+        _bte_execute(request.arg0,
+                     request.argv.data(),
+                     request.envv.data(),
+                     request.search_path,
+                     workbuf,
+                     workbufsize);
+
+        /* If we get here, exec failed */
+        return ZygoteExecError::EXEC;
+}
+
+static char const*
+next_string(char const*& data,
+            char const* end)
+{
+        if (data >= end)
+                return nullptr;
+
+        auto const nul = reinterpret_cast<char const*>(memchr(data, '\0', end - data));
+        if (!nul)
+                return nullptr;
+
+        auto const str = data;
+        data = nul + 1;
+        return str;
+}
+
+static bool
+parse_request(char const* buf,
+              size_t size,
+              SpawnRequest& request)
+{
+        if (size < sizeof(ZygoteRequest))
+                return false;
+
+        auto header = ZygoteRequest{};
+        memcpy(&header, buf, sizeof(header));
+        if (header.version != BTE_ZYGOTE_PROTOCOL_VERSION ||
+            header.n_fds > BTE_ZYGOTE_FDS_MAX ||
+            header.n_fds + 2 != request.fds.size() ||
+            size != sizeof(header) + header.n_fds * sizeof(int32_t) + header.data_size)
+                return false;
+
+        request.flags = header.flags;
+
+        request.targets.resize(header.n_fds);
+        for (auto i = size_t{0}; i < header.n_fds; ++i) {
+                auto target = int32_t{};
+                memcpy(&target, buf + sizeof(header) + i * sizeof(int32_t), sizeof(target));
+                if (target < 0)
+                        return false;
+                request.targets[i] = target;
+        }
+
+        auto data = buf + sizeof(header) + header.n_fds * sizeof(int32_t);
+        auto const end = data + header.data_size;
+
+        request.arg0 = next_string(data, end);
+        request.cwd = next_string(data, end);
+        request.fallback_cwd = next_string(data, end);
+        request.search_path = next_string(data, end);
+        if (!request.arg0 || !request.cwd || !request.fallback_cwd || !request.search_path)
+                return false;
+
+        if (!(header.flags & ZYGOTE_FLAG_HAVE_CWD))
+                request.cwd = nullptr;
+        if (!(header.flags & ZYGOTE_FLAG_HAVE_FALLBACK_CWD))
+                request.fallback_cwd = nullptr;
+
+        request.argv.reserve(header.n_argv + 1);
+        for (auto i = uint32_t{0}; i < header.n_argv; ++i) {
+                auto const str = next_string(data, end);
+                if (!str)
+                        return false;
+                request.argv.push_back(const_cast<char*>(str));
+        }
+        request.argv.push_back(nullptr);
+
+        request.envv.reserve(header.n_envv + 1);
+        for (auto i = uint32_t{0}; i < header.n_envv; ++i) {
+                auto const str = next_string(data, end);
+                if (!str)
+                        return false;
+                request.envv.push_back(const_cast<char*>(str));
+        }
+        request.envv.push_back(nullptr);
+
+        return data == end;
+}
+
+static pid_t
+spawn(SpawnRequest& request)
+{
+        /* Same as SpawnContext::workbuf_size() */
+        auto const workbufsize = std::max(strlen(request.search_path) + strlen(request.arg0) + 2,
+                                          request.argv.size() * sizeof(char*) + sizeof(char*));
+        auto workbuf = std::vector<char>(workbufsize);
+
+        /* CLONE_PARENT makes the child a child of the terminal process, which
+         * will wait for it, instead of a child of the zygote. Since this
+         * process is single-threaded and the child only calls async-signal-safe
+         * functions before exec, the raw syscall can be used like fork().
+         */
+        auto const pid = pid_t(syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0));
+        if (pid != 0)
+                return pid;
+
+        /* Child */
+        auto child_report_error_pipe_write = request.fds[0].get();
+        auto const err = exec_child(request,
+                                    child_report_error_pipe_write,
+                                    workbuf.data(), workbuf.size());
+
+        _bte_write_err(child_report_error_pipe_write, int(err));
+        _exit(127);
+}
+
+static int
+close_fd_cb(void* data,
+            int fd)
+{
+        if (fd > BTE_ZYGOTE_SOCKET_FD)
+                (void)close(fd);
+        return 0;
+}
+
+int
+main(int argc,
+     char* argv[])
+{
+        /* Don't keep any FDs the parent leaked, like other terminals' PTYs, alive */
+        if (close_range(BTE_ZYGOTE_SOCKET_FD + 1, ~0U, 0) != 0)
+                fdwalk(close_fd_cb, nullptr);
+
+        if (bte::libc::fd_set_cloexec(BTE_ZYGOTE_SOCKET_FD) == -1)
+                return EXIT_FAILURE;
+
+        auto buf = std::vector<char>(BTE_ZYGOTE_MESSAGE_SIZE_MAX);
+        auto control = std::vector<char>(CMSG_SPACE((BTE_ZYGOTE_FDS_MAX + 2) * sizeof(int)));
+
+        for (;;) {
+                auto iov = iovec{buf.data(), buf.size()};
+                auto msg = msghdr{};
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                msg.msg_control = control.data();
+                msg.msg_controllen = control.size();
+
+                auto const r = recvmsg(BTE_ZYGOTE_SOCKET_FD, &msg, MSG_CMSG_CLOEXEC);
+                if (r == 0)
+                        break; /* the terminal process went away */
+                if (r == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        return EXIT_FAILURE;
+                }
+
+                auto request = SpawnRequest{};
+                for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+                                continue;
+
+                        auto const n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                        auto const fds = reinterpret_cast<int const*>(CMSG_DATA(cmsg));
+                        for (auto i = size_t{0}; i < n; ++i) {
+                                auto fd = int{};
+                                memcpy(&fd, &fds[i], sizeof(fd));
+                                request.fds.emplace_back(fd);
+                        }
+                }
+
+                auto reply = ZygoteReply{-1, EINVAL};
+                if (!(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) &&
+                    parse_request(buf.data(), size_t(r), request)) {
+                        auto const pid = spawn(request);
+                        reply.pid = pid;
+                        reply.errsv = pid == -1 ? errno : 0;
+                }
+
+                if (send(BTE_ZYGOTE_SOCKET_FD, &reply, sizeof(reply), MSG_NOSIGNAL) == -1)
+                        return EXIT_FAILURE;
+
+                /* The request's FDs are closed here */
+        }
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "zygote.hh"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <glib.h>
+
+#include "debug.h"
+#include "reaper.hh"
+#include "spawn.hh"
+
+extern char** environ;
+
+namespace bte::base {
+
+#define CHECK_EXEC_ERROR(e) \
+        static_assert(int(ZygoteExecError::e) == int(SpawnContext::ExecError::e), \
+                      "ZygoteExecError::" #e " out of sync")
+CHECK_EXEC_ERROR(CHDIR);
+CHECK_EXEC_ERROR(DUP);
+CHECK_EXEC_ERROR(DUP2);
+CHECK_EXEC_ERROR(EXEC);
+CHECK_EXEC_ERROR(FDWALK);
+CHECK_EXEC_ERROR(GETPTPEER);
+CHECK_EXEC_ERROR(SCTTY);
+CHECK_EXEC_ERROR(SETSID);
+CHECK_EXEC_ERROR(SIGMASK);
+CHECK_EXEC_ERROR(UNSET_CLOEXEC);
+#undef CHECK_EXEC_ERROR
+
+Zygote*
+Zygote::get() noexcept
+{
+        static auto const enabled = []() -> bool {
+                auto const env = g_getenv("BTE_ZYGOTE");
+                return !env || g_strcmp0(env, "0") != 0;
+        }();
+        if (!enabled)
+                return nullptr;
+
+        /* Intentionally leaked; the zygote exits when the socket is closed
+         * on process exit.
+         */
+        static auto const zygote = new Zygote{};
+        return zygote;
+}
+
+static gboolean
+reaper_add_zygote_cb(void* data)
+{
+        bte_reaper_add_child(GPOINTER_TO_INT(data));
+        return G_SOURCE_REMOVE;
+}
+
+/* The zygote may be started from a worker thread doing an async spawn,
+ * but the reaper and its sources belong to the main context. */
+static void
+reaper_add_zygote(pid_t pid)
+{
+        auto const context = g_main_context_default();
+        if (g_main_context_is_owner(context)) {
+                bte_reaper_add_child(pid);
+                return;
+        }
+
+        auto const source = g_idle_source_new();
+        g_source_set_priority(source, G_PRIORITY_HIGH);
+        g_source_set_callback(source, reaper_add_zygote_cb, GINT_TO_POINTER(pid), nullptr);
+        g_source_attach(source, context);
+        g_source_unref(source);
+}
+
+bool
+Zygote::start() noexcept
+{
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+                auto errsv = bte::libc::ErrnoSaver{};
+                _bte_debug_print(BTE_DEBUG_PTY, "%s failed: %s\n",
+                                 "socketpair", g_strerror(errsv));
+                return false;
+        }
+
+        auto socket = bte::libc::FD{sv[0]};
+        auto zygote_socket = bte::libc::FD{sv[1]};
+
+        /* Make sure the dup2() below actually clears FD_CLOEXEC */
+        if (zygote_socket.get() == BTE_ZYGOTE_SOCKET_FD) {
+                zygote_socket = bte::libc::fd_dup_cloexec(zygote_socket.get(),
+                                                          BTE_ZYGOTE_SOCKET_FD + 1);
+                if (!zygote_socket)
+                        return false;
+        }
+
+        posix_spawn_file_actions_t file_actions;
+        posix_spawn_file_actions_init(&file_actions);
+        posix_spawn_file_actions_adddup2(&file_actions,
+                                         zygote_socket.get(),
+                                         BTE_ZYGOTE_SOCKET_FD);
+
+        /* The zygote's children inherit its signal state */
+        sigset_t set;
+        sigemptyset(&set);
+        sigset_t all;
+        sigfillset(&all);
+
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setflags(&attr,
+                                 POSIX_SPAWN_SETSIGMASK |
+                                 POSIX_SPAWN_SETSIGDEF |
+                                 POSIX_SPAWN_SETPGROUP);
+        posix_spawnattr_setsigmask(&attr, &set);
+        posix_spawnattr_setsigdefault(&attr, &all);
+        posix_spawnattr_setpgroup(&attr, 0);
+
+        char* argv[] = {(char*)BTE_ZYGOTE_PATH, nullptr};
+        auto pid = pid_t{-1};
+        auto const r = posix_spawn(&pid, BTE_ZYGOTE_PATH,
+                                   &file_actions, &attr,
+                                   argv, environ);
+
+        posix_spawnattr_destroy(&attr);
+        posix_spawn_file_actions_destroy(&file_actions);
+
+        if (r != 0) {
+                _bte_debug_print(BTE_DEBUG_PTY, "Failed to start zygote %s: %s\n",
+                                 BTE_ZYGOTE_PATH, g_strerror(r));
+                return false;
+        }
+
+        _bte_debug_print(BTE_DEBUG_PTY, "Started zygote, pid %d\n", int(pid));
+
+        /* Reap the zygote when it exits */
+        reaper_add_zygote(pid);
+
+        m_socket = std::move(socket);
+        m_pid = pid;
+        return true;
+}
+
+/* Drops a zygote that stopped working. The next spawn starts a new one. */
+void
+Zygote::stop() noexcept
+{
+        /* The zygote exits on EOF */
+        m_socket.reset();
+        m_pid = -1;
+}
+
+static void
+append_string(std::vector<char>& data,
+              char const* str)
+{
+        data.insert(data.end(), str, str + strlen(str) + 1);
+}
+
+/* Called from SpawnOperation::prepare() instead of fork().
+ * Requests that cannot be expressed in the protocol return -1 without
+ * talking to the zygote, so that the caller falls back to fork().
+ */
+pid_t
+Zygote::spawn(SpawnContext& context,
+              int child_report_error_pipe_write) noexcept
+try
+{
+        /* The child setup func needs to run in our address space */
+        if (context.has_child_setup())
+                return -1;
+
+        auto const pty = context.pty();
+        if (!pty)
+                return -1;
+
+        auto fds = std::vector<int>{};
+        auto targets = std::vector<int32_t>{};
+        fds.push_back(child_report_error_pipe_write);
+        fds.push_back(pty->fd());
+
+        /* Skip the PTY peer placeholders, and FDs that are only in the
+         * map to be closed in the child, which is implicit in the zygote
+         * since all FDs it receives are O_CLOEXEC.
+         */
+        auto const& fd_map = context.fd_map();
+        for (auto i = size_t{3}; i < fd_map.size(); ++i) {
+                auto const [source_fd, target_fd] = fd_map[i];
+                if (target_fd == -1)
+                        continue;
+
+                fds.push_back(source_fd);
+                targets.push_back(target_fd);
+        }
+
+        if (targets.size() > BTE_ZYGOTE_FDS_MAX)
+                return -1;
+
+        auto request = ZygoteRequest{};
+        request.version = BTE_ZYGOTE_PROTOCOL_VERSION;
+        request.flags = ZYGOTE_FLAG_NONE;
+        if (pty->flags() & BTE_PTY_NO_SESSION)
+                request.flags |= ZYGOTE_FLAG_NO_SESSION;
+        if (pty->flags() & BTE_PTY_NO_CTTY)
+                request.flags |= ZYGOTE_FLAG_NO_CTTY;
+        if (context.cwd())
+                request.flags |= ZYGOTE_FLAG_HAVE_CWD;
+        if (context.fallback_cwd())
+                request.flags |= ZYGOTE_FLAG_HAVE_FALLBACK_CWD;
+        request.n_fds = targets.size();
+
+        auto data = std::vector<char>(sizeof(request) + targets.size() * sizeof(int32_t));
+        if (!targets.empty())
+                memcpy(data.data() + sizeof(request), targets.data(), targets.size() * sizeof(int32_t));
+
+        append_string(data, context.arg0());
+        append_string(data, context.cwd() ? : "");
+        append_string(data, context.fallback_cwd() ? : "");
+        append_string(data, context.search_path());
+        for (auto argv = context.argv(); *argv; ++argv, ++request.n_argv)
+                append_string(data, *argv);
+        if (auto envv = context.environ()) {
+                for (; *envv; ++envv, ++request.n_envv)
+                        append_string(data, *envv);
+        }
+
+        if (data.size() > BTE_ZYGOTE_MESSAGE_SIZE_MAX)
+                return -1;
+
+        request.data_size = data.size() - sizeof(request) - targets.size() * sizeof(int32_t);
+        memcpy(data.data(), &request, sizeof(request));
+
+        auto lock = std::lock_guard<std::mutex>{m_mutex};
+
+        if (m_failed)
+                return -1;
+        if (!m_socket && !start()) {
+                m_failed = true;
+                return -1;
+        }
+
+        auto iov = iovec{data.data(), data.size()};
+        auto control = std::vector<char>(CMSG_SPACE(fds.size() * sizeof(int)));
+        auto msg = msghdr{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fds.size() * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds.data(), fds.size() * sizeof(int));
+
+        auto r = ssize_t{};
+        do {
+                r = sendmsg(m_socket.get(), &msg, MSG_NOSIGNAL);
+        } while (r == -1 && errno == EINTR);
+        if (r != ssize_t(data.size())) {
+                auto errsv = bte::libc::ErrnoSaver{};
+                _bte_debug_print(BTE_DEBUG_PTY, "Zygote %s failed: %s\n",
+                                 "sendmsg", g_strerror(errsv));
+                stop();
+                return -1;
+        }
+
+        auto reply = ZygoteReply{};
+        do {
+                r = recv(m_socket.get(), &reply, sizeof(reply), 0);
+        } while (r == -1 && errno == EINTR);
+        if (r != ssize_t(sizeof(reply))) {
+                auto errsv = bte::libc::ErrnoSaver{};
+                _bte_debug_print(BTE_DEBUG_PTY, "Zygote %s failed: %s\n",
+                                 "recv", r == 0 ? "EOF" : g_strerror(errsv));
+                stop();
+                return -1;
+        }
+
+        if (reply.pid <= 0) {
+                _bte_debug_print(BTE_DEBUG_PTY, "Zygote failed to spawn: %s\n",
+                                 g_strerror(reply.errsv));
+                errno = reply.errsv;
+                return -1;
+        }
+
+        return pid_t(reply.pid);
+}
+catch (...)
+{
+        return -1;
+}
+
+} // namespace bte::base
@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2026 CAFE Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include <sys/types.h>
+
+#include "libc-glue.hh"
+
+/* The zygote is a small helper process (bte-zygote) that forks the
+ * spawned children from its own tiny address space instead of from
+ * the (possibly huge) terminal process.
+ *
+ * Requests are sent over a SOCK_SEQPACKET socket as a single message
+ * consisting of a ZygoteRequest header, followed by @n_fds int32_t
+ * target FD numbers, followed by @data_size bytes of NUL-terminated
+ * strings: arg0, cwd, fallback cwd, search path, @n_argv argv strings,
+ * and @n_envv environment strings. The message carries 2 + @n_fds
+ * file descriptors in SCM_RIGHTS: the child error report pipe write end,
+ * the PTY, and the FDs to map to the target FD numbers.
+ *
+ * The zygote replies with a ZygoteReply. The child is created with
+ * CLONE_PARENT so that it is a child of the terminal process, which
+ * reaps it as usual; exec failures are reported over the error report
+ * pipe exactly like in the fork() path in SpawnOperation::prepare().
+ */
+
+namespace bte::base {
+
+#define BTE_ZYGOTE_PROTOCOL_VERSION (1u)
+
+/* The zygote's end of the socket in the zygote process */
+#define BTE_ZYGOTE_SOCKET_FD (3)
+
+/* SCM_MAX_FD is 253; keep room for the error pipe and the PTY */
+#define BTE_ZYGOTE_FDS_MAX (240)
+
+#define BTE_ZYGOTE_MESSAGE_SIZE_MAX (256 * 1024)
+
+enum ZygoteRequestFlags : uint32_t {
+        ZYGOTE_FLAG_NONE       = 0u,
+        ZYGOTE_FLAG_HAVE_CWD   = 1u << 0,
+        ZYGOTE_FLAG_HAVE_FALLBACK_CWD = 1u << 1,
+        ZYGOTE_FLAG_NO_SESSION = 1u << 2,
+        ZYGOTE_FLAG_NO_CTTY    = 1u << 3,
+};
+
+struct ZygoteRequest {
+        uint32_t version;
+        uint32_t flags;
+        uint32_t n_fds;
+        uint32_t n_argv;
+        uint32_t n_envv;
+        uint32_t data_size;
+};
+
+struct ZygoteReply {
+        int32_t pid;
+        int32_t errsv;
+};
+
+/* Must be kept in sync with SpawnContext::ExecError */
+enum class ZygoteExecError {
+        CHDIR,
+        DUP,
+        DUP2,
+        EXEC,
+        FDWALK,
+        GETPTPEER,
+        SCTTY,
+        SETSID,
+        SIGMASK,
+        UNSET_CLOEXEC,
+};
+
+class SpawnContext;
+
+class Zygote {
+public:
+        /*
+         * Zygote::get:
+         *
+         * Returns: the process-wide zygote, or %nullptr if it is disabled
+         *   (by setting BTE_ZYGOTE=0 in the environment) or unavailable.
+         *   The zygote process is started on first use.
+         */
+        static Zygote* get() noexcept;
+
+        /*
+         * Zygote::spawn:
+         * @context: the spawn context
+         * @child_report_error_pipe_write: the error report pipe
+         *
+         * Returns: the PID of the child, or -1 if the zygote could not
+         *   spawn it, in which case the caller should fall back to fork().
+         */
+        pid_t spawn(SpawnContext& context,
+                    int child_report_error_pipe_write) noexcept;
+
+private:
+        Zygote() = default;
+
+        bool start() noexcept;
+        void stop() noexcept;
+
+        std::mutex m_mutex{};
+        bte::libc::FD m_socket{};
+        pid_t m_pid{-1};
+        bool m_failed{false};  /* the zygote could not be started at all */
+
+}; // class Zygote
+
+} // namespace bte::base